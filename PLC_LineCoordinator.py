@@ -22,6 +22,7 @@ class MySignals:
         self.S1_cycle_time_ms = 0
         self.S1_inventory_ok = 0
         self.S1_any_arm_failed = 0
+        self.S1_done_time_ns = 0
         self.S2_ready = 0
         self.S2_busy = 0
         self.S2_fault = 0
@@ -31,6 +32,7 @@ class MySignals:
         self.S2_scrapped = 0
         self.S2_reworks = 0
         self.S2_cycle_time_avg_s = 0
+        self.S2_done_time_ns = 0
         self.S3_ready = 0
         self.S3_busy = 0
         self.S3_fault = 0
@@ -38,6 +40,7 @@ class MySignals:
         self.S3_cycle_time_ms = 0
         self.S3_strain_relief_ok = 0
         self.S3_continuity_ok = 0
+        self.S3_done_time_ns = 0
         self.S4_ready = 0
         self.S4_busy = 0
         self.S4_fault = 0
@@ -45,6 +48,7 @@ class MySignals:
         self.S4_cycle_time_ms = 0
         self.S4_total = 0
         self.S4_completed = 0
+        self.S4_done_time_ns = 0
         self.S5_ready = 0
         self.S5_busy = 0
         self.S5_fault = 0
@@ -53,6 +57,7 @@ class MySignals:
         self.S5_accept = 0
         self.S5_reject = 0
         self.S5_last_accept = 0
+        self.S5_done_time_ns = 0
         self.S6_ready = 0
         self.S6_busy = 0
         self.S6_fault = 0
@@ -64,6 +69,7 @@ class MySignals:
         self.S6_operational_time_s = 0
         self.S6_downtime_s = 0
         self.S6_availability = 0
+        self.S6_done_time_ns = 0
 
         # Outputs
         self.S1_cmd_start = 0
@@ -131,6 +137,10 @@ ST6_PackagingDispatch5 = 5
 
 # Start of user custom code region. Please apply edits only within these regions:  Global Variables & Definitions
 # PLC coordination state machine for the 6-station line (S1..S6).
+import os
+import shlex
+import types
+from collections import deque
 
 STATIONS = ["S1", "S2", "S3", "S4", "S5", "S6"]
 RESET_PULSE_TICKS = 3
@@ -138,6 +148,319 @@ RESET_PULSE_TICKS = 3
 # Buffer constants
 BUF_MAX = 2  # Increased buffer size for better pipeline flow
 
+# The controller below is strictly serial: one unit in flight, START_Sx ->
+# WAIT_Sx_DONE -> START_Sx+1, and a buffer is consumed in the scan after it
+# is filled. Buffers only ever hold 0 or 1, so there are no per-buffer
+# capacities and no blocked time to measure.
+BUFFERS = ["S1_to_S2", "S2_to_S3", "S3_to_S4", "S4_to_S5", "S5_to_S6"]
+
+
+class _FlowStats:
+    """
+    Time-weighted buffer occupancy and idle time per station, in simulated
+    ns. Each scan's state is charged for the interval up to the next scan
+    (left-point rule), so the result does not depend on the step.
+
+    Idle means ready, not busy and not faulted. Under the serial controller
+    a station is idle whenever the one unit is at another station, so this
+    is not starvation and there is no blocked time to report.
+    """
+
+    def __init__(self):
+        self.t0_ns = None
+        self.last_ns = None
+        self.occ_ns = {b: 0 for b in BUFFERS}
+        self.max_occ = {b: 0 for b in BUFFERS}
+        self.idle_ns = {st: 0 for st in STATIONS}
+        self._occ = {}
+        self._idle = ()
+
+    def update(self, now_ns, buffers, idle):
+        if self.last_ns is None:
+            self.t0_ns = now_ns
+        else:
+            dt = max(0, now_ns - self.last_ns)
+            for b, n in self._occ.items():
+                self.occ_ns[b] += n * dt
+            for st in self._idle:
+                self.idle_ns[st] += dt
+        self.last_ns = now_ns
+        self._occ = dict(buffers)
+        self._idle = tuple(idle)
+        for b, n in buffers.items():
+            if n > self.max_occ[b]:
+                self.max_occ[b] = n
+
+    def summary(self):
+        elapsed = (self.last_ns - self.t0_ns) if self.last_ns is not None else 0
+        el = float(elapsed) if elapsed > 0 else 1.0
+        return {
+            "elapsed_s": elapsed / 1e9,
+            "buffer_avg_occupancy": {b: self.occ_ns[b] / el for b in BUFFERS},
+            "buffer_max_occupancy": dict(self.max_occ),
+            "idle_s": {st: self.idle_ns[st] / 1e9 for st in STATIONS},
+            "idle_pct": {st: 100.0 * self.idle_ns[st] / el for st in STATIONS},
+        }
+
+
+# WAIT_Sx_DONE watchdogs, in simulated time (independent of the scan step).
+# Deadline = p99 of the station's recent cycle times * margin + two scans
+# of detection slack; until enough cycles are seen the cold-start value applies.
+WATCHDOG_MARGIN = 1.5
+WATCHDOG_MIN_SAMPLES = 8
+WATCHDOG_WINDOW = 64
+WATCHDOG_INITIAL_S = 120.0  # well above ST4's ~41 s calibration cycle
+
+
+class _Watchdog:
+    """Start-to-done timers per station plus the cycle-time window they learn from."""
+
+    def __init__(self):
+        self.samples = {st: deque(maxlen=WATCHDOG_WINDOW) for st in STATIONS}
+        self.armed_ns = {}
+        self.sampled = set()
+        self.alarm_count = {st: 0 for st in STATIONS}
+        self.alarms = deque(maxlen=32)
+
+    def arm(self, st, now_ns):
+        self.armed_ns[st] = now_ns
+        self.sampled.discard(st)
+
+    def disarm(self, st):
+        self.armed_ns.pop(st, None)
+
+    def disarm_all(self):
+        self.armed_ns.clear()
+
+    def observe_done(self, st, done_ns):
+        # keeps running: a station that reports done but never returns to ready still trips
+        t0 = self.armed_ns.get(st)
+        if t0 is not None and st not in self.sampled and done_ns >= t0:
+            self.samples[st].append(done_ns - t0)
+            self.sampled.add(st)
+
+    def deadline_ns(self, st, slack_ns=0):
+        xs = self.samples[st]
+        if len(xs) < WATCHDOG_MIN_SAMPLES:
+            return int(WATCHDOG_INITIAL_S * 1e9) + slack_ns
+        xs = sorted(xs)
+        p99 = xs[max(0, math.ceil(0.99 * len(xs)) - 1)]
+        return int(p99 * WATCHDOG_MARGIN) + slack_ns
+
+    def waited_ns(self, st, now_ns):
+        t0 = self.armed_ns.get(st)
+        return 0 if t0 is None else now_ns - t0
+
+    def expired(self, st, now_ns, slack_ns=0):
+        return st in self.armed_ns and self.waited_ns(st, now_ns) > self.deadline_ns(st, slack_ns)
+
+    def trip(self, st, now_ns, slack_ns, **detail):
+        alarm = {"station": st, "sim_time_s": now_ns / 1e9,
+                 "waited_s": self.waited_ns(st, now_ns) / 1e9,
+                 "deadline_s": self.deadline_ns(st, slack_ns) / 1e9,
+                 "samples": len(self.samples[st])}
+        alarm.update(detail)
+        self.alarm_count[st] += 1
+        self.alarms.append(alarm)
+        self.armed_ns.pop(st, None)
+        return alarm
+
+    def summary(self, slack_ns=0):
+        return {
+            "deadline_s": {st: self.deadline_ns(st, slack_ns) / 1e9 for st in STATIONS},
+            "learned": {st: len(self.samples[st]) >= WATCHDOG_MIN_SAMPLES for st in STATIONS},
+            "alarms": dict(self.alarm_count),
+            "last_alarm": dict(self.alarms[-1]) if self.alarms else None,
+        }
+
+
+# Per-unit genealogy: units that left the line are kept for lead-time stats
+UNIT_HISTORY = 500
+
+
+class _Unit:
+    """One physical unit: serial number, recipe, per-station entry/exit times, outcome."""
+
+    __slots__ = ("uid", "recipe_id", "created_ns", "enter_ns", "exit_ns", "outcome", "restarts")
+
+    def __init__(self, uid, recipe_id, now_ns):
+        self.uid = uid
+        self.recipe_id = recipe_id
+        self.created_ns = now_ns
+        self.enter_ns = {}
+        self.exit_ns = {}
+        self.outcome = None
+        self.restarts = 0
+
+    def record(self, left_ns):
+        return {
+            "uid": self.uid,
+            "recipe_id": self.recipe_id,
+            "created_s": self.created_ns / 1e9,
+            "left_s": left_ns / 1e9,
+            "enter_s": {st: t / 1e9 for st, t in self.enter_ns.items()},
+            "exit_s": {st: t / 1e9 for st, t in self.exit_ns.items()},
+            "outcome": self.outcome,
+            "restarts": self.restarts,
+        }
+
+
+class _WipTracker:
+    """
+    Unit records behind the PLC's buffer counters: a FIFO per buffer, the
+    unit in each station, and lead-time / Little's-law figures for the units
+    that have left the line (finished or lost). WIP is time-weighted with the
+    same left-point rule as _FlowStats. Every departure also goes to steady,
+    if given: add(left_s, outcome, lead_s), as steady_state.SteadyStateEstimator
+    (warm-up truncated KPIs with confidence intervals).
+    """
+
+    def __init__(self, steady=None):
+        self.next_uid = 1
+        self.fifo = {b: deque() for b in BUFFERS}
+        self.at = {st: None for st in STATIONS}
+        self.history = deque(maxlen=UNIT_HISTORY)
+        self.departed = 0
+        self.completed = 0
+        self.lost = 0
+        self.sojourn_ns = 0
+        self.t0_ns = None
+        self.last_ns = None
+        self.wip_ns = 0
+        self._wip = 0
+        self.steady = steady
+
+    def wip(self):
+        return sum(len(q) for q in self.fifo.values()) + sum(1 for u in self.at.values() if u is not None)
+
+    def batch_id(self, st, default):
+        """Serial number to show station st: its current unit, else the next one queued for it."""
+        u = self.at[st]
+        if u is not None:
+            return u.uid
+        k = STATIONS.index(st)
+        if k == 0:
+            return self.next_uid
+        q = self.fifo[BUFFERS[k - 1]]
+        return q[0].uid if q else default
+
+    def start(self, st, now_ns, recipe_id):
+        k = STATIONS.index(st)
+        q = self.fifo[BUFFERS[k - 1]] if k > 0 else None
+        if q:
+            u = q.popleft()
+        else:
+            u = _Unit(self.next_uid, recipe_id, now_ns)
+            self.next_uid += 1
+        u.enter_ns[st] = now_ns
+        self.at[st] = u
+        return u
+
+    def finish(self, st, now_ns, outcome=None, done_ns=None, cycle_ns=0):
+        """
+        done_ns/cycle_ns: the station's own completion time and cycle length.
+        When they fit inside this visit they replace the scan-quantised times
+        (the start pulse and the scan that saw done) in the unit's record.
+        """
+        u = self.at[st]
+        if u is None:
+            return None
+        self.at[st] = None
+        t_in = u.enter_ns.get(st, now_ns)
+        t_out = done_ns if done_ns is not None and t_in <= done_ns <= now_ns else now_ns
+        if cycle_ns and t_in <= t_out - cycle_ns:
+            u.enter_ns[st] = t_out - cycle_ns
+        u.exit_ns[st] = t_out
+        if outcome is not None:
+            u.outcome = outcome
+        k = STATIONS.index(st)
+        if k + 1 < len(STATIONS):
+            self.fifo[BUFFERS[k]].append(u)
+        else:
+            self._depart(u, now_ns, u.outcome or "completed", left_ns=t_out)
+        return u
+
+    def requeue(self, st, now_ns):
+        """The station lost its unit in a reset: back to the head of its input buffer (S1: scrapped)."""
+        u = self.at[st]
+        if u is None:
+            return None
+        self.at[st] = None
+        u.enter_ns.pop(st, None)
+        u.restarts += 1
+        k = STATIONS.index(st)
+        if k > 0:
+            self.fifo[BUFFERS[k - 1]].appendleft(u)
+        else:
+            self._depart(u, now_ns, "scrapped")
+        return u
+
+    def lose_all(self, now_ns):
+        for q in self.fifo.values():
+            while q:
+                self._depart(q.popleft(), now_ns, "lost")
+        for st, u in self.at.items():
+            if u is not None:
+                self.at[st] = None
+                self._depart(u, now_ns, "lost")
+
+    def _depart(self, u, now_ns, outcome, left_ns=None):
+        u.outcome = outcome
+        self.departed += 1
+        if outcome in ("lost", "scrapped"):
+            self.lost += 1
+        else:
+            self.completed += 1
+        # Little's law stays on the scan timeline the WIP integral uses
+        self.sojourn_ns += now_ns - u.created_ns
+        left_ns = now_ns if left_ns is None else left_ns
+        self.history.append(u.record(left_ns))
+        if self.steady is not None:
+            self.steady.add(left_ns / 1e9, outcome, (left_ns - u.enter_ns.get("S1", u.created_ns)) / 1e9)
+
+    def update(self, now_ns):
+        if self.last_ns is None:
+            self.t0_ns = now_ns
+        else:
+            self.wip_ns += self._wip * max(0, now_ns - self.last_ns)
+        self.last_ns = now_ns
+        self._wip = self.wip()
+
+    def summary(self):
+        done = [r for r in self.history if r["outcome"] not in ("lost", "scrapped")]
+        lead = sorted(r["left_s"] - r["enter_s"].get("S1", r["created_s"]) for r in done)
+        queue = [sum(r["enter_s"][b] - r["exit_s"][a] for a, b in zip(STATIONS, STATIONS[1:])
+                     if a in r["exit_s"] and b in r["enter_s"]) for r in done]
+
+        def pct(q):
+            return lead[min(len(lead) - 1, int(q * len(lead)))] if lead else 0.0
+
+        elapsed = (self.last_ns - self.t0_ns) if self.last_ns is not None else 0
+        L = self.wip_ns / elapsed if elapsed > 0 else 0.0
+        lam = self.departed / (elapsed / 1e9) if elapsed > 0 else 0.0
+        W = (self.sojourn_ns / self.departed) / 1e9 if self.departed else 0.0
+        return {
+            "wip": self.wip(),
+            "units_started": self.next_uid - 1,
+            "units_completed": self.completed,
+            "units_lost": self.lost,
+            "lead_time_s": {
+                "count": len(lead),
+                "mean": sum(lead) / len(lead) if lead else 0.0,
+                "p50": pct(0.50), "p90": pct(0.90), "p99": pct(0.99),
+                "max": lead[-1] if lead else 0.0,
+            },
+            "queue_time_s_mean": sum(queue) / len(queue) if queue else 0.0,
+            # L = lambda * W over the whole run; units still inside at the end are the residual
+            "littles_law": {
+                "L": L,
+                "lambda_per_s": lam,
+                "W_s": W,
+                "lambda_W": lam * W,
+                "rel_error": abs(L - lam * W) / L if L > 0 else 0.0,
+            },
+        }
+
 
 def _set_context(ms, st, batch_id, recipe_id):
     setattr(ms, f"{st}_batch_id", int(batch_id))
@@ -186,6 +509,258 @@ def _reset_all(ms):
 
 def _any_fault(ms):
     return any(_get(ms, st, "fault") for st in STATIONS)
+
+
+# ---- PLC options ----
+# main() is generated and only parses --domain/--server-url. The coordinator's
+# own options are read from $PLC_OPTIONS, written as on a command line:
+#   PLC_OPTIONS="--metrics-port 9108 --profile-scan" python PLC_LineCoordinator.py
+# Attributes already set on args win (headless_line passes them that way).
+def _add_plc_options(ap):
+    ap.add_argument('--metrics-port', metavar='P', type=int, default=0, help='serve OpenMetrics on http://127.0.0.1:P/metrics (0 = disabled)')
+    ap.add_argument('--profile-scan', action='store_true', help='time each scan phase; summary at shutdown, live via --metrics-port')
+    ap.add_argument('--profile-out', metavar='PATH', default='', help='also write the scan profile summary as JSON')
+    ap.add_argument('--kpi-bus', metavar='PATH', default='', help='publish KPIs each scan to a shared-memory region (see kpi_bus.py)')
+    ap.add_argument('--live-params', action='store_true', help='apply opt_dashboard parameter changes at each scan boundary')
+    ap.add_argument('--local-recovery', action='store_true', help='on a fault reset only the faulted station and keep WIP (fault_reset_all=0)')
+    ap.add_argument('--fast-handoff', action='store_true', help='send the next START pulse in the same scan the upstream done is latched')
+    ap.add_argument('--target-precision', metavar='REL', type=float, default=0.0, help='end the simulation once the steady-state KPIs reach this relative 95%% half-width, e.g. 0.05 (see run_control.py)')
+    ap.add_argument('--min-units', metavar='N', type=int, default=None, help='post-warm-up units before --target-precision may stop the run (default 100, about 3.5 h of line time at the serial rate)')
+    ap.add_argument('--precision-kpis', metavar='KPIS', default='throughput_per_min', help='KPIs for --target-precision: throughput_per_min, cycle_time_s, yield_pct (comma separated)')
+    ap.add_argument('--opt-port', metavar='P', type=int, default=0, help='serve the optimisation dashboard on port P in this process (implies --live-params)')
+
+
+def _plc_options(args):
+    ap = argparse.ArgumentParser("PLC_OPTIONS")
+    _add_plc_options(ap)
+    opts = ap.parse_args(shlex.split(os.environ.get("PLC_OPTIONS", "")))
+    for k, v in vars(args).items():
+        setattr(opts, k, v)
+    return opts
+
+
+class _PlcMethods:
+    """
+    The coordinator's own PLC_LineCoordinator methods. The class body is
+    generated, so they live here and the constructor binds them to the
+    instance.
+    """
+
+    def _attach_params(self):
+        """Hook up opt_dashboard params and publish the effective startup values to it."""
+        import opt_dashboard
+        if self._opt_port and not getattr(opt_dashboard, "_srv_started", False):
+            opt_dashboard.start_in_thread(port=self._opt_port)
+            print(f"PLC: optimisation dashboard on port {self._opt_port}")
+        opt_dashboard.set_params({"reset_pulse_ticks": self._reset_pulse_ticks, "run_enable": self._run_enable,
+                                  "fault_reset_all": self._fault_reset_all, "fast_handoff": self._fast_handoff})
+        self._params_src = opt_dashboard
+        self._params_version, _ = opt_dashboard.params_snapshot()
+        print(f"PLC: live params attached (version {self._params_version})")
+
+    def _poll_params(self):
+        """Scan-boundary check: one locked snapshot, applied only when the version moved."""
+        version, p = self._params_src.params_snapshot()
+        if version != self._params_version:
+            self._params_version = version
+            self.apply_params(p)
+
+    def apply_params(self, p):
+        """
+        Apply a params snapshot between scans. Safe mid-run by construction:
+        a new reset pulse length counts from the current tick, run_enable
+        only gates feeding S1, and fast_handoff only changes when the next
+        START pulse goes out. buf_max / operators_* in the snapshot are
+        ignored: the serial controller never fills a buffer (see BUFFERS)
+        and does not model operators.
+        """
+        changed = []
+        ticks = max(1, int(p.get("reset_pulse_ticks", self._reset_pulse_ticks)))
+        if ticks != self._reset_pulse_ticks:
+            self._reset_pulse_ticks = ticks
+            changed.append(f"reset_pulse_ticks={ticks}")
+
+        for key, attr in (("run_enable", "_run_enable"), ("fault_reset_all", "_fault_reset_all"),
+                          ("fast_handoff", "_fast_handoff")):
+            v = bool(p.get(key, getattr(self, attr)))
+            if v != getattr(self, attr):
+                setattr(self, attr, v)
+                changed.append(f"{key}={int(v)}")
+
+        if changed:
+            print(f"PLC: params v{self._params_version} applied: {', '.join(changed)}")
+        return changed
+
+    def _watchdog_trip(self, st, ms, now_ns, slack_ns):
+        """
+        A station missed its deadline: raise an alarm with enough context to
+        diagnose it and recover it like a fault. No unit is credited
+        downstream.
+        """
+        alarm = self._wd.trip(st, now_ns, slack_ns, state=self._state,
+                              ready=int(_get(ms, st, "ready")), busy=int(_get(ms, st, "busy")),
+                              fault=int(_get(ms, st, "fault")), done_latched=bool(self._done_latched[st]),
+                              buffers=dict(self._buffers), batch_id=self._batch_id)
+        print(f"PLC: ALARM watchdog {st}: no done after {alarm['waited_s']:.1f}s "
+              f"(deadline {alarm['deadline_s']:.1f}s from {alarm['samples']} cycles), "
+              f"ready={alarm['ready']} busy={alarm['busy']} fault={alarm['fault']}")
+        self._enter_fault_recovery(ms, {st})
+
+    def _enter_fault_recovery(self, ms, stations):
+        """
+        fault_reset_all: reset every station and drain the line (FAULT_RESET).
+        Otherwise reset only `stations` and keep buffers, latches and the
+        rest of the line as they are. A unit that was in flight on a faulted
+        station goes back into its input buffer and is restarted; one that
+        had already finished stays latched.
+        """
+        self._reset_ticks = 0
+        if self._fault_reset_all:
+            print(f"PLC: Fault on {', '.join(sorted(stations))}, entering FAULT_RESET state")
+            self._state = "FAULT_RESET"
+            self._fault_stations = set(stations)
+            self._recovery_count["line"] += 1
+            self._recovering = "line"
+            return
+
+        if self._state == "LOCAL_WAIT_READY":
+            # another fault before the last recovery finished: widen it, keep the resume point
+            stations = set(stations) | self._fault_stations
+        else:
+            self._resume_state = self._state
+            self._recovery_count["local"] += 1
+        self._recovering = "local"
+        self._fault_stations = set(stations)
+
+        resume = self._resume_state
+        if resume.startswith("WAIT_S") and resume[5:7] in self._fault_stations:
+            st = resume[5:7]
+            if self._fresh_done(ms, st) and not self._done_latched[st]:
+                # done and fault in the same scan: the unit is finished, keep it
+                self._done_latched[st] = True
+                self._wd.observe_done(st, self._done_ns(ms, st, vsiCommonPythonApi.getSimulationTimeInNs()))
+            if not self._done_latched[st]:
+                k = STATIONS.index(st)
+                if k > 0:
+                    self._buffers[BUFFERS[k - 1]] += 1
+                self._wip.requeue(st, vsiCommonPythonApi.getSimulationTimeInNs())
+                self._resume_state = f"START_{st}"
+                print(f"PLC: {st} lost its unit, requeued for restart")
+        for st in self._fault_stations:
+            if self._resume_state != f"WAIT_{st}_DONE":
+                self._done_latched[st] = False
+                self._wd.disarm(st)
+            self._start_sent[st] = False
+            self._prev_done[st] = False
+        print(f"PLC: Fault on {', '.join(sorted(self._fault_stations))}, local recovery "
+              f"(line resumes at {self._resume_state})")
+        self._state = "LOCAL_RESET"
+
+    def _start_station(self, ms, st, now_ns, handoff=False):
+        """
+        START_<st>: clear all start commands, then pulse st once it is ready,
+        idle, not faulted and (S2..S6) has a unit in its input buffer, and
+        move to WAIT_<st>_DONE. Otherwise the line stays in START_<st> and
+        the state retries on the next scan. handoff=True is the
+        --fast-handoff call in the scan that entered START_<st>.
+        """
+        k = STATIONS.index(st)
+        src = BUFFERS[k - 1] if k > 0 else None
+        for s in STATIONS:
+            _set_cmd(ms, s, start=0, stop=0, reset=0)
+
+        ready = _get(ms, st, "ready")
+        busy = _get(ms, st, "busy")
+        fault = _get(ms, st, "fault")
+        buf = f", buffer={self._buffers[src]}" if src is not None else ""
+        print(f"  {st} start check: ready={ready}, busy={busy}, fault={fault}{buf}")
+
+        if st == "S1" and not self._run_enable:
+            # run_enable off: units already in the line finish, no new unit is fed
+            print("PLC: run_enable=0, holding S1")
+            return False
+        if not ready or busy or fault or (src is not None and self._buffers[src] <= 0):
+            print(f"PLC: {st} not ready to start")
+            return False
+        if self._start_sent[st]:
+            print(f"PLC: {st} start already sent, waiting...")
+            return False
+
+        print(f"PLC: START pulse -> {st}" + (" (same-scan handoff)" if handoff else ""))
+        _set_cmd(ms, st, start=1, stop=0, reset=0)
+        self._start_sent[st] = True
+        self._state = f"WAIT_{st}_DONE"
+        self._wd.arm(st, now_ns)
+        self._wip.start(st, now_ns, self._recipe_id)
+        if src is not None:
+            self._buffers[src] = max(0, self._buffers[src] - 1)
+            print(f"PLC: Consumed {src} buffer, now {self._buffers[src]}")
+        if handoff:
+            self._fast_handoffs += 1
+        return True
+
+    def _done_ns(self, ms, st, now_ns):
+        """Completion time the station reported with done (done_time_ns), else this scan."""
+        t = int(_get(ms, st, "done_time_ns") or 0)
+        return t if 0 < t <= now_ns else now_ns
+
+    def _fresh_done(self, ms, st):
+        """
+        done is high and belongs to a completion not handed on yet. done stays
+        up for the whole scan that consumed it, so without the timestamp the
+        safety latch would latch it again for the next unit.
+        """
+        if not _get(ms, st, "done"):
+            return False
+        t = int(_get(ms, st, "done_time_ns") or 0)
+        return t == 0 or t != self._done_taken_ns[st]
+
+    def _finish_unit(self, ms, st, now_ns, outcome=None):
+        """Hand the unit on with the station's own start/finish times instead of scan times."""
+        self._done_taken_ns[st] = int(_get(ms, st, "done_time_ns") or 0)
+        return self._wip.finish(st, now_ns, outcome, done_ns=self._done_ns(ms, st, now_ns),
+                                cycle_ns=int(_get(ms, st, "cycle_time_ms") or 0) * 1_000_000)
+
+    def recovery_summary(self):
+        return {
+            "mode": "line" if self._fault_reset_all else "local",
+            "count": dict(self._recovery_count),
+            "seconds": {m: ns / 1e9 for m, ns in self._recovery_ns.items()},
+            "active": self._recovering,
+        }
+
+    def watchdog_summary(self):
+        return self._wd.summary(2 * int(self.simulationStep))
+
+    def bottleneck_summary(self):
+        return self._bneck.summary()
+
+    def wip_summary(self):
+        return self._wip.summary()
+
+    def steady_state_summary(self):
+        t0_ns = self._wip.t0_ns
+        return self._wip.steady.summary(t0_ns / 1e9 if t0_ns is not None else 0.0)
+
+    def recent_units(self, n=50):
+        """Genealogy of the last n units that left the line (newest last)."""
+        return list(self._wip.history)[-int(n):]
+
+    def flow_summary(self):
+        return self._flow.summary()
+
+    def _dump_scan_profile(self):
+        if self._prof is None:
+            return
+        self._prof.finish()
+        print(self._prof.format_summary())
+        if self._profile_out:
+            try:
+                self._prof.write_json(self._profile_out)
+                print(f"PLC: scan profile written to {self._profile_out}")
+            except OSError as e:
+                print(f"PLC: could not write scan profile: {e}")
+
 # End of user custom code region.
 
 
@@ -212,6 +787,12 @@ class PLC_LineCoordinator:
         self.mySignals = MySignals()
 
         # Start of user custom code region. Please apply edits only within these regions:  Constructor
+        # PLC options ($PLC_OPTIONS) and the methods in _PlcMethods
+        args = _plc_options(args)
+        for name, fn in vars(_PlcMethods).items():
+            if isinstance(fn, types.FunctionType):
+                setattr(self, name, types.MethodType(fn, self))
+
         # coordinator internal state
         self._batch_id = 1
         self._recipe_id = 1
@@ -270,13 +851,72 @@ class PLC_LineCoordinator:
         self._debug_override_active = False
         self._debug_override_done = False
         
-        # Timeout counters for stuck stations
-        self._s1_wait_counter = 0
-        self._s2_wait_counter = 0
-        self._s3_wait_counter = 0
-        self._s4_wait_counter = 0
-        self._s5_wait_counter = 0
-        self._s6_wait_counter = 0
+        # Sim-time watchdogs for stuck stations
+        self._wd = _Watchdog()
+
+        # Per-unit records behind the buffer counters, feeding the steady-state estimator
+        import steady_state
+        self._new_estimator = steady_state.SteadyStateEstimator
+        self._wip = _WipTracker(self._new_estimator())
+        # done_time_ns of the last completion handed on, per station (0 = station sends none)
+        self._done_taken_ns = {st: 0 for st in STATIONS}
+
+        # Optional OpenMetrics exporter (--metrics-port, 0 = off)
+        self._metrics_port = int(getattr(args, "metrics_port", 0) or 0)
+        self._metrics = None
+
+        # Optional scan-phase profiler (--profile-scan); the summary is printed when mainThread() returns
+        self._profile_scan = bool(getattr(args, "profile_scan", False))
+        self._profile_out = getattr(args, "profile_out", "") or ""
+        self._prof = None
+        if self._profile_scan:
+            main_thread = self.mainThread
+
+            def _profiled_main_thread():
+                try:
+                    main_thread()
+                finally:
+                    self._dump_scan_profile()
+            self.mainThread = _profiled_main_thread
+
+        # Flow accounting: buffer occupancy and idle time
+        self._flow = _FlowStats()
+
+        # Online bottleneck detection (active-period method, sliding windows)
+        import line_bottleneck
+        self._bneck = line_bottleneck.ActivePeriodDetector(STATIONS)
+
+        # Sequential run-length control (--target-precision, 0 = run to totalSimulationTime)
+        self._precision = None
+        target = float(getattr(args, "target_precision", 0) or 0)
+        if target > 0:
+            import run_control
+            kpis = [k.strip() for k in str(getattr(args, "precision_kpis", "") or "").split(",") if k.strip()]
+            min_units = getattr(args, "min_units", None)
+            self._precision = run_control.PrecisionMonitor(
+                target, kpis or run_control.DEFAULT_KPIS,
+                min_units=run_control.MIN_UNITS if min_units is None else min_units)
+
+        # Optional shared-memory KPI bus (--kpi-bus PATH)
+        self._kpi_bus_path = getattr(args, "kpi_bus", "") or ""
+        self._kpi_bus = None
+
+        # Live tuning from opt_dashboard params (--live-params; --opt-port also serves the UI)
+        self._opt_port = int(getattr(args, "opt_port", 0) or 0)
+        self._live_params = bool(getattr(args, "live_params", False)) or self._opt_port > 0
+        self._params_src = None
+        self._params_version = -1
+        self._reset_pulse_ticks = RESET_PULSE_TICKS
+        self._local_recovery = bool(getattr(args, "local_recovery", False))
+        self._fault_reset_all = not self._local_recovery
+        self._fault_stations = set()
+        self._resume_state = None
+        self._recovering = None
+        self._recovery_count = {"line": 0, "local": 0}
+        self._recovery_ns = {"line": 0, "local": 0}
+        # Zero-scan handoff (--fast-handoff): start the next station in the scan its unit arrives
+        self._fast_handoff = bool(getattr(args, "fast_handoff", False))
+        self._fast_handoffs = 0
         # End of user custom code region.
 
 
@@ -295,6 +935,12 @@ class PLC_LineCoordinator:
             self._state = "RESET_ALL"
             self._reset_ticks = 0
             self._run_enable = True
+            self._reset_pulse_ticks = RESET_PULSE_TICKS
+            self._fault_reset_all = not self._local_recovery
+            self._fault_stations = set()
+            self._resume_state = None
+            self._recovering = None
+            self._fast_handoffs = 0
 
             # Virtual buffers (tokens) between stations
             self._buffers = {
@@ -319,13 +965,10 @@ class PLC_LineCoordinator:
             self._s5_accept_total = 0
             self._s5_reject_total = 0
             
-            # Timeout counters
-            self._s1_wait_counter = 0
-            self._s2_wait_counter = 0
-            self._s3_wait_counter = 0
-            self._s4_wait_counter = 0
-            self._s5_wait_counter = 0
-            self._s6_wait_counter = 0
+            # Sim-time watchdogs
+            self._wd = _Watchdog()
+            self._wip = _WipTracker(self._new_estimator())
+            self._done_taken_ns = {st: 0 for st in STATIONS}
 
             # Pulse reset on all stations at sim start
             _reset_all(self.mySignals)
@@ -340,6 +983,25 @@ class PLC_LineCoordinator:
                 
             print("PLC: Initialized with full 6-station state machine")
             print("PLC: Pipeline flow: S1 -> S2 -> S3 -> S4 -> S5 -> S6 -> FINISH")
+
+            if self._metrics_port and self._metrics is None:
+                import metrics_exporter
+                metrics_exporter.start_in_thread(port=self._metrics_port)
+                self._metrics = metrics_exporter
+
+            if self._profile_scan and self._prof is None:
+                import scan_profiler
+                self._prof = scan_profiler.ScanProfiler()
+                if self._metrics is not None:
+                    self._metrics.register_collector(self._prof.openmetrics_lines)
+
+            if self._kpi_bus_path and self._kpi_bus is None:
+                import kpi_bus
+                self._kpi_bus = kpi_bus.KpiBusWriter(self._kpi_bus_path)
+                print(f"PLC: publishing KPIs on {self._kpi_bus_path}")
+
+            if self._live_params:
+                self._attach_params()
             # End of user custom code region.
             self.updateInternalVariables()
 
@@ -388,30 +1050,35 @@ class PLC_LineCoordinator:
                     self.decapsulateReceivedData(receivedData)
 
                 # Start of user custom code region. Please apply edits only within these regions:  Before sending the packet
+                if self._prof is not None:
+                    self._prof.begin_scan()
                 ms = self.mySignals
                 self._scan_count += 1
-                self._sim_time_s = vsiCommonPythonApi.getSimulationTimeInNs() / 1e9
+                now_ns = vsiCommonPythonApi.getSimulationTimeInNs()
+                self._sim_time_s = now_ns / 1e9
+                wd_slack = 2 * int(self.simulationStep)
+                if self._params_src is not None:
+                    self._poll_params()
 
                 # 1) PRINT PLC STATE EVERY SCAN
                 print(f"\n=== PLC SCAN {self._scan_count} ===")
                 print(f"PLC state={self._state} step={self.simulationStep}ns run_enable={self._run_enable}")
                 print(f"Sim time: {self._sim_time_s:.3f}s")
 
-                # Keep station context updated
-                for st in STATIONS:
-                    _set_context(ms, st, self._batch_id, self._recipe_id)
+                state_in = self._state
 
                 # ---- FAULT handling ----
-                if _any_fault(ms) and self._state != "FAULT_RESET":
-                    print("PLC: Fault detected, entering FAULT_RESET state")
-                    self._state = "FAULT_RESET"
-                    self._reset_ticks = 0
+                if self._recovering:
+                    self._recovery_ns[self._recovering] += int(self.simulationStep)
+                faulted = {st for st in STATIONS if _get(ms, st, "fault")}
+                if faulted and self._state not in ("FAULT_RESET", "LOCAL_RESET"):
+                    self._enter_fault_recovery(ms, faulted)
 
                 # ---- RESET_ALL / FAULT_RESET ----
                 if self._state in ("RESET_ALL", "FAULT_RESET"):
                     _reset_all(ms)
                     self._reset_ticks += 1
-                    print(f"PLC: In {self._state} state, tick {self._reset_ticks}/{RESET_PULSE_TICKS}")
+                    print(f"PLC: In {self._state} state, tick {self._reset_ticks}/{self._reset_pulse_ticks}")
 
                     # Clear pipeline state while resetting
                     for k in self._buffers:
@@ -420,21 +1087,44 @@ class PLC_LineCoordinator:
                     self._done_latched = {st: False for st in STATIONS}
                     self._prev_done = {st: False for st in STATIONS}
                     self._start_sent = {st: False for st in STATIONS}
-                    # Reset timeout counters
-                    self._s1_wait_counter = 0
-                    self._s2_wait_counter = 0
-                    self._s3_wait_counter = 0
-                    self._s4_wait_counter = 0
-                    self._s5_wait_counter = 0
-                    self._s6_wait_counter = 0
-
-                    if self._reset_ticks >= RESET_PULSE_TICKS:
+                    # Nothing in flight after a reset
+                    self._wd.disarm_all()
+                    self._wip.lose_all(now_ns)
+
+                    if self._reset_ticks >= self._reset_pulse_ticks:
                         # Deassert reset/stop when entering RUN
                         for st in STATIONS:
                             _set_cmd(ms, st, start=0, stop=0, reset=0)
                         self._state = "WAIT_ALL_READY"
                         print("PLC: Entering WAIT_ALL_READY state")
 
+                # ---- LOCAL_RESET: reset only the faulted stations, WIP stays put ----
+                elif self._state == "LOCAL_RESET":
+                    self._fault_stations |= faulted
+                    for st in self._fault_stations:
+                        _reset_station(ms, st)
+                    self._reset_ticks += 1
+                    print(f"PLC: In LOCAL_RESET {sorted(self._fault_stations)}, tick {self._reset_ticks}/{self._reset_pulse_ticks}")
+
+                    if self._reset_ticks >= self._reset_pulse_ticks:
+                        for st in self._fault_stations:
+                            _set_cmd(ms, st, start=0, stop=0, reset=0)
+                        self._state = "LOCAL_WAIT_READY"
+                        print("PLC: Entering LOCAL_WAIT_READY state")
+
+                # ---- LOCAL_WAIT_READY: faulted stations back up, then resume where we were ----
+                elif self._state == "LOCAL_WAIT_READY":
+                    pending = [st for st in sorted(self._fault_stations)
+                               if not _get(ms, st, "ready") or _get(ms, st, "busy") or _get(ms, st, "fault")]
+                    if pending:
+                        print(f"PLC: Waiting for {', '.join(pending)} after local reset...")
+                    else:
+                        print(f"PLC: {', '.join(sorted(self._fault_stations))} recovered -> resuming {self._resume_state}")
+                        self._state = self._resume_state
+                        self._fault_stations = set()
+                        self._resume_state = None
+                        self._recovering = None
+
                 # ---- WAIT_ALL_READY: Wait for all stations to be ready ----
                 elif self._state == "WAIT_ALL_READY":
                     # Check if all stations are ready (not busy, no fault)
@@ -450,32 +1140,13 @@ class PLC_LineCoordinator:
                     if all_ready:
                         print("PLC: All 6 stations ready, moving to START_S1")
                         self._state = "START_S1"
+                        self._recovering = None
                     else:
                         print("PLC: Waiting for stations to be ready...")
 
                 # ---- START_S1: Send start pulse to S1 ----
                 elif self._state == "START_S1":
-                    # Clear all start commands first
-                    for st in STATIONS:
-                        _set_cmd(ms, st, start=0, stop=0, reset=0)
-                    
-                    # Check if S1 is ready to start
-                    s1_ready = _get(ms, "S1", "ready")
-                    s1_busy = _get(ms, "S1", "busy")
-                    s1_fault = _get(ms, "S1", "fault")
-                    
-                    print(f"  S1 start check: ready={s1_ready}, busy={s1_busy}, fault={s1_fault}")
-                    
-                    if (s1_ready and not s1_busy and not s1_fault):
-                        if not self._start_sent["S1"]:
-                            print("PLC: START pulse -> S1")
-                            _set_cmd(ms, "S1", start=1, stop=0, reset=0)
-                            self._start_sent["S1"] = True
-                            self._state = "WAIT_S1_DONE"
-                        else:
-                            print("PLC: S1 start already sent, waiting...")
-                    else:
-                        print(f"PLC: S1 not ready to start")
+                    self._start_station(ms, "S1", now_ns)
 
                 # ---- WAIT_S1_DONE: Wait for S1 to complete ----
                 elif self._state == "WAIT_S1_DONE":
@@ -483,67 +1154,34 @@ class PLC_LineCoordinator:
                     _set_cmd(ms, "S1", start=0, stop=0, reset=0)
                     
                     # Latch S1 done
-                    s1_done = _get(ms, "S1", "done")
+                    s1_done = self._fresh_done(ms, "S1")
                     if s1_done and not self._done_latched["S1"]:
                         print("PLC: S1 done seen (raw) -> latching")
                         self._done_latched["S1"] = True
+                        self._wd.observe_done("S1", self._done_ns(ms, "S1", now_ns))
                     
                     # If S1 done is latched and S1 is no longer busy, advance
                     s1_busy = _get(ms, "S1", "busy")
                     s1_ready = _get(ms, "S1", "ready")
                     
-                    # Timeout counter
-                    self._s1_wait_counter += 1
-                    
                     if (self._done_latched["S1"] and not s1_busy and s1_ready):
                         print("PLC: S1 done latched -> advancing to START_S2")
                         self._done_latched["S1"] = False
                         self._start_sent["S1"] = False
                         self._state = "START_S2"
-                        self._s1_wait_counter = 0
                         
                         # Buffer S1->S2
-                        self._buffers["S1_to_S2"] = min(self._buffers["S1_to_S2"] + 1, BUF_MAX)
+                        self._buffers["S1_to_S2"] += 1
+                        self._finish_unit(ms, "S1", now_ns)
                         print(f"PLC: Incremented S1_to_S2 buffer to {self._buffers['S1_to_S2']}")
-                    elif self._s1_wait_counter > 15:  #~10 seconds for S1
-                        print(f"PLC: TIMEOUT - S1 stuck for {self._s1_wait_counter} scans, forcing advance")
-                        self._done_latched["S1"] = False
-                        self._start_sent["S1"] = False
-                        self._state = "START_S2"
-                        self._s1_wait_counter = 0
-                        # Assume work was done
-                        self._buffers["S1_to_S2"] = min(self._buffers["S1_to_S2"] + 1, BUF_MAX)
-                        print(f"PLC: Forced S1_to_S2 buffer to {self._buffers['S1_to_S2']}")
+                    elif self._wd.expired("S1", now_ns, wd_slack):
+                        self._watchdog_trip("S1", ms, now_ns, wd_slack)
                     else:
-                        print(f"  WAIT_S1_DONE: done_latched={self._done_latched['S1']}, busy={s1_busy}, ready={s1_ready}, timeout={self._s1_wait_counter}/30")
+                        print(f"  WAIT_S1_DONE: done_latched={self._done_latched['S1']}, busy={s1_busy}, ready={s1_ready}, waited={self._wd.waited_ns('S1', now_ns) / 1e9:.1f}/{self._wd.deadline_ns('S1', wd_slack) / 1e9:.1f}s")
 
                 # ---- START_S2: Send start pulse to S2 ----
                 elif self._state == "START_S2":
-                    # Clear all start commands
-                    for st in STATIONS:
-                        _set_cmd(ms, st, start=0, stop=0, reset=0)
-                    
-                    # Check if S2 is ready and has work from S1
-                    s2_ready = _get(ms, "S2", "ready")
-                    s2_busy = _get(ms, "S2", "busy")
-                    s2_fault = _get(ms, "S2", "fault")
-                    
-                    print(f"  S2 start check: ready={s2_ready}, busy={s2_busy}, fault={s2_fault}, buffer={self._buffers['S1_to_S2']}")
-                    
-                    if (s2_ready and not s2_busy and not s2_fault and self._buffers["S1_to_S2"] > 0):
-                        if not self._start_sent["S2"]:
-                            print("PLC: START pulse -> S2")
-                            _set_cmd(ms, "S2", start=1, stop=0, reset=0)
-                            self._start_sent["S2"] = True
-                            self._state = "WAIT_S2_DONE"
-                            
-                            # Consume buffer
-                            self._buffers["S1_to_S2"] = max(0, self._buffers["S1_to_S2"] - 1)
-                            print(f"PLC: Consumed S1_to_S2 buffer, now {self._buffers['S1_to_S2']}")
-                        else:
-                            print("PLC: S2 start already sent, waiting...")
-                    else:
-                        print(f"PLC: S2 not ready to start")
+                    self._start_station(ms, "S2", now_ns)
 
                 # ---- WAIT_S2_DONE: Wait for S2 to complete ----
                 elif self._state == "WAIT_S2_DONE":
@@ -551,66 +1189,34 @@ class PLC_LineCoordinator:
                     _set_cmd(ms, "S2", start=0, stop=0, reset=0)
                     
                     # Latch S2 done
-                    s2_done = _get(ms, "S2", "done")
+                    s2_done = self._fresh_done(ms, "S2")
                     if s2_done and not self._done_latched["S2"]:
                         print("PLC: S2 done seen (raw) -> latching")
                         self._done_latched["S2"] = True
+                        self._wd.observe_done("S2", self._done_ns(ms, "S2", now_ns))
                     
                     # If S2 done is latched and S2 is no longer busy, advance
                     s2_busy = _get(ms, "S2", "busy")
                     s2_ready = _get(ms, "S2", "ready")
                     
-                    # Timeout counter
-                    self._s2_wait_counter += 1
-                    
                     if (self._done_latched["S2"] and not s2_busy and s2_ready):
                         print("PLC: S2 done latched -> advancing to START_S3")
                         self._done_latched["S2"] = False
                         self._start_sent["S2"] = False
                         self._state = "START_S3"
-                        self._s2_wait_counter = 0
                         
                         # Buffer S2->S3
-                        self._buffers["S2_to_S3"] = min(self._buffers["S2_to_S3"] + 1, BUF_MAX)
+                        self._buffers["S2_to_S3"] += 1
+                        self._finish_unit(ms, "S2", now_ns)
                         print(f"PLC: Incremented S2_to_S3 buffer to {self._buffers['S2_to_S3']}")
-                    elif self._s2_wait_counter > 15:  # 13 sec
-                        print(f"PLC: TIMEOUT - S2 stuck for {self._s2_wait_counter} scans, forcing advance")
-                        self._done_latched["S2"] = False
-                        self._start_sent["S2"] = False
-                        self._state = "START_S3"
-                        self._s2_wait_counter = 0
-                        self._buffers["S2_to_S3"] = min(self._buffers["S2_to_S3"] + 1, BUF_MAX)
-                        print(f"PLC: Forced S2_to_S3 buffer to {self._buffers['S2_to_S3']}")
+                    elif self._wd.expired("S2", now_ns, wd_slack):
+                        self._watchdog_trip("S2", ms, now_ns, wd_slack)
                     else:
-                        print(f"  WAIT_S2_DONE: done_latched={self._done_latched['S2']}, busy={s2_busy}, ready={s2_ready}, timeout={self._s2_wait_counter}/30")
+                        print(f"  WAIT_S2_DONE: done_latched={self._done_latched['S2']}, busy={s2_busy}, ready={s2_ready}, waited={self._wd.waited_ns('S2', now_ns) / 1e9:.1f}/{self._wd.deadline_ns('S2', wd_slack) / 1e9:.1f}s")
 
                 # ---- START_S3: Send start pulse to S3 ----
                 elif self._state == "START_S3":
-                    # Clear all start commands
-                    for st in STATIONS:
-                        _set_cmd(ms, st, start=0, stop=0, reset=0)
-                    
-                    # Check if S3 is ready and has work from S2
-                    s3_ready = _get(ms, "S3", "ready")
-                    s3_busy = _get(ms, "S3", "busy")
-                    s3_fault = _get(ms, "S3", "fault")
-                    
-                    print(f"  S3 start check: ready={s3_ready}, busy={s3_busy}, fault={s3_fault}, buffer={self._buffers['S2_to_S3']}")
-                    
-                    if (s3_ready and not s3_busy and not s3_fault and self._buffers["S2_to_S3"] > 0):
-                        if not self._start_sent["S3"]:
-                            print("PLC: START pulse -> S3")
-                            _set_cmd(ms, "S3", start=1, stop=0, reset=0)
-                            self._start_sent["S3"] = True
-                            self._state = "WAIT_S3_DONE"
-                            
-                            # Consume buffer
-                            self._buffers["S2_to_S3"] = max(0, self._buffers["S2_to_S3"] - 1)
-                            print(f"PLC: Consumed S2_to_S3 buffer, now {self._buffers['S2_to_S3']}")
-                        else:
-                            print("PLC: S3 start already sent, waiting...")
-                    else:
-                        print(f"PLC: S3 not ready to start")
+                    self._start_station(ms, "S3", now_ns)
 
                 # ---- WAIT_S3_DONE: Wait for S3 to complete ----
                 elif self._state == "WAIT_S3_DONE":
@@ -618,66 +1224,34 @@ class PLC_LineCoordinator:
                     _set_cmd(ms, "S3", start=0, stop=0, reset=0)
                     
                     # Latch S3 done
-                    s3_done = _get(ms, "S3", "done")
+                    s3_done = self._fresh_done(ms, "S3")
                     if s3_done and not self._done_latched["S3"]:
                         print("PLC: S3 done seen (raw) -> latching")
                         self._done_latched["S3"] = True
+                        self._wd.observe_done("S3", self._done_ns(ms, "S3", now_ns))
                     
                     # If S3 done is latched and S3 is no longer busy, advance
                     s3_busy = _get(ms, "S3", "busy")
                     s3_ready = _get(ms, "S3", "ready")
                     
-                    # Timeout counter
-                    self._s3_wait_counter += 1
-                    
                     if (self._done_latched["S3"] and not s3_busy and s3_ready):
                         print("PLC: S3 done latched -> advancing to START_S4")
                         self._done_latched["S3"] = False
                         self._start_sent["S3"] = False
                         self._state = "START_S4"
-                        self._s3_wait_counter = 0
                         
                         # Buffer S3->S4
-                        self._buffers["S3_to_S4"] = min(self._buffers["S3_to_S4"] + 1, BUF_MAX)
+                        self._buffers["S3_to_S4"] += 1
+                        self._finish_unit(ms, "S3", now_ns)
                         print(f"PLC: Incremented S3_to_S4 buffer to {self._buffers['S3_to_S4']}")
-                    elif self._s3_wait_counter > 15:  # Timeout
-                        print(f"PLC: TIMEOUT - S3 stuck for {self._s3_wait_counter} scans, forcing advance")
-                        self._done_latched["S3"] = False
-                        self._start_sent["S3"] = False
-                        self._state = "START_S4"
-                        self._s3_wait_counter = 0
-                        self._buffers["S3_to_S4"] = min(self._buffers["S3_to_S4"] + 1, BUF_MAX)
-                        print(f"PLC: Forced S3_to_S4 buffer to {self._buffers['S3_to_S4']}")
+                    elif self._wd.expired("S3", now_ns, wd_slack):
+                        self._watchdog_trip("S3", ms, now_ns, wd_slack)
                     else:
-                        print(f"  WAIT_S3_DONE: done_latched={self._done_latched['S3']}, busy={s3_busy}, ready={s3_ready}, timeout={self._s3_wait_counter}/30")
+                        print(f"  WAIT_S3_DONE: done_latched={self._done_latched['S3']}, busy={s3_busy}, ready={s3_ready}, waited={self._wd.waited_ns('S3', now_ns) / 1e9:.1f}/{self._wd.deadline_ns('S3', wd_slack) / 1e9:.1f}s")
 
                 # ---- START_S4: Send start pulse to S4 ----
                 elif self._state == "START_S4":
-                    # Clear all start commands
-                    for st in STATIONS:
-                        _set_cmd(ms, st, start=0, stop=0, reset=0)
-                    
-                    # Check if S4 is ready and has work from S3
-                    s4_ready = _get(ms, "S4", "ready")
-                    s4_busy = _get(ms, "S4", "busy")
-                    s4_fault = _get(ms, "S4", "fault")
-                    
-                    print(f"  S4 start check: ready={s4_ready}, busy={s4_busy}, fault={s4_fault}, buffer={self._buffers['S3_to_S4']}")
-                    
-                    if (s4_ready and not s4_busy and not s4_fault and self._buffers["S3_to_S4"] > 0):
-                        if not self._start_sent["S4"]:
-                            print("PLC: START pulse -> S4")
-                            _set_cmd(ms, "S4", start=1, stop=0, reset=0)
-                            self._start_sent["S4"] = True
-                            self._state = "WAIT_S4_DONE"
-                            
-                            # Consume buffer
-                            self._buffers["S3_to_S4"] = max(0, self._buffers["S3_to_S4"] - 1)
-                            print(f"PLC: Consumed S3_to_S4 buffer, now {self._buffers['S3_to_S4']}")
-                        else:
-                            print("PLC: S4 start already sent, waiting...")
-                    else:
-                        print(f"PLC: S4 not ready to start")
+                    self._start_station(ms, "S4", now_ns)
 
                 # ---- WAIT_S4_DONE: Wait for S4 to complete ----
                 elif self._state == "WAIT_S4_DONE":
@@ -685,66 +1259,34 @@ class PLC_LineCoordinator:
                     _set_cmd(ms, "S4", start=0, stop=0, reset=0)
                     
                     # Latch S4 done
-                    s4_done = _get(ms, "S4", "done")
+                    s4_done = self._fresh_done(ms, "S4")
                     if s4_done and not self._done_latched["S4"]:
                         print("PLC: S4 done seen (raw) -> latching")
                         self._done_latched["S4"] = True
+                        self._wd.observe_done("S4", self._done_ns(ms, "S4", now_ns))
                     
                     # If S4 done is latched and S4 is no longer busy, advance
                     s4_busy = _get(ms, "S4", "busy")
                     s4_ready = _get(ms, "S4", "ready")
                     
-                    # Timeout counter
-                    self._s4_wait_counter += 1
-                    
                     if (self._done_latched["S4"] and not s4_busy and s4_ready):
                         print("PLC: S4 done latched -> advancing to START_S5")
                         self._done_latched["S4"] = False
                         self._start_sent["S4"] = False
                         self._state = "START_S5"
-                        self._s4_wait_counter = 0
                         
                         # Buffer S4->S5
-                        self._buffers["S4_to_S5"] = min(self._buffers["S4_to_S5"] + 1, BUF_MAX)
+                        self._buffers["S4_to_S5"] += 1
+                        self._finish_unit(ms, "S4", now_ns)
                         print(f"PLC: Incremented S4_to_S5 buffer to {self._buffers['S4_to_S5']}")
-                    elif self._s4_wait_counter > 30:  # Timeout
-                        print(f"PLC: TIMEOUT - S4 stuck for {self._s4_wait_counter} scans, forcing advance")
-                        self._done_latched["S4"] = False
-                        self._start_sent["S4"] = False
-                        self._state = "START_S5"
-                        self._s4_wait_counter = 0
-                        # self._buffers["S4_to_S5"] = min(self._buffers["S4_to_S5"] + 1, BUF_MAX)
-                        print(f"PLC: Forced S4_to_S5 buffer to {self._buffers['S4_to_S5']}")
+                    elif self._wd.expired("S4", now_ns, wd_slack):
+                        self._watchdog_trip("S4", ms, now_ns, wd_slack)
                     else:
-                        print(f"  WAIT_S4_DONE: done_latched={self._done_latched['S4']}, busy={s4_busy}, ready={s4_ready}, timeout={self._s4_wait_counter}/30")
+                        print(f"  WAIT_S4_DONE: done_latched={self._done_latched['S4']}, busy={s4_busy}, ready={s4_ready}, waited={self._wd.waited_ns('S4', now_ns) / 1e9:.1f}/{self._wd.deadline_ns('S4', wd_slack) / 1e9:.1f}s")
 
                 # ---- START_S5: Send start pulse to S5 ----
                 elif self._state == "START_S5":
-                    # Clear all start commands
-                    for st in STATIONS:
-                        _set_cmd(ms, st, start=0, stop=0, reset=0)
-                    
-                    # Check if S5 is ready and has work from S4
-                    s5_ready = _get(ms, "S5", "ready")
-                    s5_busy = _get(ms, "S5", "busy")
-                    s5_fault = _get(ms, "S5", "fault")
-                    
-                    print(f"  S5 start check: ready={s5_ready}, busy={s5_busy}, fault={s5_fault}, buffer={self._buffers['S4_to_S5']}")
-                    
-                    if (s5_ready and not s5_busy and not s5_fault and self._buffers["S4_to_S5"] > 0):
-                        if not self._start_sent["S5"]:
-                            print("PLC: START pulse -> S5")
-                            _set_cmd(ms, "S5", start=1, stop=0, reset=0)
-                            self._start_sent["S5"] = True
-                            self._state = "WAIT_S5_DONE"
-                            
-                            # Consume buffer
-                            self._buffers["S4_to_S5"] = max(0, self._buffers["S4_to_S5"] - 1)
-                            print(f"PLC: Consumed S4_to_S5 buffer, now {self._buffers['S4_to_S5']}")
-                        else:
-                            print("PLC: S5 start already sent, waiting...")
-                    else:
-                        print(f"PLC: S5 not ready to start")
+                    self._start_station(ms, "S5", now_ns)
 
                 # ---- WAIT_S5_DONE: Wait for S5 to complete ----
                 elif self._state == "WAIT_S5_DONE":
@@ -752,66 +1294,34 @@ class PLC_LineCoordinator:
                     _set_cmd(ms, "S5", start=0, stop=0, reset=0)
                     
                     # Latch S5 done
-                    s5_done = _get(ms, "S5", "done")
+                    s5_done = self._fresh_done(ms, "S5")
                     if s5_done and not self._done_latched["S5"]:
                         print("PLC: S5 done seen (raw) -> latching")
                         self._done_latched["S5"] = True
+                        self._wd.observe_done("S5", self._done_ns(ms, "S5", now_ns))
                     
                     # If S5 done is latched and S5 is no longer busy, advance
                     s5_busy = _get(ms, "S5", "busy")
                     s5_ready = _get(ms, "S5", "ready")
                     
-                    # Timeout counter
-                    self._s5_wait_counter += 1
-                    
                     if (self._done_latched["S5"] and not s5_busy and s5_ready):
                         print("PLC: S5 done latched -> advancing to START_S6")
                         self._done_latched["S5"] = False
                         self._start_sent["S5"] = False
                         self._state = "START_S6"
-                        self._s5_wait_counter = 0
                         
                         # Buffer S5->S6
-                        self._buffers["S5_to_S6"] = min(self._buffers["S5_to_S6"] + 1, BUF_MAX)
+                        self._buffers["S5_to_S6"] += 1
+                        self._finish_unit(ms, "S5", now_ns, "accept" if _get(ms, "S5", "last_accept") else "reject")
                         print(f"PLC: Incremented S5_to_S6 buffer to {self._buffers['S5_to_S6']}")
-                    elif self._s5_wait_counter > 30:  # Timeout
-                        print(f"PLC: TIMEOUT - S5 stuck for {self._s5_wait_counter} scans, forcing advance")
-                        self._done_latched["S5"] = False
-                        self._start_sent["S5"] = False
-                        self._state = "START_S6"
-                        self._s5_wait_counter = 0
-                        self._buffers["S5_to_S6"] = min(self._buffers["S5_to_S6"] + 1, BUF_MAX)
-                        print(f"PLC: Forced S5_to_S6 buffer to {self._buffers['S5_to_S6']}")
+                    elif self._wd.expired("S5", now_ns, wd_slack):
+                        self._watchdog_trip("S5", ms, now_ns, wd_slack)
                     else:
-                        print(f"  WAIT_S5_DONE: done_latched={self._done_latched['S5']}, busy={s5_busy}, ready={s5_ready}, timeout={self._s5_wait_counter}/30")
+                        print(f"  WAIT_S5_DONE: done_latched={self._done_latched['S5']}, busy={s5_busy}, ready={s5_ready}, waited={self._wd.waited_ns('S5', now_ns) / 1e9:.1f}/{self._wd.deadline_ns('S5', wd_slack) / 1e9:.1f}s")
 
                 # ---- START_S6: Send start pulse to S6 ----
                 elif self._state == "START_S6":
-                    # Clear all start commands
-                    for st in STATIONS:
-                        _set_cmd(ms, st, start=0, stop=0, reset=0)
-                    
-                    # Check if S6 is ready and has work from S5
-                    s6_ready = _get(ms, "S6", "ready")
-                    s6_busy = _get(ms, "S6", "busy")
-                    s6_fault = _get(ms, "S6", "fault")
-                    
-                    print(f"  S6 start check: ready={s6_ready}, busy={s6_busy}, fault={s6_fault}, buffer={self._buffers['S5_to_S6']}")
-                    
-                    if (s6_ready and not s6_busy and not s6_fault and self._buffers["S5_to_S6"] > 0):
-                        if not self._start_sent["S6"]:
-                            print("PLC: START pulse -> S6")
-                            _set_cmd(ms, "S6", start=1, stop=0, reset=0)
-                            self._start_sent["S6"] = True
-                            self._state = "WAIT_S6_DONE"
-                            
-                            # Consume buffer
-                            self._buffers["S5_to_S6"] = max(0, self._buffers["S5_to_S6"] - 1)
-                            print(f"PLC: Consumed S5_to_S6 buffer, now {self._buffers['S5_to_S6']}")
-                        else:
-                            print("PLC: S6 start already sent, waiting...")
-                    else:
-                        print(f"PLC: S6 not ready to start")
+                    self._start_station(ms, "S6", now_ns)
 
                 # ---- WAIT_S6_DONE: Wait for S6 to complete ----
                 elif self._state == "WAIT_S6_DONE":
@@ -819,27 +1329,25 @@ class PLC_LineCoordinator:
                     _set_cmd(ms, "S6", start=0, stop=0, reset=0)
                     
                     # Latch S6 done
-                    s6_done = _get(ms, "S6", "done")
+                    s6_done = self._fresh_done(ms, "S6")
                     if s6_done and not self._done_latched["S6"]:
                         print("PLC: S6 done seen (raw) -> latching")
                         self._done_latched["S6"] = True
+                        self._wd.observe_done("S6", self._done_ns(ms, "S6", now_ns))
                     
                     # If S6 done is latched and S6 is no longer busy, cycle complete
                     s6_busy = _get(ms, "S6", "busy")
                     s6_ready = _get(ms, "S6", "ready")
                     
-                    # Timeout counter
-                    self._s6_wait_counter += 1
-                    
                     if (self._done_latched["S6"] and not s6_busy and s6_ready):
                         print("PLC: S6 done latched -> FULL CYCLE COMPLETE")
                         self._done_latched["S6"] = False
                         self._start_sent["S6"] = False
-                        self._s6_wait_counter = 0
                         
                         # Increment batch and finished count
                         self._batch_id += 1
                         self.finished += 1
+                        self._finish_unit(ms, "S6", now_ns)
                         
                         # Update KPI totals from S5
                         self._s5_accept_total += _get(ms, "S5", "accept")
@@ -851,29 +1359,42 @@ class PLC_LineCoordinator:
                         # Go back to START_S1 for next unit
                         self._state = "START_S1"
                         print("PLC: Restarting pipeline with next unit")
-                    elif self._s6_wait_counter > 30:  # Timeout
-                        print(f"PLC: TIMEOUT - S6 stuck for {self._s6_wait_counter} scans, forcing cycle complete")
-                        self._done_latched["S6"] = False
-                        self._start_sent["S6"] = False
-                        self._s6_wait_counter = 0
-                        self._batch_id += 1
-                        self.finished += 1
-                        self._state = "START_S1"
-                        print(f"PLC: Forced batch {self._batch_id-1} complete, restarting")
+                    elif self._wd.expired("S6", now_ns, wd_slack):
+                        self._watchdog_trip("S6", ms, now_ns, wd_slack)
                     else:
-                        print(f"  WAIT_S6_DONE: done_latched={self._done_latched['S6']}, busy={s6_busy}, ready={s6_ready}, timeout={self._s6_wait_counter}/30")
+                        print(f"  WAIT_S6_DONE: done_latched={self._done_latched['S6']}, busy={s6_busy}, ready={s6_ready}, waited={self._wd.waited_ns('S6', now_ns) / 1e9:.1f}/{self._wd.deadline_ns('S6', wd_slack) / 1e9:.1f}s")
                 
+                # ---- Zero-scan handoff: issue the START pulse in the scan the state got there ----
+                if self._fast_handoff and self._state != state_in and self._state.startswith("START_S"):
+                    self._start_station(ms, self._state[6:], now_ns, handoff=True)
+
                 # Update DONE LATCHES (safety catch)
                 for st in STATIONS:
-                    if _get(ms, st, "done"):
+                    if self._fresh_done(ms, st):
                         if not self._done_latched[st]:
                             print(f"PLC: Safety latch for {st} done")
                             self._done_latched[st] = True
+                            self._wd.observe_done(st, self._done_ns(ms, st, now_ns))
                 
                 # Update previous states for edge detection
                 for st in STATIONS:
                     self._prev_done[st] = (_get(ms, st, "done") == 1)
 
+                # Per-unit context: each station sees the serial number of the unit it works on
+                for st in STATIONS:
+                    _set_context(ms, st, self._wip.batch_id(st, self._batch_id), self._recipe_id)
+                self._wip.update(now_ns)
+
+                # Flow accounting: idle = ready, not busy, not faulted (see _FlowStats)
+                idle = [st for st in STATIONS
+                        if _get(ms, st, "ready") and not _get(ms, st, "busy") and not _get(ms, st, "fault")]
+                self._flow.update(now_ns, self._buffers, idle)
+
+                # Active-period bottleneck: working or being repaired counts as active
+                repairing = self._fault_stations if self._recovering else ()
+                self._bneck.observe(now_ns, {st: bool(_get(ms, st, "busy") or _get(ms, st, "fault") or st in repairing)
+                                             for st in STATIONS})
+
                 # 2) PRINT WHAT PLC IS TRANSMITTING
                 print("TX commands:")
                 for st in STATIONS:
@@ -882,6 +1403,8 @@ class PLC_LineCoordinator:
                     stop = getattr(self.mySignals, f"{st}_cmd_stop")
                     print(f"  TX {st} start={start} reset={reset} stop={stop}")
 
+                if self._prof is not None:
+                    self._prof.lap("logic")
                 # End of user custom code region.
                 #Send ethernet packet to ST1_ComponentKitting
                 self.sendEthernetPacketToST1_ComponentKitting()
@@ -902,7 +1425,26 @@ class PLC_LineCoordinator:
                 self.sendEthernetPacketToST6_PackagingDispatch()
 
                 # Start of user custom code region. Please apply edits only within these regions:  After sending the packet
-
+                if self._prof is not None:
+                    self._prof.lap("tx")
+                if self._metrics is not None or self._kpi_bus is not None:
+                    try:
+                        import opt_dashboard
+                        snap = opt_dashboard.build_kpi_snapshot(self, self.mySignals, STATIONS)
+                        if self._kpi_bus is not None:
+                            self._kpi_bus.publish(snap)
+                        if self._metrics is not None:
+                            self._metrics.observe_scan(self, self.mySignals, STATIONS, snap)
+                    except Exception as e:
+                        print(f"PLC: KPI export failed: {e}")
+                # target precision reached: end the run the way the gateway does at totalSimulationTime
+                if self._precision is not None and self._precision.check(
+                        vsiCommonPythonApi.getSimulationTimeInNs() / 1e9, self.steady_state_summary):
+                    print(f"PLC: target precision reached at {self._precision.report['stopped_at_s']:.0f}s: "
+                          f"{self._precision.describe()}")
+                    vsiEthernetPythonGateway.terminate()
+                if self._prof is not None:
+                    self._prof.lap("hooks")
                 # End of user custom code region. Please don't edit beyond this point.
 
                 print("\n+=PLC_LineCoordinator+=")
@@ -924,6 +1466,8 @@ class PLC_LineCoordinator:
                 print(self.mySignals.S1_inventory_ok)
                 print("\tS1_any_arm_failed =", end = " ")
                 print(self.mySignals.S1_any_arm_failed)
+                print("\tS1_done_time_ns =", end = " ")
+                print(self.mySignals.S1_done_time_ns)
                 print("\tS2_ready =", end = " ")
                 print(self.mySignals.S2_ready)
                 print("\tS2_busy =", end = " ")
@@ -942,6 +1486,8 @@ class PLC_LineCoordinator:
                 print(self.mySignals.S2_reworks)
                 print("\tS2_cycle_time_avg_s =", end = " ")
                 print(self.mySignals.S2_cycle_time_avg_s)
+                print("\tS2_done_time_ns =", end = " ")
+                print(self.mySignals.S2_done_time_ns)
                 print("\tS3_ready =", end = " ")
                 print(self.mySignals.S3_ready)
                 print("\tS3_busy =", end = " ")
@@ -956,6 +1502,8 @@ class PLC_LineCoordinator:
                 print(self.mySignals.S3_strain_relief_ok)
                 print("\tS3_continuity_ok =", end = " ")
                 print(self.mySignals.S3_continuity_ok)
+                print("\tS3_done_time_ns =", end = " ")
+                print(self.mySignals.S3_done_time_ns)
                 print("\tS4_ready =", end = " ")
                 print(self.mySignals.S4_ready)
                 print("\tS4_busy =", end = " ")
@@ -970,6 +1518,8 @@ class PLC_LineCoordinator:
                 print(self.mySignals.S4_total)
                 print("\tS4_completed =", end = " ")
                 print(self.mySignals.S4_completed)
+                print("\tS4_done_time_ns =", end = " ")
+                print(self.mySignals.S4_done_time_ns)
                 print("\tS5_ready =", end = " ")
                 print(self.mySignals.S5_ready)
                 print("\tS5_busy =", end = " ")
@@ -986,6 +1536,8 @@ class PLC_LineCoordinator:
                 print(self.mySignals.S5_reject)
                 print("\tS5_last_accept =", end = " ")
                 print(self.mySignals.S5_last_accept)
+                print("\tS5_done_time_ns =", end = " ")
+                print(self.mySignals.S5_done_time_ns)
                 print("\tS6_ready =", end = " ")
                 print(self.mySignals.S6_ready)
                 print("\tS6_busy =", end = " ")
@@ -1008,6 +1560,8 @@ class PLC_LineCoordinator:
                 print(self.mySignals.S6_downtime_s)
                 print("\tS6_availability =", end = " ")
                 print(self.mySignals.S6_availability)
+                print("\tS6_done_time_ns =", end = " ")
+                print(self.mySignals.S6_done_time_ns)
                 print("  Outputs:")
                 print("\tS1_cmd_start =", end = " ")
                 print(self.mySignals.S1_cmd_start)
@@ -1192,6 +1746,7 @@ class PLC_LineCoordinator:
             self.mySignals.S1_cycle_time_ms, receivedPayload = self.unpackBytes('L', receivedPayload)
             self.mySignals.S1_inventory_ok, receivedPayload = self.unpackBytes('?', receivedPayload)
             self.mySignals.S1_any_arm_failed, receivedPayload = self.unpackBytes('?', receivedPayload)
+            self.mySignals.S1_done_time_ns, receivedPayload = self.unpackBytes('Q', receivedPayload)
 
         if(self.receivedDestPortNumber == PLC_LineCoordinatorSocketPortNumber1):
             print("Received packet from ST2_FrameCoreAssembly")
@@ -1210,6 +1765,7 @@ class PLC_LineCoordinator:
             self.mySignals.S2_scrapped, receivedPayload = self.unpackBytes('L', receivedPayload)
             self.mySignals.S2_reworks, receivedPayload = self.unpackBytes('L', receivedPayload)
             self.mySignals.S2_cycle_time_avg_s, receivedPayload = self.unpackBytes('d', receivedPayload)
+            self.mySignals.S2_done_time_ns, receivedPayload = self.unpackBytes('Q', receivedPayload)
 
         if(self.receivedDestPortNumber == PLC_LineCoordinatorSocketPortNumber2):
             print("Received packet from ST3_ElectronicsWiring")
@@ -1226,6 +1782,7 @@ class PLC_LineCoordinator:
             self.mySignals.S3_cycle_time_ms, receivedPayload = self.unpackBytes('L', receivedPayload)
             self.mySignals.S3_strain_relief_ok, receivedPayload = self.unpackBytes('?', receivedPayload)
             self.mySignals.S3_continuity_ok, receivedPayload = self.unpackBytes('?', receivedPayload)
+            self.mySignals.S3_done_time_ns, receivedPayload = self.unpackBytes('Q', receivedPayload)
 
         if(self.receivedDestPortNumber == PLC_LineCoordinatorSocketPortNumber3):
             print("Received packet from ST4_CalibrationTesting")
@@ -1242,6 +1799,7 @@ class PLC_LineCoordinator:
             self.mySignals.S4_cycle_time_ms, receivedPayload = self.unpackBytes('L', receivedPayload)
             self.mySignals.S4_total, receivedPayload = self.unpackBytes('L', receivedPayload)
             self.mySignals.S4_completed, receivedPayload = self.unpackBytes('L', receivedPayload)
+            self.mySignals.S4_done_time_ns, receivedPayload = self.unpackBytes('Q', receivedPayload)
 
         if(self.receivedDestPortNumber == PLC_LineCoordinatorSocketPortNumber4):
             print("Received packet from ST5_QualityInspection")
@@ -1259,6 +1817,7 @@ class PLC_LineCoordinator:
             self.mySignals.S5_accept, receivedPayload = self.unpackBytes('L', receivedPayload)
             self.mySignals.S5_reject, receivedPayload = self.unpackBytes('L', receivedPayload)
             self.mySignals.S5_last_accept, receivedPayload = self.unpackBytes('?', receivedPayload)
+            self.mySignals.S5_done_time_ns, receivedPayload = self.unpackBytes('Q', receivedPayload)
 
         if(self.receivedDestPortNumber == PLC_LineCoordinatorSocketPortNumber5):
             print("Received packet from ST6_PackagingDispatch")
@@ -1279,6 +1838,7 @@ class PLC_LineCoordinator:
             self.mySignals.S6_operational_time_s, receivedPayload = self.unpackBytes('d', receivedPayload)
             self.mySignals.S6_downtime_s, receivedPayload = self.unpackBytes('d', receivedPayload)
             self.mySignals.S6_availability, receivedPayload = self.unpackBytes('d', receivedPayload)
+            self.mySignals.S6_done_time_ns, receivedPayload = self.unpackBytes('Q', receivedPayload)
 
     def sendEthernetPacketToST1_ComponentKitting(self):
         bytesToSend = bytes()
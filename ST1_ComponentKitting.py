@@ -29,6 +29,7 @@ class MySignals:
         self.cycle_time_ms = 0
         self.inventory_ok = 0
         self.any_arm_failed = 0
+        self.done_time_ns = 0
 
 
 
@@ -47,16 +48,20 @@ ST1_ComponentKitting0 = 0
 # --- Station 1 (Component Kitting) FIXED handshake model ---
 import simpy
 import random
+from station_runtime import LazyRuntime
+
+ST1_NOMINAL_CYCLE_S = 9.597  # kitting cycle, no variation
 
 class FixedKittingStation:
     """
     Fixed station with proper handshake that keeps start_latched during entire cycle.
     """
-    def __init__(self, env: simpy.Environment):
+    def __init__(self, env: simpy.Environment, spawn=None):
         self.env = env
+        self._spawn = spawn or env.process  # the runtime's process(), so a reset can end the cycle
         self.state = "IDLE"
         self._cycle_proc = None  # Active SimPy process handle
-        self._nominal_cycle_time_s = 9.597  # Target/nominal
+        self._nominal_cycle_time_s = ST1_NOMINAL_CYCLE_S  # Target/nominal
         
         # State variables
         self._busy = False
@@ -85,7 +90,7 @@ class FixedKittingStation:
         self._done_pulse = False
         self._cycle_start_s = start_time_s
         self._actual_cycle_time_ms = 0  # Clear until completion
-        self._cycle_proc = self.env.process(self._kit_cycle())
+        self._cycle_proc = self._spawn(self._kit_cycle())
         return True
     
     def _kit_cycle(self):
@@ -134,6 +139,9 @@ class FixedKittingStation:
         self._busy = False
         self._done_pulse = False
         self._cycle_proc = None
+        self._fault = False
+        self._cycle_start_s = 0
+        self._cycle_end_s = 0
         self._actual_cycle_time_ms = 9597  # Reset to nominal
         self._cycle_count = 0
         self._cycle_time_sum_ms = 0
@@ -165,10 +173,12 @@ class FixedKittingStation:
 
 
 # VSI <-> SimPy Wrapper (FIXED - keeps start_latched during cycle)
-class ST1_SimRuntime:
+class ST1_SimRuntime(LazyRuntime):
+    CHECKPOINT_PARTS = ("station",)
+
     def __init__(self):
-        self.env = simpy.Environment()
-        self.station = FixedKittingStation(self.env)
+        LazyRuntime.__init__(self)
+        self.station = FixedKittingStation(self.env, spawn=self.process)
         
         # Handshake state - CLEAR on init
         self._start_latched = False  # Set on cmd_start rising edge, cleared on cycle completion
@@ -186,14 +196,24 @@ class ST1_SimRuntime:
         
     def reset(self):
         """Full reset - NO auto-start processes"""
-        self.env = simpy.Environment()
-        self.station = FixedKittingStation(self.env)
+        # new Environment at the same model time; ends the cycle process first
+        self.reset_env()
+        self.station.reset()
         self._start_latched = False
         self._prev_cmd_start = 0
         self._prev_cmd_stop = 0
         self._prev_cmd_reset = 0
         print("  ST1_SimRuntime: Full reset - NO auto-start")
         
+    def build_env(self):
+        self.station.env = self.env
+
+    def job_in_flight(self):
+        return self.station.is_busy()
+
+    def resume_job(self, start_time_s):
+        self.station.start_cycle(start_time_s)
+
     def set_context(self, batch_id: int, recipe_id: int):
         self.batch_id = int(batch_id)
         self.recipe_id = int(recipe_id)
@@ -226,6 +246,7 @@ class ST1_SimRuntime:
             if not self.station.is_busy() and not self.station._fault:
                 print("  ST1_SimRuntime: START rising edge, station idle - starting cycle")
                 self._start_latched = True  # Set and KEEP until cycle completes
+                self.mark_job(self.env.now)
                 self.station.start_cycle(self.env.now)
             else:
                 print(f"  ST1_SimRuntime: START rising edge but station busy={self.station.is_busy()}, fault={self.station._fault} - ignoring")
@@ -249,7 +270,7 @@ class ST1_SimRuntime:
             print("  ERROR: ST1_SimRuntime: active process but busy=False! Fixing...")
             self.station._busy = True
         
-    def step(self, dt_s: float):
+    def step(self, t_end_ns: int, dt_s: float):
         """Advance simulation ONLY when necessary"""
         self._last_step_dt = dt_s
         
@@ -265,10 +286,9 @@ class ST1_SimRuntime:
             print(f"  ST1_SimRuntime: NOT stepping - stop command active and not busy")
             return
             
-        # Only step if we should step
+        # Only step if we should step; advance() skips env.run until the cycle end is due
         if should_step and dt_s > 0:
-            target_time = self.env.now + float(dt_s)
-            self.env.run(until=target_time)
+            self.advance(t_end_ns)
             print(f"  ST1_SimRuntime: Stepped to env.now={self.env.now:.3f}s")
             
             # Check for cycle completion and clear start_latched
@@ -374,6 +394,11 @@ class ST1_ComponentKitting:
                 if self._sim is not None:
                     # Update context
                     self._sim.set_context(self.mySignals.batch_id, self.mySignals.recipe_id)
+
+                    # Commands act at the current VSI time: catch the model up first
+                    now_ns = vsiCommonPythonApi.getSimulationTimeInNs()
+                    if self.mySignals.cmd_start or self.mySignals.cmd_stop or self.mySignals.cmd_reset:
+                        self._sim.sync(now_ns)
                     
                     # Process PLC commands and update handshake state
                     self._sim.update_handshake(
@@ -384,7 +409,13 @@ class ST1_ComponentKitting:
                     
                     # Advance simulation time ONLY when appropriate
                     dt_s = float(self.simulationStep) / 1e9 if self.simulationStep else 0.0
-                    self._sim.step(dt_s)
+                    self._sim.step(now_ns + int(self.simulationStep or 0), dt_s)
+
+                    # Completion inside this step: report its exact VSI time, not the tick
+                    if self._sim.station.completed_cycles:
+                        done_ns = self._sim.step_time_ns(self._sim.station._cycle_end_s)
+                        if done_ns is not None:
+                            self.mySignals.done_time_ns = done_ns
                     
                     # Get outputs from SimPy
                     ready, busy, fault, done, cycle_time_ms, inventory_ok, any_arm_failed = self._sim.outputs()
@@ -441,6 +472,8 @@ class ST1_ComponentKitting:
                 print(self.mySignals.inventory_ok)
                 print("\tany_arm_failed =", end = " ")
                 print(self.mySignals.any_arm_failed)
+                print("\tdone_time_ns =", end = " ")
+                print(self.mySignals.done_time_ns)
                 print(f"  Internal: total_completed={self.total_completed}")
                 if self._sim is not None:
                     print(f"  SimState: start_latched={self._sim._start_latched}")
@@ -533,6 +566,8 @@ class ST1_ComponentKitting:
 
         bytesToSend += self.packBytes('?', self.mySignals.any_arm_failed)
 
+        bytesToSend += self.packBytes('Q', self.mySignals.done_time_ns)
+
         print(f"ST1 sending to PLC on port: {PLC_LineCoordinatorSocketPortNumber0}")
         vsiEthernetPythonGateway.sendEthernetPacket(PLC_LineCoordinatorSocketPortNumber0, bytes(bytesToSend))
 
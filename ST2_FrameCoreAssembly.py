@@ -31,6 +31,7 @@ class MySignals:
         self.scrapped = 0
         self.reworks = 0
         self.cycle_time_avg_s = 0.0
+        self.done_time_ns = 0
 
 
 
@@ -51,6 +52,17 @@ ST2_FrameCoreAssembly1 = 0
 import simpy
 import random
 import math
+from station_runtime import LazyRuntime
+
+# Cycle time: base per recipe, scaled by a uniform +/- jitter
+ST2_BASE_TIME_S = 12.0
+ST2_BASE_TIME_RECIPE1_S = 14.0
+ST2_JITTER = 0.15
+ST2_MIN_CYCLE_S = 2.0
+
+# Outcome per cycle
+ST2_P_SCRAP = 0.02
+ST2_P_REWORK = 0.05
 
 # =====================
 # STATION 2 HANDLING WITH PERSISTENT HANDSHAKE
@@ -60,12 +72,13 @@ class ST2_CycleHandler:
     Handles frame core assembly cycles.
     Optimized to maintain busy/ready states consistently for the PLC.
     """
-    def __init__(self, env: simpy.Environment):
+    def __init__(self, env: simpy.Environment, spawn=None):
         self.env = env
+        self._spawn = spawn or env.process  # the runtime's process(), so a reset can end the cycle
         self.state = "IDLE" 
         self._cycle_proc = None
         self._current_cycle_time_s = 12.0
-        self._cycle_time_jitter = 0.15 
+        self._cycle_time_jitter = ST2_JITTER
         
         self._busy = False
         self._done_pulse = False
@@ -73,6 +86,7 @@ class ST2_CycleHandler:
         self._fault = False
         
         self._start_time_s = 0
+        self._end_time_s = None
         self._last_cycle_time_ms = 12000
         
         self._completed = 0
@@ -100,15 +114,15 @@ class ST2_CycleHandler:
             return False
             
         # Recipe-based timing
-        base_time = 14.0 if recipe_id == 1 else 12.0
+        base_time = ST2_BASE_TIME_RECIPE1_S if recipe_id == 1 else ST2_BASE_TIME_S
         jitter = 1.0 + random.uniform(-self._cycle_time_jitter, self._cycle_time_jitter)
-        self._current_cycle_time_s = max(2.0, base_time * jitter)
+        self._current_cycle_time_s = max(ST2_MIN_CYCLE_S, base_time * jitter)
         
         self.state = "RUNNING"
         self._busy = True
         self._done_pulse = False
         self._start_time_s = self.env.now
-        self._cycle_proc = self.env.process(self._run_cycle())
+        self._cycle_proc = self._spawn(self._run_cycle())
         return True
         
     def _run_cycle(self):
@@ -118,10 +132,10 @@ class ST2_CycleHandler:
             # Outcome logic
             r = random.random()
             self._total_cycles += 1
-            if r < 0.02: # 2% Scrap
+            if r < ST2_P_SCRAP:
                 self.state = "SCRAPPED"
                 self._scrapped += 1
-            elif r < 0.07: # 5% Rework
+            elif r < ST2_P_SCRAP + ST2_P_REWORK:
                 self.state = "REWORK"
                 self._reworks += 1
             else:
@@ -129,6 +143,7 @@ class ST2_CycleHandler:
                 self._completed += 1
             
             # Timing calculations
+            self._end_time_s = self.env.now
             duration_s = self.env.now - self._start_time_s
             self._last_cycle_time_ms = int(duration_s * 1000)
             self._cycle_time_avg_s = ((self._cycle_time_avg_s * (self._total_cycles - 1)) + duration_s) / self._total_cycles
@@ -146,10 +161,12 @@ class ST2_CycleHandler:
         self.state = "IDLE"
         self._busy = False
 
-class ST2_SimRuntime:
+class ST2_SimRuntime(LazyRuntime):
+    CHECKPOINT_PARTS = ("handler",)
+
     def __init__(self):
-        self.env = simpy.Environment()
-        self.handler = ST2_CycleHandler(self.env)
+        LazyRuntime.__init__(self)
+        self.handler = ST2_CycleHandler(self.env, spawn=self.process)
         
         self.enabled = False
         self._done_output_latched = False
@@ -158,19 +175,32 @@ class ST2_SimRuntime:
         self.batch_id = 0
         self.recipe_id = 0
 
-    def step(self, dt_s: float):
+    def build_env(self):
+        self.handler.env = self.env
+
+    def job_in_flight(self):
+        return self.handler._busy
+
+    def resume_job(self, recipe_id):
+        self.handler.start_cycle(recipe_id)
+
+    def step(self, now_ns: int, t_end_ns: int):
         """Logic Step: Triggered every VSI simulation step."""
+        # Start/stop act at the current VSI time
+        if self.enabled != self.handler._busy:
+            self.sync(now_ns)
+
         # Process start if enabled and idle
         if self.enabled and not self.handler._busy:
+            self.mark_job(self.recipe_id)
             self.handler.start_cycle(self.recipe_id)
         
         # Process stop if disabled
         if not self.enabled and self.handler._busy:
             self.handler.stop_cycle()
 
-        # Advance SimPy time
-        target = self.env.now + dt_s
-        self.env.run(until=target)
+        # Advance SimPy time (env.run only when the cycle end falls in this tick)
+        self.advance(t_end_ns)
 
         # Robust Done Pulse Handshake (Matching ST1 logic)
         # Ensures 'done' is high for exactly one VSI tick
@@ -182,8 +212,9 @@ class ST2_SimRuntime:
             self._done_was_set_prev = False
 
     def get_outputs(self):
-        # Ready is only true if we are enabled (latched) but not currently working
-        ready_signal = 1 if (not self.handler._busy and self.enabled) else 0
+        # Ready = idle and not faulted, independent of the run latch (same as ST1);
+        # gating on the latch kept the PLC in WAIT_ALL_READY forever
+        ready_signal = 1 if (not self.handler._busy and not self.handler._fault) else 0
         
         out = (
             ready_signal,
@@ -302,9 +333,11 @@ class ST2_FrameCoreAssembly:
                # Start of user custom code region. Before sending the packet
 
                 # 1. Edge Detection & Latched Run State (Mirroring ST1 success)
+                now_ns = vsiCommonPythonApi.getSimulationTimeInNs()
                 if self.mySignals.cmd_reset and not self._prev_cmd_reset:
                     self._run_latched = False
                     if self._sim is not None:
+                        self._sim.sync(now_ns)
                         self._sim.handler.reset()
 
                 if self.mySignals.cmd_start and not self._prev_cmd_start:
@@ -327,7 +360,7 @@ class ST2_FrameCoreAssembly:
                     self._sim.recipe_id = self.mySignals.recipe_id
                     
                     # Step SimPy
-                    self._sim.step(dt_s)
+                    self._sim.step(now_ns, now_ns + int(round(dt_s * 1e9)))
                     
                     # 3. Map SimPy results to VSI signals for the PLC
                     (self.mySignals.ready, self.mySignals.busy, self.mySignals.fault, 
@@ -335,6 +368,11 @@ class ST2_FrameCoreAssembly:
                     self.mySignals.scrapped, self.mySignals.reworks, 
                     self.mySignals.cycle_time_avg_s) = self._sim.get_outputs()
 
+                    # Completion inside this step: report its exact VSI time, not the tick
+                    done_ns = self._sim.step_time_ns(self._sim.handler._end_time_s)
+                    if done_ns is not None:
+                        self.mySignals.done_time_ns = done_ns
+
 # End of user custom code region.
                 # End of user custom code region. Please don't edit beyond this point.
 
@@ -379,6 +417,8 @@ class ST2_FrameCoreAssembly:
                 print(self.mySignals.reworks)
                 print("\tcycle_time_avg_s =", end = " ")
                 print(self.mySignals.cycle_time_avg_s)
+                print("\tdone_time_ns =", end = " ")
+                print(self.mySignals.done_time_ns)
                 
                 # Debug output
                 print("  Internal state:")
@@ -486,6 +526,8 @@ class ST2_FrameCoreAssembly:
 
         bytesToSend += self.packBytes('d', self.mySignals.cycle_time_avg_s)
 
+        bytesToSend += self.packBytes('Q', self.mySignals.done_time_ns)
+
         #Send ethernet packet to PLC_LineCoordinator
         print(f"ST2 sending to PLC on port: {PLC_LineCoordinatorSocketPortNumber1}")
         vsiEthernetPythonGateway.sendEthernetPacket(PLC_LineCoordinatorSocketPortNumber1, bytes(bytesToSend))
@@ -29,6 +29,7 @@ class MySignals:
 		self.cycle_time_ms = 0
 		self.strain_relief_ok = 0
 		self.continuity_ok = 0
+		self.done_time_ns = 0
 
 
 
@@ -46,12 +47,14 @@ ST3_ElectronicsWiring0 = 0
 
 import simpy
 import random
+from station_runtime import LazyRuntime
 from dataclasses import dataclass
 from typing import Optional, Dict, Any
 
 # --- Station 3 (Electronics + Wiring) SimPy model ---
 # Time base:
-#   We advance SimPy by dt_s = simulationStep(ns) / 1e9 every VSI loop when NOT paused.
+#   SimPy time follows VSI time while NOT paused; LazyRuntime only calls env.run
+#   on ticks where an event is due.
 #   All durations below are in seconds.
 RANDOM_SEED_ST3 = 42
 
@@ -67,6 +70,11 @@ T_REWORK_S = 4.0
 # Quality probabilities
 P_STRAIN_OK = 0.95
 P_CONTINUITY_OK = 0.92
+# Retest after one rework: chance goes up by GAIN, capped at CAP
+P_STRAIN_REWORK_GAIN = 0.03
+P_STRAIN_REWORK_CAP = 0.98
+P_CONTINUITY_REWORK_GAIN = 0.05
+P_CONTINUITY_REWORK_CAP = 0.97
 
 @dataclass
 class ST3Job:
@@ -74,17 +82,22 @@ class ST3Job:
     recipe_id: int
     enqueue_t: float
 
-class Station3Sim:
+class Station3Sim(LazyRuntime):
     """SimPy model for Station 3: install electronics + route wiring + test."""
     def __init__(self, seed: int = RANDOM_SEED_ST3):
         random.seed(seed)
-        self.env = simpy.Environment()
+        LazyRuntime.__init__(self)
+        self.build_env()
+        self._clear()
+
+    def build_env(self):
         self.queue = simpy.Store(self.env)
 
         # Resources (one workcell, one tester)
         self.workcell = simpy.Resource(self.env, capacity=1)
         self.tester = simpy.Resource(self.env, capacity=1)
 
+    def _clear(self):
         # KPIs / state
         self.total = 0
         self.completed = 0
@@ -103,10 +116,23 @@ class Station3Sim:
         }
 
         self._job_start_t = None
-        self.env.process(self._worker())
+        self.process(self._worker())
 
     def reset(self, seed: int = RANDOM_SEED_ST3):
-        self.__init__(seed=seed)
+        # new Environment at the same model time, with an empty Store and Resources
+        random.seed(seed)
+        self.reset_env()
+        self._clear()
+
+    def job_in_flight(self):
+        return self.current_job is not None
+
+    def resume_job(self, job):
+        self.queue.put(job)
+        self.resume_idle()
+
+    def resume_idle(self):
+        self.process(self._worker())
 
     def submit(self, batch_id: int, recipe_id: int):
         job = ST3Job(batch_id=batch_id, recipe_id=recipe_id, enqueue_t=self.env.now)
@@ -115,6 +141,7 @@ class Station3Sim:
     def _worker(self):
         while True:
             job = yield self.queue.get()
+            self.mark_job(job)
             self.current_job = job
             self.total += 1
             self._job_start_t = self.env.now
@@ -156,11 +183,11 @@ class Station3Sim:
                 yield self.env.timeout(T_REWORK_S)
 
                 # Retest after rework (higher success chances)
-                strain_ok = (random.random() <= min(0.98, P_STRAIN_OK + 0.03))
+                strain_ok = (random.random() <= min(P_STRAIN_REWORK_CAP, P_STRAIN_OK + P_STRAIN_REWORK_GAIN))
                 with self.tester.request() as t_req2:
                     yield t_req2
                     yield self.env.timeout(T_CONTINUITY_TEST_S)
-                    cont_ok = (random.random() <= min(0.97, P_CONTINUITY_OK + 0.05))
+                    cont_ok = (random.random() <= min(P_CONTINUITY_REWORK_CAP, P_CONTINUITY_OK + P_CONTINUITY_REWORK_GAIN))
 
                 if (not strain_ok) or (not cont_ok):
                     fault = 1  # latch a station fault (requires PLC reset)
@@ -173,6 +200,7 @@ class Station3Sim:
                 "fault": int(fault),
                 "done_pulse": 1 if fault == 0 else 0,
                 "cycle_time_s": cycle_s,
+                "end_t": end_t,
                 "strain_relief_ok": 1 if strain_ok else 0,
                 "continuity_ok": 1 if cont_ok else 0,
             })
@@ -262,10 +290,13 @@ class ST3_ElectronicsWiring:
 
 				# Start of user custom code region. Please apply edits only within these regions:  Before sending the packet
 
+				now_ns = vsiCommonPythonApi.getSimulationTimeInNs()
+				t_end_ns = now_ns + int(self.simulationStep or 0)
 				reset_edge = (self.mySignals.cmd_reset == 1 and self._st3_prev_reset == 0)
 				self._st3_prev_reset = self.mySignals.cmd_reset
 
 				if reset_edge:
+					self._st3.sync(now_ns)
 					self._st3.reset()
 					self.mySignals.ready = 1
 					self.mySignals.busy = 0
@@ -280,19 +311,21 @@ class ST3_ElectronicsWiring:
 					self.mySignals.ready = 0
 					self.mySignals.busy = 0
 					self.mySignals.fault = 1
+					self._st3.hold(t_end_ns)
 				else:
 					# PLC-controlled: run when cmd_start=1, pause when cmd_stop=1.
 					# We submit ONE job when the station is idle and there is no queued job.
 					pending = (len(self._st3.queue.items) > 0)
 					if (self.mySignals.cmd_start == 1 and self.mySignals.cmd_stop == 0):
 						if (not pending) and (self._st3.current_job is None) and (self._st3.last_result.get('busy', 0) == 0):
+							self._st3.sync(now_ns)
 							self._st3.submit(int(self.mySignals.batch_id), int(self.mySignals.recipe_id))
 
-					# Advance SimPy time if not paused
+					# Advance SimPy time if not paused (env.run only when an event is due)
 					if self.mySignals.cmd_stop == 0:
-						dt_s = float(self.simulationStep) / 1e9 if self.simulationStep else 0.0
-						if dt_s > 0:
-							self._st3.env.run(until=self._st3.env.now + dt_s)
+						self._st3.advance(t_end_ns)
+					else:
+						self._st3.hold(t_end_ns)
 
 					res = self._st3.last_result
 					busy = int(res.get('busy', 0))
@@ -309,6 +342,10 @@ class ST3_ElectronicsWiring:
 					if done_pulse == 1:
 						self.mySignals.done = 1
 						self._st3.last_result['done_pulse'] = 0
+						# exact VSI time of the completion inside this step, not the tick
+						done_ns = self._st3.step_time_ns(res.get('end_t'))
+						if done_ns is not None:
+							self.mySignals.done_time_ns = done_ns
 
 					self.mySignals.cycle_time_ms = int(float(res.get('cycle_time_s', 0.0)) * 1000.0)
 					self.mySignals.strain_relief_ok = 1 if int(res.get('strain_relief_ok', 0)) else 0
@@ -351,6 +388,8 @@ class ST3_ElectronicsWiring:
 				print(self.mySignals.strain_relief_ok)
 				print("\tcontinuity_ok =", end = " ")
 				print(self.mySignals.continuity_ok)
+				print("\tdone_time_ns =", end = " ")
+				print(self.mySignals.done_time_ns)
 				print("\n\n")
 
 				self.updateInternalVariables()
@@ -437,6 +476,8 @@ class ST3_ElectronicsWiring:
 
 		bytesToSend += self.packBytes('?', self.mySignals.continuity_ok)
 
+		bytesToSend += self.packBytes('Q', self.mySignals.done_time_ns)
+
 		#Send ethernet packet to PLC_LineCoordinator
 		vsiEthernetPythonGateway.sendEthernetPacket(PLC_LineCoordinatorSocketPortNumber0, bytes(bytesToSend))
 
@@ -29,6 +29,7 @@ class MySignals:
 		self.cycle_time_ms = 0
 		self.total = 0
 		self.completed = 0
+		self.done_time_ns = 0
 
 
 
@@ -46,11 +47,12 @@ ST4_CalibrationTesting0 = 0
 
 import simpy
 import random
+from station_runtime import LazyRuntime
 from dataclasses import dataclass
 from typing import Optional, Dict, Any
 
 # --- Station 4 (Calibration + Test Chamber) SimPy model ---
-# Durations in seconds. SimPy time advances by dt_s = simulationStep(ns)/1e9 each VSI loop when not paused.
+# Durations in seconds. SimPy time follows VSI time when not paused (env.run only on ticks where an event is due).
 RANDOM_SEED_ST4 = 7
 
 # Stages (seconds)
@@ -70,13 +72,19 @@ class ST4Job:
     recipe_id: int
     enqueue_t: float
 
-class Station4Sim:
+class Station4Sim(LazyRuntime):
     def __init__(self, chamber_capacity: int = 1, seed: int = RANDOM_SEED_ST4):
         random.seed(seed)
-        self.env = simpy.Environment()
+        LazyRuntime.__init__(self)
+        self.chamber_capacity = int(chamber_capacity)
+        self.build_env()
+        self._clear()
+
+    def build_env(self):
         self.queue = simpy.Store(self.env)
-        self.chamber = simpy.Resource(self.env, capacity=chamber_capacity)
+        self.chamber = simpy.Resource(self.env, capacity=self.chamber_capacity)
 
+    def _clear(self):
         self.total = 0
         self.completed = 0
 
@@ -91,10 +99,24 @@ class Station4Sim:
         }
 
         self._job_start_t = None
-        self.env.process(self._worker())
+        self.process(self._worker())
 
     def reset(self, chamber_capacity: int = 1, seed: int = RANDOM_SEED_ST4):
-        self.__init__(chamber_capacity=chamber_capacity, seed=seed)
+        # new Environment at the same model time, with an empty Store and chamber
+        random.seed(seed)
+        self.chamber_capacity = int(chamber_capacity)
+        self.reset_env()
+        self._clear()
+
+    def job_in_flight(self):
+        return self.current_job is not None
+
+    def resume_job(self, job):
+        self.queue.put(job)
+        self.resume_idle()
+
+    def resume_idle(self):
+        self.process(self._worker())
 
     def submit(self, batch_id: int, recipe_id: int):
         job = ST4Job(batch_id=batch_id, recipe_id=recipe_id, enqueue_t=self.env.now)
@@ -103,6 +125,7 @@ class Station4Sim:
     def _worker(self):
         while True:
             job = yield self.queue.get()
+            self.mark_job(job)
             self.current_job = job
             self.total += 1
             self._job_start_t = self.env.now
@@ -139,6 +162,7 @@ class Station4Sim:
                 "fault": int(fault),
                 "done_pulse": 1 if passed else 0,
                 "cycle_time_s": cycle_s,
+                "end_t": end_t,
             })
 
             if passed:
@@ -226,10 +250,13 @@ class ST4_CalibrationTesting:
 
 				# Start of user custom code region. Please apply edits only within these regions:  Before sending the packet
 
+				now_ns = vsiCommonPythonApi.getSimulationTimeInNs()
+				t_end_ns = now_ns + int(self.simulationStep or 0)
 				reset_edge = (self.mySignals.cmd_reset == 1 and self._st4_prev_reset == 0)
 				self._st4_prev_reset = self.mySignals.cmd_reset
 
 				if reset_edge:
+					self._st4.sync(now_ns)
 					self._st4.reset(chamber_capacity=1)
 					self.mySignals.ready = 1
 					self.mySignals.busy = 0
@@ -244,16 +271,18 @@ class ST4_CalibrationTesting:
 					self.mySignals.ready = 0
 					self.mySignals.busy = 0
 					self.mySignals.fault = 1
+					self._st4.hold(t_end_ns)
 				else:
 					pending = (len(self._st4.queue.items) > 0)
 					if (self.mySignals.cmd_start == 1 and self.mySignals.cmd_stop == 0):
 						if (not pending) and (self._st4.current_job is None) and (self._st4.last_result.get('busy', 0) == 0):
+							self._st4.sync(now_ns)
 							self._st4.submit(int(self.mySignals.batch_id), int(self.mySignals.recipe_id))
 
 					if self.mySignals.cmd_stop == 0:
-						dt_s = float(self.simulationStep) / 1e9 if self.simulationStep else 0.0
-						if dt_s > 0:
-							self._st4.env.run(until=self._st4.env.now + dt_s)
+						self._st4.advance(t_end_ns)
+					else:
+						self._st4.hold(t_end_ns)
 
 					res = self._st4.last_result
 					busy = int(res.get('busy', 0))
@@ -270,6 +299,10 @@ class ST4_CalibrationTesting:
 					if done_pulse == 1:
 						self.mySignals.done = 1
 						self._st4.last_result['done_pulse'] = 0
+						# exact VSI time of the completion inside this step, not the tick
+						done_ns = self._st4.step_time_ns(res.get('end_t'))
+						if done_ns is not None:
+							self.mySignals.done_time_ns = done_ns
 
 					self.mySignals.cycle_time_ms = int(float(res.get('cycle_time_s', 0.0)) * 1000.0)
 					self.mySignals.total = int(self._st4.total)
@@ -312,6 +345,8 @@ class ST4_CalibrationTesting:
 				print(self.mySignals.total)
 				print("\tcompleted =", end = " ")
 				print(self.mySignals.completed)
+				print("\tdone_time_ns =", end = " ")
+				print(self.mySignals.done_time_ns)
 				print("\n\n")
 
 				self.updateInternalVariables()
@@ -398,6 +433,8 @@ class ST4_CalibrationTesting:
 
 		bytesToSend += self.packBytes('L', self.mySignals.completed)
 
+		bytesToSend += self.packBytes('Q', self.mySignals.done_time_ns)
+
 		#Send ethernet packet to PLC_LineCoordinator
 		vsiEthernetPythonGateway.sendEthernetPacket(PLC_LineCoordinatorSocketPortNumber0, bytes(bytesToSend))
 
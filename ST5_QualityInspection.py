@@ -30,6 +30,7 @@ class MySignals:
         self.accept = 0
         self.reject = 0
         self.last_accept = 0
+        self.done_time_ns = 0
 
 
 
@@ -46,6 +47,7 @@ ST5_QualityInspection0 = 0
 # Start of user custom code region. Please apply edits only within these regions:  Global Variables & Definitions
 import random
 import simpy
+from station_runtime import LazyRuntime
 
 # -----------------------------
 # Station 5: Quality Inspection + Diverter (SimPy core)
@@ -60,19 +62,41 @@ import simpy
 # - PLC controls via cmd_start/cmd_stop/cmd_reset.
 # - We step SimPy in the mainThread loop and copy results to mySignals.
 
+# Stage times (seconds)
+ST5_T_CAPTURE_S = 0.4      # positioning + camera capture
+ST5_T_COMPUTE_S = 0.8      # vision/measurement compute
+ST5_T_COMPARE_S = 0.3      # rules/spec compare
+ST5_T_WIPE_S = 0.6         # re-inspection: manual wipe / reposition
+ST5_T_RECOMPUTE_S = 0.5    # re-inspection: faster re-run
+ST5_T_DIVERT_S = 0.2       # diverter actuation
+
+# Inspection cell fault during setup (latched, PLC must reset)
+ST5_P_FAULT = 0.005
+ST5_T_FAULT_S = 0.2
+
+# Accept rate per recipe, and the re-inspection recovery
+ST5_ACCEPT_BASE = 0.88
+ST5_ACCEPT_STEP = 0.02     # per (recipe_id % 5)
+ST5_ACCEPT_MIN = 0.70
+ST5_ACCEPT_MAX = 0.97
+ST5_RECHECK_GAIN = 0.12
+ST5_RECHECK_CAP = 0.95
+
 def _st5_accept_rate(recipe_id: int) -> float:
     # Tune per recipe: different printer variants have different pass rates.
-    base = 0.88
+    base = ST5_ACCEPT_BASE
     if int(recipe_id) == 0:
         return base
     # small variation but clamped
-    return max(0.70, min(0.97, base - (int(recipe_id) % 5) * 0.02))
+    return max(ST5_ACCEPT_MIN, min(ST5_ACCEPT_MAX, base - (int(recipe_id) % 5) * ST5_ACCEPT_STEP))
 
-class _ST5SimModel:
+class _ST5SimModel(LazyRuntime):
     def __init__(self, random_seed: int = 5):
         random.seed(int(random_seed))
-        self.env = simpy.Environment()
+        LazyRuntime.__init__(self)
+        self._clear()
 
+    def _clear(self):
         # state
         self.busy = False
         self.fault_latched = False
@@ -82,6 +106,7 @@ class _ST5SimModel:
         self.reject = 0
         self.last_accept = 0  # bool as int
         self.last_cycle_time_s = 0.0
+        self.last_end_t = None
         self._done_pulse = False
 
         # internal
@@ -90,8 +115,10 @@ class _ST5SimModel:
         self._current_recipe = 0
 
     def reset(self, random_seed: int = 5):
-        # rebuild everything (fast + clean)
-        self.__init__(random_seed=random_seed)
+        # new Environment at the same model time, fresh KPIs and RNG
+        random.seed(int(random_seed))
+        self.reset_env()
+        self._clear()
 
     def start_unit(self, batch_id: int, recipe_id: int) -> bool:
         if self.fault_latched:
@@ -99,18 +126,18 @@ class _ST5SimModel:
         if self.busy:
             return False
 
+        self.mark_job(batch_id, recipe_id)
         self.busy = True
         self._current_batch = int(batch_id)
         self._current_recipe = int(recipe_id)
-        self._active_proc = self.env.process(self._unit_process(batch_id, recipe_id))
+        self._active_proc = self.process(self._unit_process(batch_id, recipe_id))
         return True
 
-    def step(self, dt_s: float):
-        if dt_s <= 0:
-            return
-        # advance time
-        target = self.env.now + float(dt_s)
-        self.env.run(until=target)
+    def job_in_flight(self):
+        return self.busy
+
+    def resume_job(self, batch_id: int, recipe_id: int):
+        self.start_unit(batch_id, recipe_id)
 
     def pop_done_pulse(self) -> bool:
         if self._done_pulse:
@@ -123,21 +150,21 @@ class _ST5SimModel:
         t0 = self.env.now
 
         # Small chance of inspection cell fault (camera/fixture/jig)
-        if random.random() < 0.005:
+        if random.random() < ST5_P_FAULT:
             # fault happens during setup
-            yield self.env.timeout(0.2)
+            yield self.env.timeout(ST5_T_FAULT_S)
             self.fault_latched = True
             self.busy = False
             return
 
         # Stage 1: positioning + camera capture
-        yield self.env.timeout(0.4)
+        yield self.env.timeout(ST5_T_CAPTURE_S)
 
         # Stage 2: vision/measurement compute
-        yield self.env.timeout(0.8)
+        yield self.env.timeout(ST5_T_COMPUTE_S)
 
         # Stage 3: rules/spec compare
-        yield self.env.timeout(0.3)
+        yield self.env.timeout(ST5_T_COMPARE_S)
 
         # Decision
         p_accept = _st5_accept_rate(recipe_id)
@@ -146,14 +173,14 @@ class _ST5SimModel:
         # Optional re-inspection once (rework loop)
         if not decision_accept:
             # quick manual wipe / reposition
-            yield self.env.timeout(0.6)
+            yield self.env.timeout(ST5_T_WIPE_S)
             # re-run compute faster
-            yield self.env.timeout(0.5)
+            yield self.env.timeout(ST5_T_RECOMPUTE_S)
             # partial recovery chance
-            decision_accept = (random.random() < min(0.95, p_accept + 0.12))
+            decision_accept = (random.random() < min(ST5_RECHECK_CAP, p_accept + ST5_RECHECK_GAIN))
 
         # Diverter actuation
-        yield self.env.timeout(0.2)
+        yield self.env.timeout(ST5_T_DIVERT_S)
 
         # Update KPIs
         self.last_accept = 1 if decision_accept else 0
@@ -163,6 +190,7 @@ class _ST5SimModel:
             self.reject += 1
 
         self.last_cycle_time_s = float(self.env.now - t0)
+        self.last_end_t = self.env.now
         self._done_pulse = True
         self.busy = False
 # End of user custom code region. Please don't edit beyond this point.
@@ -253,6 +281,9 @@ class ST5_QualityInspection:
                 except Exception:
                     self._sim_dt_s = 0.1
 
+                now_ns = vsiCommonPythonApi.getSimulationTimeInNs()
+                t_end_ns = now_ns + int(round(self._sim_dt_s * 1e9))
+
                 # --- detect reset edge ---
                 cmd_reset = 1 if self.mySignals.cmd_reset else 0
                 cmd_stop = 1 if self.mySignals.cmd_stop else 0
@@ -262,6 +293,7 @@ class ST5_QualityInspection:
                     if not self._reset_handled:
                         print("ST5: Receiving RESET command (stop=1, reset=1)")
                         # hard reset: rebuild the SimPy model and clear outputs
+                        self._st5.sync(now_ns)
                         self._st5.reset(random_seed=5)
                         self.mySignals.accept = 0
                         self.mySignals.reject = 0
@@ -280,6 +312,8 @@ class ST5_QualityInspection:
                         self.mySignals.ready = 1
                         self.mySignals.busy = 0
                         self._initialized = True
+                    # re-arm so the next PLC reset (e.g. FAULT_RESET) is honoured
+                    self._reset_handled = False
 
                 self._prev_cmd_reset = cmd_reset
 
@@ -294,6 +328,7 @@ class ST5_QualityInspection:
                     self.mySignals.ready = 0
                     self.mySignals.busy = 0
                     self.mySignals.done = 0
+                    self._st5.hold(t_end_ns)
                 else:
                     self.mySignals.fault = 0
 
@@ -303,20 +338,23 @@ class ST5_QualityInspection:
                         self.mySignals.ready = 0
                         self.mySignals.busy = 1 if self._st5.busy else 0
                         self.mySignals.done = 0
+                        self._st5.hold(t_end_ns)
                     elif reset_en:
                         # Reset mode - station is not ready
                         self.mySignals.ready = 0
                         self.mySignals.busy = 0
                         self.mySignals.done = 0
+                        self._st5.hold(t_end_ns)
                     else:
                         # Normal operation (not stopped, not reset)
                         # start new unit if enabled and idle
                         if start_en and (not self._st5.busy) and self._initialized:
+                            self._st5.sync(now_ns)
                             self._st5.start_unit(self.mySignals.batch_id, self.mySignals.recipe_id)
 
-                        # step sim time only when not stopped and initialized
-                        if start_en and self._initialized:
-                            self._st5.step(self._sim_dt_s)
+                        # follow VSI time; env.run only on ticks where a unit event is due
+                        if self._initialized:
+                            self._st5.advance(t_end_ns)
 
                         # update outputs snapshot
                         if self._initialized:
@@ -325,6 +363,10 @@ class ST5_QualityInspection:
 
                             # done pulse
                             self.mySignals.done = 1 if self._st5.pop_done_pulse() else 0
+                            # exact VSI time of the completion inside this step, not the tick
+                            done_ns = self._st5.step_time_ns(self._st5.last_end_t)
+                            if self.mySignals.done and done_ns is not None:
+                                self.mySignals.done_time_ns = done_ns
 
                             # cycle time in ms (last completed)
                             self.mySignals.cycle_time_ms = int(self._st5.last_cycle_time_s * 1000.0)
@@ -378,6 +420,8 @@ class ST5_QualityInspection:
                 print(self.mySignals.reject)
                 print("\tlast_accept =", end = " ")
                 print(self.mySignals.last_accept)
+                print("\tdone_time_ns =", end = " ")
+                print(self.mySignals.done_time_ns)
                 print("\n\n")
 
                 self.updateInternalVariables()
@@ -466,6 +510,8 @@ class ST5_QualityInspection:
 
         bytesToSend += self.packBytes('?', self.mySignals.last_accept)
 
+        bytesToSend += self.packBytes('Q', self.mySignals.done_time_ns)
+
         #Send ethernet packet to PLC_LineCoordinator
         vsiEthernetPythonGateway.sendEthernetPacket(PLC_LineCoordinatorSocketPortNumber0, bytes(bytesToSend))
 
@@ -33,6 +33,7 @@ class MySignals:
         self.operational_time_s = 0
         self.downtime_s = 0
         self.availability = 0
+        self.done_time_ns = 0
 
 
 
@@ -49,6 +50,7 @@ ST6_PackagingDispatch0 = 0
 # Start of user custom code region. Please apply edits only within these regions:  Global Variables & Definitions
 import random
 import simpy
+from station_runtime import LazyRuntime
 
 # -----------------------------
 # Station 6: Packaging + Dispatch (SimPy core)
@@ -62,19 +64,36 @@ import simpy
 # - PLC controls via cmd_start/cmd_stop/cmd_reset.
 # - We step SimPy in the mainThread loop and copy results to mySignals.
 
-class _ST6SimModel:
+# Packing steps in order: name -> (fault probability, repair s, operate s)
+ST6_STEPS = {
+    "carton_erect": (0.010, 5.0, 1.0),
+    "pick_place":   (0.015, 6.0, 1.2),
+    "flap_fold":    (0.008, 4.5, 1.5),
+    "tape_seal":    (0.010, 5.5, 1.2),
+    "label_apply":  (0.010, 5.0, 1.0),
+    "outfeed":      (0.005, 4.0, 0.8),
+}
+
+# Consumables: units in stock after reset / after a refill, refill downtime (s)
+ST6_STOCK_INITIAL = 12
+ST6_STOCK_REFILL = 25
+ST6_REFILL_S = {"carton": 4.0, "tape": 3.0, "label": 3.5}
+
+class _ST6SimModel(LazyRuntime):
     def __init__(self, random_seed: int = 6):
         random.seed(int(random_seed))
-        self.env = simpy.Environment()
+        LazyRuntime.__init__(self)
+        self._clear()
 
+    def _clear(self):
         # state
         self.busy = False
         self.fault_latched = False
 
         # stocks
-        self.carton_stock = 12
-        self.tape_stock = 12
-        self.label_stock = 12
+        self.carton_stock = ST6_STOCK_INITIAL
+        self.tape_stock = ST6_STOCK_INITIAL
+        self.label_stock = ST6_STOCK_INITIAL
 
         # KPIs
         self.packages_completed = 0
@@ -86,18 +105,22 @@ class _ST6SimModel:
 
         # last cycle
         self.last_cycle_time_s = 0.0
+        self.last_end_t = None
         self._done_pulse = False
 
         self._active_proc = None
 
     def reset(self, random_seed: int = 6):
-        self.__init__(random_seed=random_seed)
+        # new Environment at the same model time, fresh KPIs and RNG
+        random.seed(int(random_seed))
+        self.reset_env()
+        self._clear()
+
+    def job_in_flight(self):
+        return self.busy
 
-    def step(self, dt_s: float):
-        if dt_s <= 0:
-            return
-        target = self.env.now + float(dt_s)
-        self.env.run(until=target)
+    def resume_job(self, batch_id: int, recipe_id: int):
+        self.start_unit(batch_id, recipe_id)
 
     def pop_done_pulse(self) -> bool:
         if self._done_pulse:
@@ -109,8 +132,9 @@ class _ST6SimModel:
         # batch_id/recipe_id not used deeply here, but kept for realism/extensions
         if self.fault_latched or self.busy:
             return False
+        self.mark_job(batch_id, recipe_id)
         self.busy = True
-        self._active_proc = self.env.process(self._pack_one_unit(batch_id, recipe_id))
+        self._active_proc = self.process(self._pack_one_unit(batch_id, recipe_id))
         return True
 
     # -------- helpers --------
@@ -135,19 +159,25 @@ class _ST6SimModel:
             return True
         return False
 
+    def _run_step(self, name: str):
+        p_fault, repair_s, operate_s = ST6_STEPS[name]
+        if self._maybe_fault(p_fault):
+            yield from self._repair(repair_s)
+        yield self._operate(operate_s)
+
     def _refill(self, kind: str):
         # simple refill delay (operator refills)
         if kind == "carton":
-            yield self._downtime(4.0)
-            self.carton_stock = 25
+            yield self._downtime(ST6_REFILL_S["carton"])
+            self.carton_stock = ST6_STOCK_REFILL
         elif kind == "tape":
-            yield self._downtime(3.0)
-            self.tape_stock = 25
+            yield self._downtime(ST6_REFILL_S["tape"])
+            self.tape_stock = ST6_STOCK_REFILL
         elif kind == "label":
-            yield self._downtime(3.5)
-            self.label_stock = 25
+            yield self._downtime(ST6_REFILL_S["label"])
+            self.label_stock = ST6_STOCK_REFILL
 
-    def _repair(self, seconds: float = 5.0):
+    def _repair(self, seconds: float):
         self.total_repairs += 1
         yield self._downtime(seconds)
 
@@ -164,46 +194,35 @@ class _ST6SimModel:
             yield from self._refill("label")
 
         # Step 1: carton erect
-        if self._maybe_fault(0.010):
-            yield from self._repair(5.0)
-        yield self._operate(1.0)
+        yield from self._run_step("carton_erect")
         self.carton_stock -= 1
 
         # Step 2: robot pick+place
-        if self._maybe_fault(0.015):
-            yield from self._repair(6.0)
-        yield self._operate(1.2)
+        yield from self._run_step("pick_place")
         self.arm_cycles += 1
 
         # Step 3: flap fold
-        if self._maybe_fault(0.008):
-            yield from self._repair(4.5)
-        yield self._operate(1.5)
+        yield from self._run_step("flap_fold")
 
         # Step 4: tape seal
         if self.tape_stock <= 0:
             yield from self._refill("tape")
-        if self._maybe_fault(0.010):
-            yield from self._repair(5.5)
-        yield self._operate(1.2)
+        yield from self._run_step("tape_seal")
         self.tape_stock -= 1
 
         # Step 5: label apply
         if self.label_stock <= 0:
             yield from self._refill("label")
-        if self._maybe_fault(0.010):
-            yield from self._repair(5.0)
-        yield self._operate(1.0)
+        yield from self._run_step("label_apply")
         self.label_stock -= 1
 
         # Step 6: outfeed
-        if self._maybe_fault(0.005):
-            yield from self._repair(4.0)
-        yield self._operate(0.8)
+        yield from self._run_step("outfeed")
 
         # Complete
         self.packages_completed += 1
         self.last_cycle_time_s = float(self.env.now - t0)
+        self.last_end_t = self.env.now
         self._done_pulse = True
         self.busy = False
 # End of user custom code region. Please don't edit beyond this point.
@@ -294,9 +313,13 @@ class ST6_PackagingDispatch:
                 except Exception:
                     self._sim_dt_s = 0.1
 
+                now_ns = vsiCommonPythonApi.getSimulationTimeInNs()
+                t_end_ns = now_ns + int(round(self._sim_dt_s * 1e9))
+
                 # --- detect reset edge ---
                 cmd_reset = 1 if self.mySignals.cmd_reset else 0
                 if cmd_reset == 1 and self._prev_cmd_reset == 0:
+                    self._st6.sync(now_ns)
                     self._st6.reset(random_seed=6)
                     # clear outputs
                     self.mySignals.done = 0
@@ -322,6 +345,7 @@ class ST6_PackagingDispatch:
                     self.mySignals.ready = 0
                     self.mySignals.busy = 0
                     self.mySignals.done = 0
+                    self._st6.hold(t_end_ns)
                 else:
                     self.mySignals.fault = 0
 
@@ -330,19 +354,24 @@ class ST6_PackagingDispatch:
                         self.mySignals.ready = 0
                         self.mySignals.busy = 1 if self._st6.busy else 0
                         self.mySignals.done = 0
+                        self._st6.hold(t_end_ns)
                     else:
                         # start a new package cycle if enabled and idle
                         if start_en and (not self._st6.busy):
+                            self._st6.sync(now_ns)
                             self._st6.start_unit(self.mySignals.batch_id, self.mySignals.recipe_id)
 
-                        # advance time only when started
-                        if start_en:
-                            self._st6.step(self._sim_dt_s)
+                        # follow VSI time; env.run only on ticks where a package event is due
+                        self._st6.advance(t_end_ns)
 
                         # snapshot outputs
                         self.mySignals.busy = 1 if self._st6.busy else 0
                         self.mySignals.ready = 1 if (not self._st6.busy) else 0
                         self.mySignals.done = 1 if self._st6.pop_done_pulse() else 0
+                        # exact VSI time of the completion inside this step, not the tick
+                        done_ns = self._st6.step_time_ns(self._st6.last_end_t)
+                        if self.mySignals.done and done_ns is not None:
+                            self.mySignals.done_time_ns = done_ns
                         self.mySignals.cycle_time_ms = int(self._st6.last_cycle_time_s * 1000.0)
 
                         self.mySignals.packages_completed = int(self._st6.packages_completed)
@@ -397,6 +426,8 @@ class ST6_PackagingDispatch:
                 print(self.mySignals.downtime_s)
                 print("\tavailability =", end = " ")
                 print(self.mySignals.availability)
+                print("\tdone_time_ns =", end = " ")
+                print(self.mySignals.done_time_ns)
                 print("\n\n")
 
                 self.updateInternalVariables()
@@ -491,6 +522,8 @@ class ST6_PackagingDispatch:
 
         bytesToSend += self.packBytes('d', self.mySignals.availability)
 
+        bytesToSend += self.packBytes('Q', self.mySignals.done_time_ns)
+
         #Send ethernet packet to PLC_LineCoordinator
         vsiEthernetPythonGateway.sendEthernetPacket(PLC_LineCoordinatorSocketPortNumber0, bytes(bytesToSend))
 
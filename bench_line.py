@@ -0,0 +1,175 @@
+# pythonGateways/bench_line.py
+"""
+End-to-end line benchmark: PLC + ST1..ST6 run headless (headless_line.py)
+for fixed seeds and a fixed horizon.
+
+Each seed runs in a fresh child process so module state and peak RSS are
+per-run. Reported per run and as the median across seeds:
+  sim_s_per_wall_s, scans_per_s, packets_decoded_per_s, peak_rss_kb
+
+    python bench_line.py                          # compare to bench_baseline.json
+    python bench_line.py --update-baseline        # store the current numbers
+    python bench_line.py --horizon 600 --seeds 1  # quick check
+
+Exit code 1 when a throughput metric drops more than --threshold below the
+baseline (or peak RSS grows more than --threshold above it). The committed
+bench_baseline.json was recorded on the CI reference VM; re-record it with
+--update-baseline when that machine changes, never to make a run pass.
+"""
+import argparse
+import json
+import os
+import platform
+import statistics
+import subprocess
+import sys
+import time
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+
+DEFAULT_SEEDS = (1, 2, 3)
+DEFAULT_HORIZON_S = 1800.0
+DEFAULT_THRESHOLD = 0.15
+DEFAULT_OUT = "bench_results.json"
+DEFAULT_BASELINE = os.path.join(HERE, "bench_baseline.json")
+
+# metric -> +1 higher is better, -1 lower is better
+METRICS = {
+    "sim_s_per_wall_s": +1,
+    "scans_per_s": +1,
+    "packets_decoded_per_s": +1,
+    "peak_rss_kb": -1,
+}
+
+
+def _peak_rss_kb():
+    try:
+        import resource
+    except ImportError:  # Windows
+        return 0
+    rss = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+    # bytes on macOS, kilobytes on Linux
+    return int(rss / 1024) if sys.platform == "darwin" else int(rss)
+
+
+def _child(horizon_s, step_ms, seed):
+    from headless_line import run_line
+    res = run_line(horizon_s=horizon_s, step_ms=step_ms, seed=seed, quiet="devnull")
+    res["peak_rss_kb"] = _peak_rss_kb()
+    kpis = res.pop("kpis", {}) or {}
+    res["packages_completed"] = int(kpis.get("packages_completed", 0))
+    res["plc_state"] = kpis.get("plc_state", "")
+    res["errors"] = len(res.get("errors") or [])
+    sys.stdout.write(json.dumps(res) + "\n")
+
+
+def run_case(horizon_s, step_ms, seed, timeout_s=None):
+    cmd = [sys.executable, os.path.abspath(__file__), "--_child",
+           "--horizon", str(horizon_s), "--seeds", str(seed)]
+    if step_ms is not None:
+        cmd += ["--step-ms", str(step_ms)]
+    p = subprocess.run(cmd, cwd=HERE, capture_output=True, text=True, timeout=timeout_s)
+    if p.returncode != 0:
+        raise RuntimeError(f"seed {seed} failed (rc={p.returncode}):\n{p.stderr.strip()}")
+    return json.loads(p.stdout.strip().splitlines()[-1])
+
+
+def run_suite(horizon_s=DEFAULT_HORIZON_S, seeds=DEFAULT_SEEDS, step_ms=None, timeout_s=None):
+    runs = []
+    for seed in seeds:
+        r = run_case(horizon_s, step_ms, seed, timeout_s)
+        print(f"  seed={seed:<4} sim/wall={r['sim_s_per_wall_s']:8.1f}  scans/s={r['scans_per_s']:8.1f}  "
+              f"pkts/s={r['packets_decoded_per_s']:9.1f}  rss={r['peak_rss_kb'] / 1024:6.1f} MiB  "
+              f"packages={r['packages_completed']}")
+        runs.append(r)
+    median = {m: statistics.median(r[m] for r in runs) for m in METRICS}
+    return {
+        "created": time.strftime("%Y-%m-%dT%H:%M:%S"),
+        "host": platform.node(),
+        "python": platform.python_version(),
+        "horizon_s": float(horizon_s),
+        "step_ms": runs[0]["step_ms"] if runs else step_ms,
+        "seeds": list(seeds),
+        "median": median,
+        "runs": runs,
+    }
+
+
+def compare(result, baseline, threshold):
+    """Return a list of regression messages (empty when within threshold)."""
+    bad = []
+    base = baseline.get("median", {})
+    for m, sign in METRICS.items():
+        b = float(base.get(m, 0) or 0)
+        cur = float(result["median"].get(m, 0) or 0)
+        if b <= 0:
+            continue
+        delta = (cur - b) / b
+        tag = "ok"
+        if (sign > 0 and delta < -threshold) or (sign < 0 and delta > threshold):
+            tag = "REGRESSION"
+            bad.append(f"{m}: {cur:.1f} vs baseline {b:.1f} ({delta * 100:+.1f}%)")
+        print(f"  {m:<24}{cur:>12.1f}{b:>12.1f}{delta * 100:>+9.1f}%  {tag}")
+    return bad
+
+
+def main(argv=None):
+    ap = argparse.ArgumentParser(description="Headless end-to-end line benchmark")
+    ap.add_argument("--horizon", type=float, default=DEFAULT_HORIZON_S, help="simulated seconds per run")
+    ap.add_argument("--step-ms", type=float, default=None, help="VSI simulation step (headless_line default)")
+    ap.add_argument("--seeds", default=",".join(str(s) for s in DEFAULT_SEEDS), help="comma-separated seeds")
+    ap.add_argument("--out", default=DEFAULT_OUT, help="results JSON")
+    ap.add_argument("--baseline", default=DEFAULT_BASELINE)
+    ap.add_argument("--threshold", type=float, default=DEFAULT_THRESHOLD, help="allowed relative regression")
+    ap.add_argument("--update-baseline", action="store_true")
+    ap.add_argument("--timeout", type=float, default=None, help="per-run wall timeout in seconds")
+    ap.add_argument("--_child", action="store_true", help=argparse.SUPPRESS)
+    a = ap.parse_args(argv)
+
+    seeds = [int(s) for s in str(a.seeds).split(",") if s.strip()]
+
+    if a._child:
+        _child(a.horizon, a.step_ms if a.step_ms is not None else _default_step_ms(), seeds[0])
+        return 0
+
+    print(f"Line benchmark: horizon={a.horizon:.0f}s seeds={seeds}")
+    result = run_suite(a.horizon, seeds, a.step_ms, a.timeout)
+
+    with open(a.out, "w", encoding="utf-8") as f:
+        json.dump(result, f, indent=2)
+    print(f"Results written to {a.out}")
+
+    if a.update_baseline:
+        with open(a.baseline, "w", encoding="utf-8") as f:
+            json.dump(result, f, indent=2)
+        print(f"Baseline updated: {a.baseline}")
+        return 0
+
+    if not os.path.exists(a.baseline):
+        print(f"No baseline at {a.baseline}; run with --update-baseline to create one")
+        return 0
+
+    with open(a.baseline, "r", encoding="utf-8") as f:
+        baseline = json.load(f)
+    if (baseline.get("horizon_s") != result["horizon_s"]
+            or baseline.get("step_ms") != result["step_ms"]
+            or baseline.get("seeds") != result["seeds"]):
+        print("WARNING: baseline was recorded with a different horizon/step/seeds")
+
+    print(f"  {'metric':<24}{'current':>12}{'baseline':>12}{'delta':>10}")
+    bad = compare(result, baseline, a.threshold)
+    if bad:
+        print("Benchmark regression past threshold:")
+        for msg in bad:
+            print("  " + msg)
+        return 1
+    return 0
+
+
+def _default_step_ms():
+    from headless_line import DEFAULT_STEP_MS
+    return DEFAULT_STEP_MS
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,176 @@
+# pythonGateways/bench_log_ingest.py
+"""
+Log-ingestion micro-benchmark for live_log_dashboard_web_station_VSI_full.py.
+
+Drives the dashboard's Engine exactly like the live path does, minus the
+file tailing: every synthetic line goes through TailThread._process_line()
+(BlockParser.feed_line + queue), and every broadcast tick runs
+Engine.pump_once() (StatsStore.handle_*), export_payload() and json.dumps().
+
+Ticks follow the dashboard broadcaster (one every BROADCAST_PERIOD_S); at a
+given --rate the lines arriving within one period are processed per tick.
+If processing a tick takes longer than the period, the dashboard lags.
+
+    python bench_log_ingest.py                       # 6 stations + PLC, 1 scan/s
+    python bench_log_ingest.py --stations 24 --rate 10 --scans 2000
+"""
+import argparse
+import json
+import statistics
+import sys
+import time
+
+import live_log_dashboard_web_station_VSI_full as dash
+from log_synth import LogSynth, log_path
+from scan_profiler import HdrHistogram
+
+BROADCAST_PERIOD_S = 0.12   # asyncio.sleep() in dash.broadcaster()
+
+
+class _Timed:
+    """Wraps a bound method and records its wall time (ns) per call."""
+
+    def __init__(self, fn, hist):
+        self.fn = fn
+        self.hist = hist
+
+    def __call__(self, *a, **kw):
+        t0 = time.perf_counter_ns()
+        try:
+            return self.fn(*a, **kw)
+        finally:
+            self.hist.record(time.perf_counter_ns() - t0)
+
+
+def run(stations=6, scans=1000, rate=1.0, step_ms=1000, seed=1, plc=True):
+    """
+    rate = simulation scans per wall second produced by the line
+    (1000/step_ms for a real-time VSI run).
+    """
+    synth = LogSynth(stations=stations, step_ms=step_ms, seed=seed, plc=plc)
+    files = {c: log_path("log", c) for c in synth.components}
+    engine = dash.Engine(list(files.values()), from_start=True)   # tailers are never started
+    tailers = {t.filepath: t for t in engine.tailers}
+
+    h_line = HdrHistogram()       # feed_line + enqueue, per line
+    h_snap = HdrHistogram()       # StatsStore.handle_snapshot, per block
+    h_pump = HdrHistogram()       # Engine.pump_once, per tick
+    h_export = HdrHistogram()     # export_payload, per tick
+    h_json = HdrHistogram()       # json.dumps, per tick
+    h_tick = HdrHistogram()       # whole tick incl. parsing of its lines
+    payload_bytes = []
+
+    engine.store.handle_snapshot = _Timed(engine.store.handle_snapshot, h_snap)
+
+    # pre-generate so generator cost is not measured
+    scan_blocks = [synth.blocks() for _ in range(int(scans))]
+    scans_per_tick = max(1, int(round(float(rate) * BROADCAST_PERIOD_S))) if rate else 1
+
+    total_lines = 0
+    lagged_ticks = 0
+    perf = time.perf_counter_ns
+    t_start = perf()
+    for k in range(0, len(scan_blocks), scans_per_tick):
+        t_tick = perf()
+        for blocks in scan_blocks[k:k + scans_per_tick]:
+            for comp, lines in blocks:
+                tailer = tailers[files[comp]]
+                for line in lines:
+                    t0 = perf()
+                    tailer._process_line(line + "\n")
+                    h_line.record(perf() - t0)
+                total_lines += len(lines)
+
+        t0 = perf()
+        engine.pump_once()
+        t1 = perf()
+        payload = engine.store.export_payload()
+        t2 = perf()
+        msg = json.dumps(payload)
+        t3 = perf()
+        h_pump.record(t1 - t0)
+        h_export.record(t2 - t1)
+        h_json.record(t3 - t2)
+        h_tick.record(t3 - t_tick)
+        payload_bytes.append(len(msg.encode("utf-8")))
+        if (t3 - t_tick) / 1e9 > BROADCAST_PERIOD_S:
+            lagged_ticks += 1
+    wall_s = (perf() - t_start) / 1e9
+
+    def stage(h):
+        return {
+            "count": h.count,
+            "mean_us": h.mean() / 1e3,
+            "p50_us": h.percentile(50) / 1e3,
+            "p99_us": h.percentile(99) / 1e3,
+            "max_us": h.max / 1e3,
+        }
+
+    lines_per_s = total_lines / wall_s if wall_s > 0 else 0.0
+    lines_per_scan = total_lines / float(len(scan_blocks) or 1)
+    return {
+        "stations": int(stations),
+        "plc": bool(plc),
+        "scans": len(scan_blocks),
+        "rate_scans_per_s": float(rate),
+        "lines": total_lines,
+        "wall_s": wall_s,
+        "lines_per_s": lines_per_s,
+        "snapshots_per_s": h_snap.count / wall_s if wall_s > 0 else 0.0,
+        # scans/s the dashboard could ingest before falling behind
+        "max_scans_per_s": lines_per_s / lines_per_scan if lines_per_scan else 0.0,
+        "ticks": h_tick.count,
+        "lagged_ticks": lagged_ticks,
+        "stages": {
+            "feed_line": stage(h_line),
+            "handle_snapshot": stage(h_snap),
+            "pump_once": stage(h_pump),
+            "export_payload": stage(h_export),
+            "json_dumps": stage(h_json),
+            "tick": stage(h_tick),
+        },
+        "payload_bytes": {
+            "last": payload_bytes[-1] if payload_bytes else 0,
+            "median": int(statistics.median(payload_bytes)) if payload_bytes else 0,
+            "max": max(payload_bytes) if payload_bytes else 0,
+        },
+    }
+
+
+def format_result(r):
+    out = [f"Log ingest: {r['stations']} stations{' + PLC' if r['plc'] else ''}, {r['scans']} scans, "
+           f"{r['lines']} lines in {r['wall_s']:.2f}s",
+           f"  throughput   {r['lines_per_s']:,.0f} lines/s  {r['snapshots_per_s']:,.0f} snapshots/s  "
+           f"(~{r['max_scans_per_s']:,.1f} scans/s sustainable)",
+           f"  ticks        {r['ticks']} at {r['rate_scans_per_s']:g} scans/s, {r['lagged_ticks']} over "
+           f"{BROADCAST_PERIOD_S * 1000:.0f} ms",
+           f"  payload      last {r['payload_bytes']['last']:,} B  median {r['payload_bytes']['median']:,} B  "
+           f"max {r['payload_bytes']['max']:,} B",
+           f"  {'stage':<16}{'count':>9}{'mean_us':>11}{'p50_us':>11}{'p99_us':>11}{'max_us':>12}"]
+    for name, s in r["stages"].items():
+        out.append(f"  {name:<16}{s['count']:>9}{s['mean_us']:>11.1f}{s['p50_us']:>11.1f}"
+                   f"{s['p99_us']:>11.1f}{s['max_us']:>12.1f}")
+    return "\n".join(out)
+
+
+def main(argv=None):
+    ap = argparse.ArgumentParser(description="Benchmark dashboard log ingestion with synthetic VSI logs")
+    ap.add_argument("--stations", type=int, default=6)
+    ap.add_argument("--scans", type=int, default=1000)
+    ap.add_argument("--rate", type=float, default=1.0, help="scans per wall second arriving at the dashboard")
+    ap.add_argument("--step-ms", type=float, default=1000.0)
+    ap.add_argument("--seed", type=int, default=1)
+    ap.add_argument("--no-plc", action="store_true")
+    ap.add_argument("--json", default=None, help="also write the result to this file")
+    a = ap.parse_args(argv)
+
+    r = run(a.stations, a.scans, a.rate, a.step_ms, a.seed, plc=not a.no_plc)
+    print(format_result(r))
+    if a.json:
+        with open(a.json, "w", encoding="utf-8") as f:
+            json.dump(r, f, indent=2)
+    return 1 if r["lagged_ticks"] else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
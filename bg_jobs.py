@@ -0,0 +1,45 @@
+# pythonGateways/bg_jobs.py
+"""
+One background job at a time per kind (DOE, optimisation, forecast) for the
+dashboard, and ids for their runs.
+
+    _slot = JobSlot("a DOE")
+    run = _slot.start(DoeRun(points))    # ValueError while the last one is pending or running
+    _slot.current()                      # the latest job (any state) or None
+    new_id("doe")                        # "doe-20260101-120000-3f9a1c"
+
+A job is anything with run() and a state attribute ("pending", "running",
+"done", "error"). The slot marks it running before the thread starts, so
+a second POST arriving in between is refused rather than starting a twin.
+"""
+import threading
+import time
+import uuid
+
+BUSY_STATES = ("pending", "running")
+
+
+def new_id(prefix):
+    """prefix-YYYYmmdd-HHMMSS-xxxxxx: sorts by start time, unique within the second."""
+    return f"{prefix}-{time.strftime('%Y%m%d-%H%M%S')}-{uuid.uuid4().hex[:6]}"
+
+
+class JobSlot:
+    def __init__(self, what):
+        self.what = what
+        self._lock = threading.Lock()
+        self._job = None
+
+    def start(self, job):
+        """Run job in a daemon thread; raises ValueError if the previous one has not finished."""
+        with self._lock:
+            if self._job is not None and self._job.state in BUSY_STATES:
+                raise ValueError(f"{self.what} is already running")
+            job.state = "running"
+            self._job = job
+        threading.Thread(target=job.run, daemon=True).start()
+        return job
+
+    def current(self):
+        with self._lock:
+            return self._job
@@ -0,0 +1,244 @@
+# pythonGateways/checkpoint.py
+"""
+Checkpoint / restore of the whole headless line, for warm-start what-ifs.
+
+A snapshot is taken between two fabric steps (from HeadlessLine.on_step,
+where every component is parked in advanceSimulation) and holds:
+
+    fabric      time, step count and the packets in flight between components
+    per component
+        attrs   its picklable attributes: PLC _state, latches, buffers,
+                counters, watchdog/WIP/flow trackers, mySignals, ...
+        models  LazyRuntime.snapshot() of each station model: job in flight
+                (replayed on restore), stocks, counters, queued jobs
+        rng     the component's random module state
+    kpis        opt_dashboard KPI snapshot at that point
+    counters    the PLC's unit counts (never reset by a line reset)
+
+Any number of branches can then continue from the warmed-up point instead
+of replaying the warm-up each time:
+
+    snap, _ = warm_up(1800, seed=1)                 # run 30 min, keep the state
+    save(snap, "warm.ckpt")
+    base = branch(snap, 3600)                       # exact continuation
+    what_if = branch(snap, 3600, params={"fast_handoff": True})
+    what_if["window"]["throughput_per_min"]         # units/min over the branch only
+
+    python checkpoint.py warm --warmup 1800 --seed 1 --out warm.ckpt
+    python checkpoint.py branch warm.ckpt --horizon 3600 --param fast_handoff=true --seed 7
+
+A branch with the snapshot's seed (the default) reproduces the
+uninterrupted run; another seed gives an independent replication from the
+same state. Module constants (module_overrides) apply to a branch as usual,
+but values the components copied into attributes at start-up come from the
+snapshot; change those through params.
+
+Attributes that only wire a run to the outside (metrics, profiler, KPI
+bus, live params source) are not saved; the restored run sets its own up.
+Snapshots are pickles of the component classes: load them with the same
+module versions that wrote them.
+"""
+import argparse
+import json
+import pickle
+import sys
+import types
+
+import headless_line
+from station_runtime import LazyRuntime
+
+FORMAT = 1
+
+# per-run I/O wiring, left as the restored run's own constructor set it
+SKIP_ATTRS = frozenset({
+    "_metrics", "_metrics_port", "_prof", "_profile_scan", "_profile_out",
+    "_kpi_bus", "_kpi_bus_path", "_opt_port", "_live_params", "_params_src", "_params_version",
+})
+
+
+def _copy(v):
+    return pickle.loads(pickle.dumps(v))
+
+
+# ============================================================
+# Capture / restore
+# ============================================================
+def capture(line):
+    """Snapshot of a running HeadlessLine; call from its on_step callback."""
+    import opt_dashboard
+    fab = line.fabric
+    comps = {}
+    for comp in line.components:
+        if not comp.alive or comp.obj is None:
+            raise RuntimeError(f"{comp.module.__name__} is not running; checkpoint from on_step before the horizon")
+        attrs, models, skipped = {}, {}, []
+        for k, v in vars(comp.obj).items():
+            if k in SKIP_ATTRS or isinstance(v, types.MethodType):
+                # methods bound per instance (PLC _PlcMethods) come with the new obj
+                continue
+            if isinstance(v, LazyRuntime):
+                models[k] = v.snapshot()
+                continue
+            try:
+                attrs[k] = _copy(v)
+            except (pickle.PicklingError, TypeError, AttributeError):
+                skipped.append(k)
+        comps[comp.cid] = {
+            "module": comp.module.__name__,
+            "rng_state": comp.rng_state,
+            "packets": (comp.rx_packets, comp.tx_packets),
+            "attrs": attrs,
+            "models": models,
+            "skipped": skipped,
+        }
+    plc = line.plc
+    plc_mod = line.components[headless_line.PLC_ID].module
+    return {
+        "format": FORMAT,
+        "now_ns": fab.now_ns,
+        "step_ns": fab.step_ns,
+        "steps": fab.steps,
+        "seed": line.seed,
+        "fabric": _copy({"servers": fab._servers, "to_server": fab._to_server, "to_client": fab._to_client,
+                         "next_to_server": fab._next_to_server, "next_to_client": fab._next_to_client}),
+        "components": comps,
+        "kpis": opt_dashboard.build_kpi_snapshot(plc, plc.mySignals, plc_mod.STATIONS),
+        "counters": _counters(plc),
+    }
+
+
+def _counters(plc):
+    wip = plc.wip_summary()
+    return {k: wip[k] for k in ("units_started", "units_completed", "units_lost")}
+
+
+def restore_fabric(fab, snap):
+    q = _copy(snap["fabric"])
+    fab.steps = int(snap["steps"])
+    fab._servers = q["servers"]
+    fab._to_server, fab._to_client = q["to_server"], q["to_client"]
+    fab._next_to_server, fab._next_to_client = q["next_to_server"], q["next_to_client"]
+
+
+def restore_component(obj, state):
+    """Put a component's saved attributes and model states back onto a freshly built obj."""
+    for k, v in _copy(state["attrs"]).items():
+        setattr(obj, k, v)
+    for k, model_snap in state["models"].items():
+        getattr(obj, k).restore(model_snap)
+
+
+# ============================================================
+# Files
+# ============================================================
+def dumps(snap):
+    return pickle.dumps(snap, protocol=pickle.HIGHEST_PROTOCOL)
+
+
+def loads(data):
+    # the component modules must be importable (with the VSI stubs) before unpickling
+    for _, name, _ in headless_line.COMPONENTS:
+        headless_line.import_component(name)
+    snap = pickle.loads(data)
+    if snap.get("format") != FORMAT:
+        raise ValueError(f"checkpoint format {snap.get('format')}, expected {FORMAT}")
+    return snap
+
+
+def save(snap, path):
+    with open(path, "wb") as f:
+        f.write(dumps(snap))
+
+
+def load(path):
+    with open(path, "rb") as f:
+        return loads(f.read())
+
+
+# ============================================================
+# Warm-up and branches
+# ============================================================
+def warm_up(warmup_s, step_ms=headless_line.DEFAULT_STEP_MS, seed=None, **line_kwargs):
+    """Run the line for warmup_s and snapshot it there. Returns (snapshot, warm-up result)."""
+    at_ns = int(round(float(warmup_s) * 1e9)) + int(round(float(line_kwargs.get("start_s", 0.0)) * 1e9))
+    held = {}
+
+    def _grab(line):
+        if "snap" not in held and line.fabric.now_ns >= at_ns:
+            held["snap"] = capture(line)
+
+    # one step past the mark so every component is still inside its loop when it is taken
+    line = headless_line.HeadlessLine(horizon_s=float(warmup_s) + float(step_ms) / 1e3, step_ms=step_ms,
+                                      seed=seed, on_step=_grab, **line_kwargs)
+    res = line.run()
+    if "snap" not in held:
+        raise RuntimeError(f"line stopped before {warmup_s}s: {res['errors']}")
+    return held["snap"], res
+
+
+def _window(start, end, sim_s):
+    """
+    KPIs over a branch only, from the PLC unit counts at the checkpoint and
+    at the end (the station counters restart with every line reset).
+    """
+    d = {k: end[k] - start[k] for k in start}
+    done, lost = d["units_completed"], d["units_lost"]
+    return {
+        "sim_s": sim_s,
+        "units_started": d["units_started"],
+        "units_completed": done,
+        "units_lost": lost,
+        "throughput_per_min": done / (sim_s / 60.0) if sim_s > 0 else 0.0,
+        "yield_pct": done / (done + lost) * 100.0 if done + lost else 0.0,
+    }
+
+
+def branch(snap, horizon_s, params=None, seed=None, step_ms=None, **line_kwargs):
+    """Continue from snap for horizon_s; result as run_line() plus "window" KPIs for the branch."""
+    line = headless_line.HeadlessLine(horizon_s=horizon_s, step_ms=step_ms or snap["step_ns"] / 1e6,
+                                      seed=seed, restore=snap, params=params, **line_kwargs)
+    res = line.run()
+    res["window"] = _window(snap["counters"], _counters(line.plc), res["sim_s"]) if line.plc else {}
+    res["from_s"] = snap["now_ns"] / 1e9
+    return res
+
+
+# ============================================================
+# CLI
+# ============================================================
+def main(argv=None):
+    ap = argparse.ArgumentParser(description="Warm-start checkpoints of the headless line")
+    sub = ap.add_subparsers(dest="cmd", required=True)
+    w = sub.add_parser("warm", help="run a warm-up and save its end state")
+    w.add_argument("--warmup", type=float, default=1800.0, help="simulated seconds")
+    w.add_argument("--step-ms", type=float, default=headless_line.DEFAULT_STEP_MS)
+    w.add_argument("--seed", type=int, default=None)
+    w.add_argument("--out", required=True)
+    b = sub.add_parser("branch", help="continue from a saved checkpoint")
+    b.add_argument("checkpoint")
+    b.add_argument("--horizon", type=float, default=3600.0, help="simulated seconds after the checkpoint")
+    b.add_argument("--seed", type=int, default=None, help="default: the checkpoint's (exact continuation)")
+    b.add_argument("--param", action="append", default=[], metavar="NAME=VALUE",
+                   help="PLC param for the branch, e.g. fast_handoff=true or reset_pulse_ticks=2")
+    a = ap.parse_args(argv)
+
+    if a.cmd == "warm":
+        snap, res = warm_up(a.warmup, a.step_ms, a.seed, quiet="mute")
+        save(snap, a.out)
+        skipped = {c["module"]: c["skipped"] for c in snap["components"].values() if c["skipped"]}
+        print(json.dumps({"saved": a.out, "at_s": snap["now_ns"] / 1e9, "kpis": snap["kpis"],
+                          "not_saved": skipped, "errors": res["errors"]}, indent=2))
+        return 0
+
+    params = {}
+    for item in a.param:
+        name, _, value = item.partition("=")
+        params[name.strip()] = json.loads(value)
+    res = branch(load(a.checkpoint), a.horizon, params=params, seed=a.seed, quiet="mute")
+    print(json.dumps({k: res[k] for k in ("from_s", "sim_s", "seed", "wall_s", "window", "kpis", "errors")},
+                     indent=2))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
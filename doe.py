@@ -0,0 +1,438 @@
+# pythonGateways/doe.py
+"""
+Design-of-experiments engine over the line settings.
+
+Builds a design (full factorial, Latin hypercube or two-level fractional
+factorial), runs every point x seed as a headless line simulation
+(headless_line.run_line) in a process pool, records each run in the
+opt_dashboard run store and renders a response-surface table.
+
+    python doe.py --design full --factor reset_pulse_ticks=1,3,5 --factor fast_handoff=0,1
+    python doe.py --design lhs  --factor reset_pulse_ticks=1:6 --n 12
+    python doe.py --design frac --factor reset_pulse_ticks=1:5 --factor fault_reset_all=0:1 \
+                  --factor fast_handoff=0:1 --gen fast_handoff=reset_pulse_ticks*fault_reset_all
+
+Buffer capacities and staffing are not factors: the PLC keeps one unit in
+flight, so a buffer never holds more than one unit and its cap has no
+effect, and neither the PLC nor the stations model operators.
+
+Each run is recorded in the run store; from the CLI the records are also
+appended to opt_dashboard.RUNS_LOG_PATH, which the dashboard reads when it
+starts (--no-record to skip).
+
+From the dashboard: POST /doe/start with {"design", "factors", "n", "horizon_s", "seeds"}.
+"""
+import argparse
+import itertools
+import json
+import multiprocessing as mp
+import os
+import random
+import statistics
+import threading
+import time
+
+from bg_jobs import JobSlot, new_id
+
+# factor -> (module, attribute) patched in the child before the run
+MODULE_FACTORS = {
+    "reset_pulse_ticks": ("PLC_LineCoordinator", "RESET_PULSE_TICKS"),
+}
+# 0/1 factors handed to the PLC's apply_params before its first scan
+PLC_PARAM_FACTORS = ("fault_reset_all", "fast_handoff")
+# names that look like settings but do not change the line; rejected with the reason
+INERT_FACTORS = {
+    "buf_max": "buffer caps never bind under the serial PLC (one unit in flight)",
+    "buf_cap": "buffer caps never bind under the serial PLC (one unit in flight)",
+    "operators_total": "staffing is a dashboard setting; the PLC and stations do not model operators",
+    "operators_required": "staffing is a dashboard setting; the PLC and stations do not model operators",
+}
+INT_FACTORS = ("reset_pulse_ticks", "fault_reset_all", "fast_handoff")
+
+RESPONSES = ("throughput_per_min", "units_completed", "packages_completed", "yield_pct", "availability",
+             "downtime_s")
+
+DEFAULT_HORIZON_S = 3600.0
+DEFAULT_SEEDS = (1, 2)
+
+
+def _is_int_factor(name):
+    return name.split(".", 1)[0] in INT_FACTORS
+
+
+def _cast(name, v):
+    return int(round(v)) if _is_int_factor(name) else float(v)
+
+
+def check_factor(name):
+    base = name.split(".", 1)[0]
+    if base in INERT_FACTORS:
+        raise ValueError(f"factor {name!r} has no effect: {INERT_FACTORS[base]}")
+    if base not in MODULE_FACTORS and base not in PLC_PARAM_FACTORS:
+        known = sorted(MODULE_FACTORS) + list(PLC_PARAM_FACTORS)
+        raise ValueError(f"unknown factor {name!r} (known: {known})")
+
+
+# ============================================================
+# Designs (each returns a list of {factor: value})
+# ============================================================
+def full_factorial(levels):
+    """levels: {factor: [v1, v2, ...]}"""
+    names = list(levels)
+    return [dict(zip(names, combo)) for combo in itertools.product(*(levels[n] for n in names))]
+
+
+def latin_hypercube(ranges, n, seed=0):
+    """ranges: {factor: (lo, hi)}; n points, one per stratum in every factor."""
+    rng = random.Random(seed)
+    n = int(n)
+    cols = {}
+    for name, (lo, hi) in ranges.items():
+        strata = [(k + rng.random()) / n for k in range(n)]
+        rng.shuffle(strata)
+        cols[name] = [_cast(name, lo + u * (hi - lo)) for u in strata]
+    return [{name: cols[name][k] for name in ranges} for k in range(n)]
+
+
+def fractional_factorial(ranges, generators=None):
+    """
+    Two-level 2^(k-p) design. ranges: {factor: (lo, hi)}; generators:
+    {factor: "a*b*c"} for factors aliased to products of base factors.
+    Without generators the last factor is aliased to the product of all
+    others (half fraction, resolution k).
+    """
+    names = list(ranges)
+    gens = {str(g).strip(): str(expr) for g, expr in (generators or {}).items()}
+    if not gens and len(names) >= 3:
+        gens = {names[-1]: "*".join(names[:-1])}
+    base = [n for n in names if n not in gens]
+    for g, expr in gens.items():
+        if g not in ranges:
+            raise ValueError(f"generator for {g!r}, which is not a factor ({', '.join(names)})")
+        for term in expr.split("*"):
+            if term.strip() not in base:
+                raise ValueError(f"generator {g}={expr}: {term.strip()!r} is not a base factor "
+                                 f"({', '.join(base) or 'none'})")
+    points = []
+    for signs in itertools.product((-1, 1), repeat=len(base)):
+        coded = dict(zip(base, signs))
+        for g, expr in gens.items():
+            s = 1
+            for term in expr.split("*"):
+                s *= coded[term.strip()]
+            coded[g] = s
+        points.append({n: ranges[n][0] if coded[n] < 0 else ranges[n][1] for n in names})
+    return points
+
+
+def build_design(design, factors, n=None, seed=0, generators=None):
+    for name in factors:
+        check_factor(name)
+    if design == "full":
+        return full_factorial({k: list(v) for k, v in factors.items()})
+    if design == "lhs":
+        return latin_hypercube({k: (min(v), max(v)) for k, v in factors.items()}, n or 10, seed)
+    if design == "frac":
+        return fractional_factorial({k: (min(v), max(v)) for k, v in factors.items()}, generators)
+    raise ValueError(f"unknown design {design!r} (full, lhs, frac)")
+
+
+# ============================================================
+# One run (executes in a pool worker)
+# ============================================================
+def _apply(point):
+    """point -> (module overrides, PLC params, params as recorded in the run store)"""
+    overrides = {}
+    plc_params = {}
+    params = {}
+    for name, v in point.items():
+        if name in MODULE_FACTORS:
+            mod, attr = MODULE_FACTORS[name]
+            overrides.setdefault(mod, {})[attr] = v
+            params[name] = v
+        else:
+            plc_params[name] = bool(v)
+            params[name] = bool(v)
+    return overrides, plc_params, params
+
+
+def run_point(job):
+    """job = (point_id, point, seed, horizon_s, step_ms) -> result dict."""
+    point_id, point, seed, horizon_s, step_ms = job
+    import headless_line
+    import opt_dashboard
+
+    overrides, plc_params, params = _apply(point)
+    opt_dashboard.set_params(params)
+    kw = {"horizon_s": horizon_s, "seed": seed, "quiet": "devnull", "module_overrides": overrides,
+          "params": plc_params}
+    if step_ms:
+        kw["step_ms"] = step_ms
+    t0 = time.perf_counter()
+    try:
+        res = headless_line.run_line(**kw)
+    except Exception as e:
+        return {"point_id": point_id, "point": point, "seed": seed, "ok": False, "error": str(e),
+                "wall_s": time.perf_counter() - t0}
+    # the snapshot's throughput counts packages since the last line reset (a fault
+    # recovery zeroes it); the PLC's unit count covers the whole run
+    kpis = dict(res["kpis"])
+    if res["sim_s"] > 0:
+        kpis["throughput_per_min"] = kpis.get("units_completed", 0) / (res["sim_s"] / 60.0)
+    return {
+        "point_id": point_id,
+        "point": point,
+        "params": params,
+        "seed": seed,
+        "ok": True,
+        "wall_s": res["wall_s"],
+        "sim_s": res["sim_s"],
+        "kpis": kpis,
+        "errors": len(res.get("errors") or []),
+    }
+
+
+# ============================================================
+# Driver
+# ============================================================
+class DoeRun:
+    """Runs a design and collects results; safe to poll from another thread."""
+
+    def __init__(self, points, horizon_s=DEFAULT_HORIZON_S, seeds=DEFAULT_SEEDS, step_ms=None,
+                 workers=None, record=True, meta=None, runs_log=None):
+        self.points = list(points)
+        self.horizon_s = float(horizon_s)
+        self.seeds = [int(s) for s in seeds]
+        self.step_ms = step_ms
+        self.workers = max(1, int(workers or os.cpu_count() or 1))
+        self.record = bool(record)
+        self.runs_log = runs_log
+        self.meta = dict(meta or {})
+        self.doe_id = self.meta.get("doe_id") or new_id("doe")
+        self.results = []
+        self.total = len(self.points) * len(self.seeds)
+        self.state = "pending"
+        self.error = ""
+        self.started_at = None
+        self.ended_at = None
+        self._lock = threading.Lock()
+
+    def jobs(self):
+        return [(pid, p, s, self.horizon_s, self.step_ms)
+                for pid, p in enumerate(self.points) for s in self.seeds]
+
+    def run(self, on_result=None):
+        self.state = "running"
+        self.started_at = time.time()
+        # spawn: the dashboard calls this from a server thread, fork is unsafe there
+        ctx = mp.get_context("spawn")
+        try:
+            # one run per worker process: component modules keep module-level state
+            with ctx.Pool(processes=self.workers, maxtasksperchild=1) as pool:
+                for r in pool.imap_unordered(run_point, self.jobs()):
+                    with self._lock:
+                        self.results.append(r)
+                    if self.record and r.get("ok"):
+                        self._record(r)
+                    if on_result:
+                        on_result(r, self)
+            self.state = "done"
+        except Exception as e:
+            self.state = "error"
+            self.error = str(e)
+        self.ended_at = time.time()
+        return self.results
+
+    def _record(self, r):
+        import opt_dashboard
+        opt_dashboard.record_run(r["params"], r["kpis"],
+                                 meta={"doe_id": self.doe_id, "point_id": r["point_id"], "seed": r["seed"],
+                                       "horizon_s": self.horizon_s, "source": "doe"},
+                                 log_path=self.runs_log)
+
+    def status(self, response="throughput_per_min"):
+        with self._lock:
+            results = list(self.results)
+        return {
+            "doe_id": self.doe_id,
+            "state": self.state,
+            "error": self.error,
+            "done": len(results),
+            "total": self.total,
+            "started_at": self.started_at,
+            "ended_at": self.ended_at,
+            "table": surface_table(self.points, results, response),
+        }
+
+
+# ============================================================
+# Response surface
+# ============================================================
+def summarize(points, results, response="throughput_per_min"):
+    """Per design point: mean/sd of the response over seeds."""
+    by_point = {}
+    for r in results:
+        if r.get("ok"):
+            by_point.setdefault(r["point_id"], []).append(float(r["kpis"].get(response, 0.0)))
+    rows = []
+    for pid, p in enumerate(points):
+        ys = by_point.get(pid, [])
+        rows.append({
+            "point_id": pid,
+            "point": p,
+            "n": len(ys),
+            "mean": statistics.fmean(ys) if ys else None,
+            "sd": statistics.stdev(ys) if len(ys) > 1 else 0.0,
+        })
+    return rows
+
+
+def main_effects(rows):
+    """factor -> {level: mean response}"""
+    eff = {}
+    for row in rows:
+        if row["mean"] is None:
+            continue
+        for f, v in row["point"].items():
+            eff.setdefault(f, {}).setdefault(v, []).append(row["mean"])
+    return {f: {lvl: statistics.fmean(ys) for lvl, ys in sorted(lv.items())} for f, lv in eff.items()}
+
+
+def surface_table(points, results, response="throughput_per_min"):
+    rows = summarize(points, results, response)
+    factors = list(points[0]) if points else []
+    out = [f"Response: {response} (mean ± sd over seeds)"]
+
+    if len(factors) == 2:
+        # pivot grid: first factor down, second across
+        a, b = factors
+        la = sorted({p[a] for p in points})
+        lb = sorted({p[b] for p in points})
+        cell = {}
+        for row in rows:
+            if row["mean"] is not None:
+                cell[(row["point"][a], row["point"][b])] = row
+        corner = f"{a} \\ {b}"
+        out.append(f"{corner:>22}" + "".join(f"{str(v):>16}" for v in lb))
+        for va in la:
+            line = f"{str(va):>22}"
+            for vb in lb:
+                c = cell.get((va, vb))
+                line += f"{c['mean']:>9.3f} ±{c['sd']:<5.3f}" if c else f"{'-':>16}"
+            out.append(line)
+    else:
+        out.append("  " + "".join(f"{f:>20}" for f in factors) + f"{'mean':>12}{'sd':>10}{'n':>4}")
+        for row in sorted(rows, key=lambda r: -(r["mean"] if r["mean"] is not None else float("-inf"))):
+            vals = "".join(f"{str(row['point'][f]):>20}" for f in factors)
+            m = f"{row['mean']:>12.3f}{row['sd']:>10.3f}" if row["mean"] is not None else f"{'-':>12}{'-':>10}"
+            out.append(f"  {vals}{m}{row['n']:>4}")
+
+    out.append("")
+    out.append("Main effects:")
+    for f, lv in main_effects(rows).items():
+        out.append(f"  {f:<24}" + "  ".join(f"{k}: {v:.3f}" for k, v in lv.items()))
+
+    best = max((r for r in rows if r["mean"] is not None), key=lambda r: r["mean"], default=None)
+    if best:
+        out.append("")
+        out.append(f"Best: {best['point']} -> {best['mean']:.3f}")
+    return "\n".join(out)
+
+
+# ============================================================
+# Background runs for the dashboard
+# ============================================================
+_slot = JobSlot("a DOE")
+
+
+def start_in_thread(spec):
+    """Start a DOE from a dashboard spec dict; returns the DoeRun (or raises ValueError)."""
+    factors = {k: list(v) for k, v in (spec.get("factors") or {}).items()}
+    if not factors:
+        raise ValueError("no factors")
+    points = build_design(str(spec.get("design", "full")), factors, n=spec.get("n"),
+                          seed=int(spec.get("seed", 0)), generators=spec.get("generators"))
+    return _slot.start(DoeRun(points,
+                              horizon_s=float(spec.get("horizon_s", DEFAULT_HORIZON_S)),
+                              seeds=spec.get("seeds") or DEFAULT_SEEDS,
+                              workers=spec.get("workers")))
+
+
+def current_status(response="throughput_per_min"):
+    run = _slot.current()
+    return run.status(response) if run is not None else {"state": "idle"}
+
+
+# ============================================================
+# CLI
+# ============================================================
+def _parse_factor(s, design):
+    name, _, spec = s.partition("=")
+    name = name.strip()
+    if ":" in spec:
+        lo, hi = (float(x) for x in spec.split(":", 1))
+        if design == "full":
+            vals = list(range(int(lo), int(hi) + 1)) if _is_int_factor(name) else [lo, hi]
+        else:
+            vals = [_cast(name, lo), _cast(name, hi)]
+    else:
+        vals = [_cast(name, float(x)) for x in spec.split(",") if x.strip()]
+    return name, vals
+
+
+def main(argv=None):
+    ap = argparse.ArgumentParser(description="Run a design of experiments over line settings")
+    ap.add_argument("--design", choices=("full", "lhs", "frac"), default="full")
+    ap.add_argument("--factor", action="append", default=[],
+                    help="name=v1,v2,... or name=lo:hi (e.g. reset_pulse_ticks=1:6, fast_handoff=0,1)")
+    ap.add_argument("--gen", action="append", default=[], help="frac generator, e.g. fast_handoff=reset_pulse_ticks*fault_reset_all")
+    ap.add_argument("--n", type=int, default=10, help="points for --design lhs")
+    ap.add_argument("--horizon", type=float, default=DEFAULT_HORIZON_S, help="simulated seconds per run")
+    ap.add_argument("--step-ms", type=float, default=None)
+    ap.add_argument("--seeds", default=",".join(str(s) for s in DEFAULT_SEEDS))
+    ap.add_argument("--workers", type=int, default=None)
+    ap.add_argument("--response", choices=RESPONSES, default="throughput_per_min")
+    ap.add_argument("--design-seed", type=int, default=0, help="RNG seed for the LHS layout")
+    ap.add_argument("--out", default="doe_results.json")
+    ap.add_argument("--runs-log", default=None, help="run store log to append to (default: the dashboard's)")
+    ap.add_argument("--no-record", action="store_true", help="do not add the runs to the run store log")
+    a = ap.parse_args(argv)
+
+    if not a.factor:
+        ap.error("at least one --factor is required")
+    if any("=" not in g for g in a.gen):
+        ap.error("--gen takes factor=a*b...")
+    factors = dict(_parse_factor(f, a.design) for f in a.factor)
+    gens = dict(g.split("=", 1) for g in a.gen)
+    try:
+        points = build_design(a.design, factors, n=a.n, seed=a.design_seed, generators=gens)
+    except ValueError as e:
+        ap.error(str(e))
+    seeds = [int(s) for s in a.seeds.split(",") if s.strip()]
+
+    runs_log = None
+    if not a.no_record:
+        import opt_dashboard
+        runs_log = a.runs_log or opt_dashboard.RUNS_LOG_PATH
+    run = DoeRun(points, a.horizon, seeds, a.step_ms, a.workers, record=not a.no_record, runs_log=runs_log)
+    print(f"DOE {a.design}: {len(points)} points x {len(seeds)} seeds = {run.total} runs "
+          f"on {run.workers} workers, horizon {a.horizon:.0f}s")
+
+    def progress(r, dr):
+        tag = "ok" if r.get("ok") else f"FAILED: {r.get('error')}"
+        print(f"  [{len(dr.results)}/{dr.total}] point {r['point_id']} seed {r['seed']} {tag}", flush=True)
+
+    t0 = time.perf_counter()
+    run.run(on_result=progress)
+    print(f"Done in {time.perf_counter() - t0:.1f}s\n")
+    print(surface_table(points, run.results, a.response))
+
+    with open(a.out, "w", encoding="utf-8") as f:
+        json.dump({"design": a.design, "factors": factors, "generators": gens, "horizon_s": a.horizon,
+                   "seeds": seeds, "points": points, "results": run.results}, f, indent=2)
+    print(f"\nResults written to {a.out}" + (f", runs appended to {runs_log}" if runs_log else ""))
+    return 0 if run.state == "done" else 1
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())
@@ -0,0 +1,401 @@
+# pythonGateways/forecast.py
+"""
+Predictive twin: fork the line and forecast the next hour(s) from now.
+
+The line state is cloned from a checkpoint (checkpoint.py) and N stochastic
+continuations run in a process pool, each a headless branch with its own
+seed, at thousands of times real time. The forecast gives bands (mean,
+p10/p50/p90) for throughput over the horizon, a fan of completed units
+against time and, given a target, when it will be reached and the chance
+of missing the deadline.
+
+    fc = Forecast(checkpoint.dumps(snap), horizon_s=3600, n=16,
+                  outage={"station": "S4", "down_s": 900},    # "if ST4 goes down now"
+                  target_units=120, done_units=85, deadline_s=3600)
+    fc.run()["target"]      # {"remaining", "p_miss", "eta_s": {"p10", "p50", "p90"}, ...}
+
+    python forecast.py --checkpoint warm.ckpt --horizon 3600 --n 16 --down S4=900 --target 20
+    python forecast.py --warmup 1800 --n 16         # fork a freshly warmed-up line instead
+
+From the dashboard: POST /forecast/start {"horizon_s", "n", "outage", "target_units",
+"deadline_s"} and GET /forecast.
+
+Where the state comes from: a headless line hands its checkpoint over with
+set_checkpoint(). A VSI run has its station models in other processes, so
+without one the line is forked from a template, a headless warm-up
+(TEMPLATE_WARMUP_S, seed TEMPLATE_SEED) under the current params. That is
+a generic what-if for these settings, not a forecast of the live line:
+only the units done so far and the params come from the live KPI snapshot,
+and status()/result() say so ("basis"). An outage freezes the station's
+model (no job progresses) from the first step after the fork until down_s;
+the PLC sees it as it would a stuck station (watchdog, recovery).
+
+The parent process only handles snapshots as bytes: unpickling one imports
+the component modules, which in a live PLC process must not be replaced by
+the headless stubs.
+"""
+import argparse
+import json
+import multiprocessing as mp
+import os
+import sys
+import threading
+import time
+
+from bg_jobs import JobSlot, new_id
+
+DEFAULT_HORIZON_S = 3600.0
+DEFAULT_RUNS = 16
+TEMPLATE_WARMUP_S = 1800.0
+TEMPLATE_SEED = 0
+FAN_POINTS = 12
+
+# station -> (module, model class) whose advance() an outage replaces
+STATION_MODELS = {
+    "S1": ("ST1_ComponentKitting", "ST1_SimRuntime"),
+    "S2": ("ST2_FrameCoreAssembly", "ST2_SimRuntime"),
+    "S3": ("ST3_ElectronicsWiring", "Station3Sim"),
+    "S4": ("ST4_CalibrationTesting", "Station4Sim"),
+    "S5": ("ST5_QualityInspection", "_ST5SimModel"),
+    "S6": ("ST6_PackagingDispatch", "_ST6SimModel"),
+}
+
+
+def check_outage(outage):
+    """None or {"station": "S1".."S6", "down_s": > 0}; raises ValueError."""
+    if not outage:
+        return None
+    st = str(outage.get("station", "")).upper()
+    if st not in STATION_MODELS:
+        raise ValueError(f"unknown station {outage.get('station')!r}")
+    down_s = float(outage.get("down_s", 0.0))
+    if down_s <= 0:
+        raise ValueError("outage down_s must be > 0")
+    return {"station": st, "down_s": down_s}
+
+
+# ============================================================
+# Worker side (spawned processes)
+# ============================================================
+class _Outage:
+    """
+    One branch's station model frozen until end_ns: its advance() is
+    shadowed by hold() on the instance, so nothing else sharing the class
+    (another line in the process, the next branch) is touched.
+    """
+
+    def __init__(self, station, end_ns):
+        import headless_line
+        mod_name, cls_name = STATION_MODELS[station]
+        self.cid = next(cid for cid, name, _ in headless_line.COMPONENTS if name == mod_name)
+        self.cls = getattr(headless_line.import_component(mod_name), cls_name)
+        self.end_ns = int(end_ns)
+        self.model = None
+
+    def _find(self, line):
+        obj = line.component(self.cid)
+        return next((v for v in vars(obj).values() if isinstance(v, self.cls)), None) if obj else None
+
+    def check(self, line):
+        """Call from on_step: freezes the model (again, if the station rebuilt it) until end_ns."""
+        if line.fabric.now_ns >= self.end_ns:
+            self.release()
+            return
+        model = self._find(line)
+        if model is not None and model is not self.model:
+            self.release()
+            model.advance = model.hold
+            self.model = model
+
+    def release(self):
+        if self.model is not None:
+            del self.model.advance
+            self.model = None
+
+
+def template_job(job):
+    """job = (params, warmup_s, step_ms) -> checkpoint bytes of a warmed-up line."""
+    params, warmup_s, step_ms = job
+    import checkpoint
+    kw = {"params": params, "quiet": "mute"}
+    if step_ms:
+        kw["step_ms"] = step_ms
+    snap, _ = checkpoint.warm_up(warmup_s, seed=TEMPLATE_SEED, **kw)
+    return checkpoint.dumps(snap)
+
+
+def branch_job(job):
+    """job = (blob, seed, horizon_s, params, outage) -> unit completion times of one continuation."""
+    blob, seed, horizon_s, params, outage = job
+    import checkpoint
+    t0 = time.perf_counter()
+    try:
+        snap = checkpoint.loads(blob)
+        from_ns = snap["now_ns"]
+        start = snap["counters"]["units_completed"]
+        times = []
+        outage_ctl = _Outage(outage["station"], from_ns + outage["down_s"] * 1e9) if outage else None
+
+        def on_step(line):
+            # the WIP tracker's count never resets, unlike the station counters
+            t_s = (line.fabric.now_ns - from_ns) / 1e9
+            done = line.plc._wip.completed - start
+            times.extend([t_s] * (done - len(times)))
+            if outage_ctl is not None:
+                outage_ctl.check(line)
+
+        res = checkpoint.branch(snap, horizon_s, params=params, seed=seed, on_step=on_step, quiet="mute")
+    except Exception as e:
+        return {"seed": seed, "ok": False, "error": f"{type(e).__name__}: {e}", "wall_s": time.perf_counter() - t0}
+    return {
+        "seed": seed,
+        "ok": True,
+        "sim_s": res["sim_s"],
+        "wall_s": res["wall_s"],
+        "times": times,
+        "window": res["window"],
+        "errors": len(res["errors"]),
+    }
+
+
+# ============================================================
+# Aggregation
+# ============================================================
+def _quantile(xs, q):
+    """Linear-interpolated quantile of a sorted list (inf allowed)."""
+    if not xs:
+        return None
+    pos = q * (len(xs) - 1)
+    lo = int(pos)
+    hi = min(lo + 1, len(xs) - 1)
+    if xs[hi] == float("inf"):
+        return None if pos > lo or xs[lo] == float("inf") else xs[lo]
+    return xs[lo] + (xs[hi] - xs[lo]) * (pos - lo)
+
+
+def _band(values):
+    xs = sorted(values)
+    finite = [x for x in xs if x != float("inf")]
+    return {
+        "mean": sum(finite) / len(finite) if finite and len(finite) == len(xs) else None,
+        "p10": _quantile(xs, 0.10),
+        "p50": _quantile(xs, 0.50),
+        "p90": _quantile(xs, 0.90),
+    }
+
+
+def summarize(branches, horizon_s, target_units=None, done_units=0, deadline_s=None):
+    ok = [b for b in branches if b.get("ok")]
+    out = {"runs": len(ok), "failed": len(branches) - len(ok), "horizon_s": horizon_s}
+    if not ok:
+        return out
+    units = [len(b["times"]) for b in ok]
+    out["units"] = _band(units)
+    out["throughput_per_min"] = _band([u / (b["sim_s"] / 60.0) for u, b in zip(units, ok)])
+    out["yield_pct"] = _band([b["window"]["yield_pct"] for b in ok])
+    fan = []
+    for k in range(1, FAN_POINTS + 1):
+        t = horizon_s * k / FAN_POINTS
+        row = _band([sum(1 for x in b["times"] if x <= t) for b in ok])
+        row["t_s"] = t
+        fan.append(row)
+    out["fan"] = fan
+    if target_units is not None:
+        remaining = max(0, int(target_units) - int(done_units))
+        deadline = float(deadline_s if deadline_s is not None else horizon_s)
+        # time of the remaining-th completion in each continuation; inf (a miss) if not within the horizon
+        eta = [0.0 if remaining == 0 else (b["times"][remaining - 1] if len(b["times"]) >= remaining
+                                             else float("inf")) for b in ok]
+        out["target"] = {
+            "target_units": int(target_units),
+            "done_units": int(done_units),
+            "remaining": remaining,
+            "deadline_s": deadline,
+            "p_miss": sum(1 for e in eta if e > deadline) / len(eta),
+            "eta_s": _band(eta),
+            "reached_in_horizon": sum(1 for e in eta if e != float("inf")),
+        }
+    wall = sum(b["wall_s"] for b in ok)
+    out["sim_s_per_wall_s"] = sum(b["sim_s"] for b in ok) / wall if wall > 0 else 0.0
+    return out
+
+
+# ============================================================
+# Driver
+# ============================================================
+class Forecast:
+    """N continuations of one checkpoint; safe to poll from another thread."""
+
+    def __init__(self, blob=None, horizon_s=DEFAULT_HORIZON_S, n=DEFAULT_RUNS, params=None, outage=None,
+                 target_units=None, done_units=0, deadline_s=None, workers=None, step_ms=None,
+                 warmup_s=TEMPLATE_WARMUP_S, meta=None):
+        self.blob = blob
+        self.warmup_s = float(warmup_s)
+        self.horizon_s = float(horizon_s)
+        self.n = max(1, int(n))
+        self.params = dict(params or {})
+        self.outage = check_outage(outage)
+        self.target_units = None if target_units in (None, "") else int(target_units)
+        self.done_units = int(done_units or 0)
+        self.deadline_s = None if deadline_s in (None, "") else float(deadline_s)
+        self.workers = max(1, int(workers or os.cpu_count() or 1))
+        self.step_ms = step_ms
+        self.meta = dict(meta or {})
+        self.forecast_id = self.meta.get("forecast_id") or new_id("fc")
+        self.source = "checkpoint" if blob is not None else "template"
+        self.basis = ("line state at the checkpoint" if blob is not None else
+                      f"generic what-if: a {self.warmup_s:.0f} s warm-up under the current params, "
+                      f"not the live line state")
+        self.branches = []
+        self.state = "pending"
+        self.error = ""
+        self.started_at = None
+        self.ended_at = None
+        self._lock = threading.Lock()
+
+    def jobs(self):
+        return [(self.blob, seed, self.horizon_s, self.params, self.outage) for seed in range(1, self.n + 1)]
+
+    def run(self, on_result=None):
+        self.state = "running"
+        self.started_at = time.time()
+        # spawn: the dashboard calls this from a server thread, fork is unsafe there
+        ctx = mp.get_context("spawn")
+        try:
+            # one run per worker process: component modules keep module-level state
+            with ctx.Pool(processes=min(self.workers, self.n), maxtasksperchild=1) as pool:
+                if self.blob is None:
+                    self.blob = pool.apply(template_job, ((self.params, self.warmup_s, self.step_ms),))
+                for r in pool.imap_unordered(branch_job, self.jobs()):
+                    with self._lock:
+                        self.branches.append(r)
+                    if on_result:
+                        on_result(r, self)
+            self.state = "done"
+        except Exception as e:
+            self.state = "error"
+            self.error = str(e)
+        self.ended_at = time.time()
+        return self.result()
+
+    def result(self):
+        with self._lock:
+            branches = list(self.branches)
+        out = summarize(branches, self.horizon_s, self.target_units, self.done_units, self.deadline_s)
+        out["source"], out["basis"] = self.source, self.basis
+        errors = [b["error"] for b in branches if not b.get("ok")]
+        if errors:
+            out["errors"] = errors[:3]
+        return out
+
+    def status(self):
+        end = self.ended_at or time.time()
+        return {
+            "forecast_id": self.forecast_id,
+            "state": self.state,
+            "error": self.error,
+            "source": self.source,
+            "basis": self.basis,
+            "outage": self.outage,
+            "done": len(self.branches),
+            "total": self.n,
+            "started_at": self.started_at,
+            "ended_at": self.ended_at,
+            "elapsed_s": end - self.started_at if self.started_at else 0.0,
+            "result": self.result(),
+        }
+
+
+# ============================================================
+# Background forecasts for the dashboard
+# ============================================================
+_slot = JobSlot("a forecast")
+_checkpoint_lock = threading.Lock()
+_checkpoint_blob = None
+
+
+def set_checkpoint(snap):
+    """Fork forecasts from this line state (a checkpoint.capture() snapshot) from now on."""
+    import checkpoint
+    global _checkpoint_blob
+    blob = checkpoint.dumps(snap) if snap is not None else None
+    with _checkpoint_lock:
+        _checkpoint_blob = blob
+
+
+def start_in_thread(spec):
+    """Start a forecast from a dashboard spec dict; returns the Forecast (or raises ValueError)."""
+    import opt_dashboard
+    kpis = opt_dashboard.get_kpi_snapshot()
+    done = spec.get("done_units")
+    fc_kw = {
+        "horizon_s": float(spec.get("horizon_s", DEFAULT_HORIZON_S)),
+        "n": int(spec.get("n", DEFAULT_RUNS)),
+        "params": opt_dashboard.get_params(),
+        "outage": check_outage(spec.get("outage")),
+        "target_units": spec.get("target_units"),
+        "done_units": int(done if done not in (None, "") else kpis.get("units_completed", 0) or 0),
+        "deadline_s": spec.get("deadline_s"),
+        "workers": spec.get("workers"),
+        "meta": {"from_sim_time_s": kpis.get("sim_time_s")},
+    }
+    if fc_kw["horizon_s"] <= 0:
+        raise ValueError("horizon_s must be > 0")
+    with _checkpoint_lock:
+        blob = _checkpoint_blob
+    return _slot.start(Forecast(blob, **fc_kw))
+
+
+def current_status():
+    fc = _slot.current()
+    return fc.status() if fc is not None else {"state": "idle"}
+
+
+# ============================================================
+# CLI
+# ============================================================
+def main(argv=None):
+    ap = argparse.ArgumentParser(description="Forecast the line from a checkpoint with N stochastic continuations")
+    ap.add_argument("--checkpoint", default="", help="checkpoint.py file to fork (default: a warmed-up template)")
+    ap.add_argument("--warmup", type=float, default=TEMPLATE_WARMUP_S, help="template warm-up, simulated seconds")
+    ap.add_argument("--horizon", type=float, default=DEFAULT_HORIZON_S, help="simulated seconds ahead")
+    ap.add_argument("--n", type=int, default=DEFAULT_RUNS, help="continuations")
+    ap.add_argument("--down", default="", metavar="STATION=SECONDS", help="outage from now, e.g. S4=900")
+    ap.add_argument("--target", type=int, default=None, help="units still to make (or the total with --done)")
+    ap.add_argument("--done", type=int, default=0, help="units made so far")
+    ap.add_argument("--deadline", type=float, default=None, help="seconds from now (default: the horizon)")
+    ap.add_argument("--param", action="append", default=[], metavar="NAME=VALUE", help="PLC param, e.g. fast_handoff=true")
+    ap.add_argument("--workers", type=int, default=None)
+    a = ap.parse_args(argv)
+
+    params = {}
+    for item in a.param:
+        name, _, value = item.partition("=")
+        params[name.strip()] = json.loads(value)
+    outage = None
+    if a.down:
+        st, _, secs = a.down.partition("=")
+        outage = {"station": st.strip(), "down_s": float(secs)}
+
+    blob = None
+    if a.checkpoint:
+        with open(a.checkpoint, "rb") as f:
+            blob = f.read()
+    fc = Forecast(blob, a.horizon, a.n, params, outage, a.target, a.done, a.deadline, a.workers,
+                  warmup_s=a.warmup)
+
+    def progress(r, f):
+        tag = "ok" if r.get("ok") else f"FAILED: {r.get('error')}"
+        print(f"  [{len(f.branches)}/{f.n}] seed {r['seed']} {tag}", flush=True)
+
+    t0 = time.perf_counter()
+    res = fc.run(on_result=progress)
+    wall = time.perf_counter() - t0
+    res["wall_s"] = wall
+    res["x_real_time"] = a.n * a.horizon / wall if wall > 0 else 0.0
+    print(json.dumps(res, indent=2))
+    return 0 if fc.state == "done" else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,432 @@
+# pythonGateways/headless_line.py
+"""
+Headless, in-process emulation of the VSI fabric for the PLC + ST1..ST6 line.
+
+The real component modules (PLC_LineCoordinator.py, ST1_*.py ... ST6_*.py) are
+imported unchanged; only VsiCommonPythonApi / VsiTcpUdpPythonGateway are
+replaced by the stubs below. Each component's mainThread() runs in its own
+thread, but exactly one runs at a time: components take turns in componentId
+order and yield at advanceSimulation(), after which the fabric advances time
+by one step. Packets sent during step k are received during step k+1, so a run
+is deterministic for a given seed.
+
+    from headless_line import run_line
+    res = run_line(horizon_s=3600, step_ms=2000, seed=1)
+    res["kpis"]["throughput_per_min"], res["scans_per_s"]
+
+A run can also start from a checkpoint (see checkpoint.py) taken from
+on_step: HeadlessLine(restore=snap) builds the components as usual and puts
+the snapshot back just before their first scan.
+"""
+import importlib
+import random
+import sys
+import threading
+import time
+import types
+
+PythonGateways = 'pythonGateways/'
+if PythonGateways not in sys.path:
+    sys.path.append(PythonGateways)
+
+# componentId -> (module, class); ids match the generated code
+COMPONENTS = [
+    (0, "PLC_LineCoordinator", "PLC_LineCoordinator"),
+    (1, "ST1_ComponentKitting", "ST1_ComponentKitting"),
+    (2, "ST2_FrameCoreAssembly", "ST2_FrameCoreAssembly"),
+    (3, "ST3_ElectronicsWiring", "ST3_ElectronicsWiring"),
+    (4, "ST4_CalibrationTesting", "ST4_CalibrationTesting"),
+    (5, "ST5_QualityInspection", "ST5_QualityInspection"),
+    (6, "ST6_PackagingDispatch", "ST6_PackagingDispatch"),
+]
+PLC_ID = 0
+
+# VSI step. Unit timings come from the stations' done_time_ns and the
+# watchdogs run on simulated time, so the step mostly sets run speed.
+DEFAULT_STEP_MS = 2000
+_EMPTY = (0, 0, b"", 0)
+
+
+# ============================================================
+# Fabric (one per run)
+# ============================================================
+class _Component:
+    __slots__ = ("cid", "module", "cls", "obj", "thread", "go", "alive",
+                 "rng_state", "rx_packets", "tx_packets", "errors")
+
+    def __init__(self, cid, module, cls):
+        self.cid = cid
+        self.module = module
+        self.cls = cls
+        self.obj = None
+        self.thread = None
+        self.go = threading.Event()
+        self.alive = True
+        self.rng_state = None
+        self.rx_packets = 0
+        self.tx_packets = 0
+        self.errors = []
+
+
+class Fabric:
+    def __init__(self, total_ns, step_ns, start_ns=0):
+        self.now_ns = int(start_ns)
+        self.total_ns = int(total_ns)
+        self.step_ns = int(step_ns)
+        self.current = None
+        self.stop_requested = False
+        self.terminated = False
+        self.steps = 0
+        self._yield = threading.Event()
+        # port -> list of payloads; "server" side is the tcpListen()er (PLC)
+        self._servers = set()
+        self._to_server = {}
+        self._to_client = {}
+        self._next_to_server = {}
+        self._next_to_client = {}
+
+    # ---- scheduling ----
+    def yield_turn(self):
+        comp = self.current
+        self._yield.set()
+        comp.go.wait()
+        comp.go.clear()
+
+    def deliver(self):
+        for src, dst in ((self._next_to_server, self._to_server), (self._next_to_client, self._to_client)):
+            for port, q in src.items():
+                if q:
+                    dst.setdefault(port, []).extend(q)
+                    q.clear()
+
+    # ---- sockets ----
+    def listen(self, port):
+        self._servers.add(int(port))
+        return int(port)
+
+    def connect(self, port):
+        return int(port)
+
+    def send(self, handle, payload):
+        comp = self.current
+        comp.tx_packets += 1
+        port = int(handle)
+        if comp.cid == PLC_ID:
+            self._next_to_client.setdefault(port, []).append(bytes(payload))
+        else:
+            self._next_to_server.setdefault(port, []).append(bytes(payload))
+
+    def recv(self, handle):
+        comp = self.current
+        port = int(handle)
+        inbox = (self._to_server if comp.cid == PLC_ID else self._to_client).get(port)
+        if not inbox:
+            return _EMPTY
+        data = inbox.pop(0)
+        comp.rx_packets += 1
+        return (port, port, data, len(data))
+
+
+_fabric = None
+
+
+# ============================================================
+# Stub VSI modules
+# ============================================================
+def _make_common_api():
+    m = types.ModuleType("VsiCommonPythonApi")
+    m.connectToServer = lambda host, domain, port, cid: object()
+    m.waitForReset = lambda: None
+    m.getSimulationTimeInNs = lambda: _fabric.now_ns
+    m.getTotalSimulationTime = lambda: _fabric.total_ns
+    m.getSimulationStep = lambda: _fabric.step_ns
+    m.isStopRequested = lambda: _fabric.stop_requested
+
+    def advanceSimulation(dt_ns):
+        _fabric.yield_turn()
+    m.advanceSimulation = advanceSimulation
+    return m
+
+
+def _make_gateway():
+    m = types.ModuleType("VsiTcpUdpPythonGateway")
+    m.initialize = lambda session, cid, mac, ip: None
+    m.tcpListen = lambda port: _fabric.listen(port)
+    m.tcpConnect = lambda ip, port: _fabric.connect(port)
+    m.recvEthernetPacket = lambda handle: _fabric.recv(handle)
+    m.sendEthernetPacket = lambda handle, payload: _fabric.send(handle, payload)
+    m.isTerminationOnGoing = lambda: False
+    m.isTerminated = lambda: _fabric.terminated
+
+    def terminate():
+        _fabric.terminated = True
+    m.terminate = terminate
+    return m
+
+
+def install_stubs():
+    """Register the stub VSI modules so component modules import headless."""
+    if "VsiCommonPythonApi" not in sys.modules:
+        sys.modules["VsiCommonPythonApi"] = _make_common_api()
+    if "VsiTcpUdpPythonGateway" not in sys.modules:
+        sys.modules["VsiTcpUdpPythonGateway"] = _make_gateway()
+
+
+def import_component(module_name):
+    install_stubs()
+    return importlib.import_module(module_name)
+
+
+# ============================================================
+# Output suppression
+# ============================================================
+class _NullOut:
+    """Discards output but keeps error lines printed by the components."""
+
+    def __init__(self):
+        self.error_lines = []
+
+    def write(self, s):
+        if "An error occurred" in s:
+            self.error_lines.append(s.strip())
+        return len(s)
+
+    def flush(self):
+        pass
+
+
+def _mute_print(sink):
+    def _print(*args, **kwargs):
+        if args and isinstance(args[0], str) and args[0].startswith("An error occurred"):
+            sink.error_lines.append(args[0])
+    return _print
+
+
+# ============================================================
+# Runner
+# ============================================================
+class HeadlessLine:
+    """
+    quiet: "devnull" formats every print and discards it (the real per-scan
+           cost); "mute" shadows print() in the component modules (fastest);
+           "none" leaves stdout alone.
+    seed:  None reproduces a VSI run (stations seed themselves); an int also
+           salts every random.seed() call so replications get independent
+           streams.
+    restore: checkpoint.capture() snapshot to continue from; the run starts
+           at its time. seed None or the snapshot's seed continues its RNG
+           streams exactly, any other seed starts fresh ones.
+    params: opt_dashboard style params applied to the PLC before its first
+           scan (PLC.apply_params), e.g. a what-if on a restored line.
+    """
+
+    def __init__(self, horizon_s=600.0, step_ms=DEFAULT_STEP_MS, seed=None, quiet="devnull",
+                 plc_args=None, module_overrides=None, start_s=0.0, on_step=None,
+                 restore=None, params=None):
+        self.horizon_s = float(horizon_s)
+        self.step_ns = int(round(float(step_ms) * 1e6))
+        self.start_ns = int(round(float(start_s) * 1e9))
+        self.restore = restore
+        self.params = dict(params or {})
+        if restore is not None:
+            self.start_ns = int(restore["now_ns"])
+            if seed is None:
+                seed = restore["seed"]
+        self.seed = seed
+        self.quiet = quiet
+        self.plc_args = dict(plc_args or {})
+        self.module_overrides = dict(module_overrides or {})
+        self.on_step = on_step
+        self.fabric = None
+        self.components = []
+
+    def _args_for(self, cid):
+        a = types.SimpleNamespace(domain="AF_UNIX", server_url="localhost",
+                                  metrics_port=0, profile_scan=False, profile_out="")
+        if cid == PLC_ID:
+            for k, v in self.plc_args.items():
+                setattr(a, k, v)
+        return a
+
+    def checkpoint(self):
+        """Snapshot of the whole line; valid from on_step (every component parked)."""
+        import checkpoint
+        return checkpoint.capture(self)
+
+    def component(self, cid):
+        return self.components[cid].obj
+
+    @property
+    def plc(self):
+        return self.component(PLC_ID)
+
+    def _hook_first_scan(self, comp, rng_state):
+        """Restore / apply params where mainThread() has connected and is about to enter its loop."""
+        obj = comp.obj
+        connect = obj.establishTcpUdpConnection
+
+        def _start():
+            connect()
+            del obj.establishTcpUdpConnection
+            if self.restore is not None:
+                import checkpoint
+                checkpoint.restore_component(obj, self.restore["components"][comp.cid])
+                comp.rx_packets, comp.tx_packets = self.restore["components"][comp.cid]["packets"]
+                random.setstate(rng_state)
+            if comp.cid == PLC_ID and self.params:
+                obj.apply_params(self.params)
+        obj.establishTcpUdpConnection = _start
+
+    def _thread_main(self, comp, rng_state=None):
+        comp.go.wait()
+        comp.go.clear()
+        try:
+            comp.obj = comp.cls(self._args_for(comp.cid))
+            if self.restore is not None or (comp.cid == PLC_ID and self.params):
+                self._hook_first_scan(comp, rng_state)
+            comp.obj.mainThread()
+        except BaseException as e:
+            comp.errors.append(f"{type(e).__name__}: {e}")
+        finally:
+            comp.alive = False
+            self.fabric._yield.set()
+
+    def run(self):
+        global _fabric
+        install_stubs()
+        total_ns = self.start_ns + int(round(self.horizon_s * 1e9))
+        fab = Fabric(total_ns, self.step_ns, start_ns=self.start_ns)
+        self.fabric = fab
+        if self.restore is not None:
+            import checkpoint
+            checkpoint.restore_fabric(fab, self.restore)
+
+        modules = {name: import_component(name) for _, name, _ in COMPONENTS}
+        saved = {}
+        for mod_name, patch in self.module_overrides.items():
+            mod = modules.get(mod_name) or import_component(mod_name)
+            for k, v in patch.items():
+                saved[(mod_name, k)] = getattr(mod, k)
+                setattr(mod, k, v)
+
+        sink = _NullOut()
+        orig_seed = random.seed
+        orig_rng = random.getstate()
+        orig_stdout = sys.stdout
+        muted = []
+        self.components = []
+        resume_rng = {}
+        for cid, mod_name, cls_name in COMPONENTS:
+            comp = _Component(cid, modules[mod_name], getattr(modules[mod_name], cls_name))
+            orig_seed(f"{self.seed}:{cid}")
+            comp.rng_state = random.getstate()
+            if self.restore is not None:
+                same = self.seed == self.restore["seed"]
+                resume_rng[cid] = self.restore["components"][cid]["rng_state"] if same else comp.rng_state
+            self.components.append(comp)
+
+        if self.seed is not None:
+            salt = self.seed
+
+            def _salted_seed(a=None, version=2):
+                cid = fab.current.cid if fab.current is not None else -1
+                orig_seed(f"{salt}:{cid}:{a}", version)
+            random.seed = _salted_seed
+
+        if self.quiet == "mute":
+            for comp in self.components:
+                comp.module.print = _mute_print(sink)
+                muted.append(comp.module)
+        if self.quiet in ("devnull", "mute"):
+            sys.stdout = sink
+
+        _fabric = fab
+        t0 = time.perf_counter()
+        try:
+            for comp in self.components:
+                comp.thread = threading.Thread(target=self._thread_main, args=(comp, resume_rng.get(comp.cid)),
+                                               daemon=True)
+                comp.thread.start()
+
+            while any(c.alive for c in self.components):
+                for comp in self.components:
+                    if not comp.alive:
+                        continue
+                    fab.current = comp
+                    random.setstate(comp.rng_state)
+                    fab._yield.clear()
+                    comp.go.set()
+                    fab._yield.wait()
+                    comp.rng_state = random.getstate()
+                fab.current = None
+                fab.deliver()
+                fab.steps += 1
+                fab.now_ns += fab.step_ns
+                if self.on_step is not None:
+                    self.on_step(self)
+        finally:
+            wall_s = time.perf_counter() - t0
+            sys.stdout = orig_stdout
+            random.seed = orig_seed
+            random.setstate(orig_rng)
+            for mod in muted:
+                try:
+                    del mod.print
+                except AttributeError:
+                    pass
+            for (mod_name, k), v in saved.items():
+                setattr(modules[mod_name], k, v)
+            _fabric = None
+
+        errors = list(sink.error_lines)
+        for comp in self.components:
+            errors.extend(f"{comp.module.__name__}: {e}" for e in comp.errors)
+        return self._result(wall_s, errors)
+
+    def _result(self, wall_s, errors):
+        import opt_dashboard
+        plc_mod = self.components[PLC_ID].module
+        plc = self.plc
+        sim_s = (self.fabric.now_ns - self.start_ns) / 1e9
+        kpis = opt_dashboard.build_kpi_snapshot(plc, plc.mySignals, plc_mod.STATIONS) if plc else {}
+        scans = int(getattr(plc, "_scan_count", 0) or 0)
+        decoded = self.components[PLC_ID].rx_packets
+        wall = max(wall_s, 1e-9)
+        return {
+            "horizon_s": self.horizon_s,
+            "step_ms": self.step_ns / 1e6,
+            "seed": self.seed,
+            "sim_s": sim_s,
+            "wall_s": wall_s,
+            "steps": self.fabric.steps,
+            "scans": scans,
+            "packets_decoded": decoded,
+            "sim_s_per_wall_s": sim_s / wall,
+            "scans_per_s": scans / wall,
+            "packets_decoded_per_s": decoded / wall,
+            "finished": int(getattr(plc, "finished", 0) or 0),
+            "kpis": kpis,
+            "errors": errors,
+        }
+
+
+def run_line(horizon_s=600.0, step_ms=DEFAULT_STEP_MS, seed=None, quiet="devnull",
+             plc_args=None, module_overrides=None, params=None):
+    """Run the full line headless and return timing + final KPI snapshot."""
+    line = HeadlessLine(horizon_s=horizon_s, step_ms=step_ms, seed=seed, quiet=quiet,
+                        plc_args=plc_args, module_overrides=module_overrides, params=params)
+    return line.run()
+
+
+if __name__ == "__main__":
+    import argparse
+    import json
+
+    ap = argparse.ArgumentParser(description="Run the PLC + ST1..ST6 line headless")
+    ap.add_argument("--horizon", type=float, default=600.0, help="simulated seconds")
+    ap.add_argument("--step-ms", type=float, default=DEFAULT_STEP_MS, help="VSI simulation step")
+    ap.add_argument("--seed", type=int, default=None)
+    ap.add_argument("--quiet", choices=("devnull", "mute", "none"), default="mute")
+    a = ap.parse_args()
+    res = run_line(a.horizon, a.step_ms, a.seed, quiet=a.quiet)
+    print(json.dumps(res, indent=2))
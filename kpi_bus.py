@@ -0,0 +1,325 @@
+# pythonGateways/kpi_bus.py
+"""
+Shared-memory KPI bus: the PLC publishes one fixed-layout record per scan into
+a memory-mapped file, any number of dashboard processes map it read-only.
+
+Consistency uses a seqlock: the writer bumps the sequence number to odd,
+writes the record in place, then bumps it to even. Readers unpack straight
+from the mapping (struct.unpack_from, no intermediate copy) and retry if the
+sequence was odd or changed underneath them. The writer never blocks.
+
+    # PLC side (PLC_OPTIONS="--kpi-bus PATH")
+    bus = KpiBusWriter(path); bus.publish(opt_dashboard.build_kpi_snapshot(...))
+
+    # Dashboard side
+    snap = KpiBusReader(path).read()     # same keys as build_kpi_snapshot()
+
+    python kpi_bus.py --watch [PATH]
+
+Layout v3 carries the scalar KPIs, per-station signals and idle time,
+buffer occupancy (now and time-weighted), the WIP / lead-time /
+Little's law block and the steady-state estimates with their precision.
+Not carried (read them from /api/kpis): bottleneck windows, watchdog and
+recovery detail, active blocks, operator settings, station done_time_s and
+the steady-state per-KPI warm-up cut times. A reader only maps a region whose version and
+size match its own, so an older reader sees a newer PLC as "no bus yet".
+"""
+import math
+import mmap
+import os
+import struct
+import sys
+import time
+
+MAGIC = b"KPIB"
+VERSION = 3
+
+MAX_STATIONS = 16
+MAX_BUFFERS = 8
+NAME_LEN = 16
+
+_BASE_DIR = os.path.dirname(os.path.abspath(__file__))
+# tmpfs when available so the kernel never writes the region back to disk
+DEFAULT_PATH = "/dev/shm/vsi_kpi_bus" if os.path.isdir("/dev/shm") else os.path.join(_BASE_DIR, "kpi_bus.shm")
+
+# magic, version, record size, sequence, publish wall time (ns)
+_HDR = struct.Struct("<4sIIxxxxQQ")
+_SEQ_OFF = 16
+
+# sim_time_s, packages, tpm, accept, reject, yield, bneck_util, idle_pct,
+# downtime_s, availability, fault_any, batch_id, recipe_id, scans,
+# plc_state, bottleneck_station, n_stations, n_buffers
+_BODY = struct.Struct(f"<dQdQQddddd IIIQ {NAME_LEN * 2}s{NAME_LEN}s II")
+# wip, units_completed, units_lost, lead count, lead mean/p50/p90/p99/max,
+# queue_time_s_mean, littles L/lambda_per_s/W_s/lambda_W/rel_error
+_WIP = struct.Struct("<IQQQ ddddd d ddddd")
+# warm-up truncated_s, warm-up units, settled, units
+_STEADY = struct.Struct("<dIBxxxQ")
+# one per steady-state KPI: mean, ci95 lo/hi, half_width, rel_precision, batches, n (NaN = None)
+_SS_KPI = struct.Struct("<ddddd II")
+SS_KPIS = ("throughput_per_min", "cycle_time_s", "yield_pct")
+# name, ready, busy, fault, done, cycle_time_ms, idle_s
+_STATION = struct.Struct(f"<{NAME_LEN}sBBBBI d")
+# name, units, avg occupancy
+_BUFFER = struct.Struct(f"<{NAME_LEN}si d")
+
+_BODY_OFF = _HDR.size
+_WIP_OFF = _BODY_OFF + _BODY.size
+_STEADY_OFF = _WIP_OFF + _WIP.size
+_SS_KPI_OFF = _STEADY_OFF + _STEADY.size
+_ST_OFF = _SS_KPI_OFF + _SS_KPI.size * len(SS_KPIS)
+_BUF_OFF = _ST_OFF + _STATION.size * MAX_STATIONS
+SIZE = _BUF_OFF + _BUFFER.size * MAX_BUFFERS
+
+
+def _name(b):
+    return b.split(b"\0", 1)[0].decode("utf-8", "replace")
+
+
+def _f(v):
+    return math.nan if v is None else float(v)
+
+
+def _opt(v):
+    return None if math.isnan(v) else v
+
+
+class KpiBusWriter:
+    """Single writer (the PLC). Creates/truncates the region on open."""
+
+    def __init__(self, path=DEFAULT_PATH):
+        self.path = path
+        fd = os.open(path, os.O_RDWR | os.O_CREAT, 0o644)
+        try:
+            os.ftruncate(fd, SIZE)
+            self._mm = mmap.mmap(fd, SIZE)
+        finally:
+            os.close(fd)
+        self._seq = 0
+        self._scans = 0
+        _HDR.pack_into(self._mm, 0, MAGIC, VERSION, SIZE, 0, 0)
+        self._body = bytearray(SIZE - _BODY_OFF)
+
+    def publish(self, snap):
+        """Write one build_kpi_snapshot() dict."""
+        self._scans += 1
+        body = self._body
+        stations = list((snap.get("stations") or {}).items())[:MAX_STATIONS]
+        buffers = list((snap.get("buffers") or {}).items())[:MAX_BUFFERS]
+
+        # stage into a private buffer so the odd window is one memcpy long
+        _BODY.pack_into(
+            body, 0,
+            float(snap.get("sim_time_s", 0.0)),
+            int(snap.get("packages_completed", 0)),
+            float(snap.get("throughput_per_min", 0.0)),
+            int(snap.get("accept", 0)),
+            int(snap.get("reject", 0)),
+            float(snap.get("yield_pct", 0.0)),
+            float(snap.get("bottleneck_utilization", 0.0)),
+            float(snap.get("line_idle_pct", 0.0)),
+            float(snap.get("downtime_s", 0.0)),
+            float(snap.get("availability", 0.0)),
+            int(snap.get("fault_any", 0)),
+            int(snap.get("batch_id", 0)) & 0xFFFFFFFF,
+            int(snap.get("recipe_id", 0)) & 0xFFFFFFFF,
+            self._scans,
+            str(snap.get("plc_state", "")).encode("utf-8")[:NAME_LEN * 2],
+            str(snap.get("bottleneck_station", "")).encode("utf-8")[:NAME_LEN],
+            len(stations),
+            len(buffers),
+        )
+        lead = snap.get("lead_time_s") or {}
+        ll = snap.get("littles_law") or {}
+        _WIP.pack_into(
+            body, _WIP_OFF - _BODY_OFF,
+            max(0, int(snap.get("wip", 0))),
+            int(snap.get("units_completed", 0)),
+            int(snap.get("units_lost", 0)),
+            int(lead.get("count", 0)),
+            *(float(lead.get(k, 0.0)) for k in ("mean", "p50", "p90", "p99", "max")),
+            float(snap.get("queue_time_s_mean", 0.0)),
+            *(float(ll.get(k, 0.0)) for k in ("L", "lambda_per_s", "W_s", "lambda_W", "rel_error")),
+        )
+        ss = snap.get("steady_state") or {}
+        warm = ss.get("warmup") or {}
+        _STEADY.pack_into(body, _STEADY_OFF - _BODY_OFF, float(warm.get("truncated_s", 0.0)),
+                          int(warm.get("units", 0)), 1 if warm.get("settled") else 0, int(ss.get("units", 0)))
+        off = _SS_KPI_OFF - _BODY_OFF
+        for k in SS_KPIS:
+            v = ss.get(k) or {}
+            lo, hi = (v.get("ci95") or [None, None])[:2]
+            _SS_KPI.pack_into(body, off, _f(v.get("mean")), _f(lo), _f(hi), _f(v.get("half_width")),
+                              _f(v.get("rel_precision")), int(v.get("batches") or 0), int(v.get("n") or 0))
+            off += _SS_KPI.size
+
+        idle = snap.get("idle_s") or {}
+        off = _ST_OFF - _BODY_OFF
+        for name, sx in stations:
+            _STATION.pack_into(body, off, str(name).encode("utf-8")[:NAME_LEN],
+                               int(sx.get("ready", 0)) & 1, int(sx.get("busy", 0)) & 1,
+                               int(sx.get("fault", 0)) & 1, int(sx.get("done", 0)) & 1,
+                               max(0, int(sx.get("cycle_time_ms", 0))) & 0xFFFFFFFF,
+                               float(idle.get(name, 0.0)))
+            off += _STATION.size
+        avg = snap.get("buffer_avg_occupancy") or {}
+        off = _BUF_OFF - _BODY_OFF
+        for name, v in buffers:
+            _BUFFER.pack_into(body, off, str(name).encode("utf-8")[:NAME_LEN], int(v),
+                              float(avg.get(name, 0.0)))
+            off += _BUFFER.size
+
+        mm = self._mm
+        self._seq += 1
+        struct.pack_into("<Q", mm, _SEQ_OFF, self._seq)          # odd: write in progress
+        mm[_BODY_OFF:SIZE] = body
+        self._seq += 1
+        struct.pack_into("<QQ", mm, _SEQ_OFF, self._seq, time.time_ns())
+
+    def close(self):
+        if self._mm is not None:
+            self._mm.close()
+            self._mm = None
+
+
+class KpiBusReader:
+    """Any number of readers, in any process."""
+
+    def __init__(self, path=DEFAULT_PATH):
+        self.path = path
+        self._mm = None
+
+    def _open(self):
+        if self._mm is not None:
+            return True
+        try:
+            with open(self.path, "rb") as f:
+                mm = mmap.mmap(f.fileno(), SIZE, access=mmap.ACCESS_READ)
+        except (OSError, ValueError):
+            return False
+        magic, version, size, _, _ = _HDR.unpack_from(mm, 0)
+        if magic != MAGIC or version != VERSION or size != SIZE:
+            mm.close()
+            return False
+        self._mm = mm
+        return True
+
+    def seq(self):
+        """Current sequence number (even = stable); 0 before the first publish."""
+        if not self._open():
+            return 0
+        return struct.unpack_from("<Q", self._mm, _SEQ_OFF)[0]
+
+    def read(self, retries=1000):
+        """Consistent snapshot dict, or {} if the bus is not there yet."""
+        if not self._open():
+            return {}
+        mm = self._mm
+        for _ in range(retries):
+            s1 = struct.unpack_from("<Q", mm, _SEQ_OFF)[0]
+            if s1 & 1:
+                continue
+            if s1 == 0:
+                return {}
+            snap = self._unpack(mm)
+            s2, wall_ns = struct.unpack_from("<QQ", mm, _SEQ_OFF)
+            if s1 == s2:
+                snap["seq"] = s2
+                snap["published_at"] = wall_ns / 1e9
+                return snap
+        return {}
+
+    @staticmethod
+    def _unpack(mm):
+        (t_s, packages, tpm, accept, reject, yield_pct, bneck_util, idle_pct, downtime_s, availability,
+         fault_any, batch_id, recipe_id, scans, state, bneck, n_st, n_buf) = _BODY.unpack_from(mm, _BODY_OFF)
+        (wip, completed, lost, lead_n, lead_mean, p50, p90, p99, lead_max, queue_s,
+         L, lam, W, lam_W, ll_err) = _WIP.unpack_from(mm, _WIP_OFF)
+        warm_s, warm_units, settled, ss_units = _STEADY.unpack_from(mm, _STEADY_OFF)
+        steady = {"warmup": {"truncated_s": warm_s, "units": warm_units, "settled": bool(settled)},
+                  "units": ss_units}
+        off = _SS_KPI_OFF
+        for k in SS_KPIS:
+            mean, lo, hi, half, rel, batches, n = _SS_KPI.unpack_from(mm, off)
+            steady[k] = {"mean": _opt(mean), "ci95": [_opt(lo), _opt(hi)], "half_width": _opt(half),
+                         "rel_precision": _opt(rel), "batches": batches, "n": n}
+            off += _SS_KPI.size
+
+        stations, idle = {}, {}
+        off = _ST_OFF
+        for _ in range(min(n_st, MAX_STATIONS)):
+            name, ready, busy, fault, done, ct, idle_s = _STATION.unpack_from(mm, off)
+            name = _name(name)
+            stations[name] = {"ready": ready, "busy": busy, "fault": fault, "done": done,
+                              "cycle_time_ms": ct}
+            idle[name] = idle_s
+            off += _STATION.size
+        buffers, avg = {}, {}
+        off = _BUF_OFF
+        for _ in range(min(n_buf, MAX_BUFFERS)):
+            name, v, occ = _BUFFER.unpack_from(mm, off)
+            name = _name(name)
+            buffers[name] = v
+            avg[name] = occ
+            off += _BUFFER.size
+        return {
+            "sim_time_s": t_s,
+            "plc_state": _name(state),
+            "batch_id": batch_id,
+            "recipe_id": recipe_id,
+            "packages_completed": packages,
+            "throughput_per_min": tpm,
+            "accept": accept,
+            "reject": reject,
+            "yield_pct": yield_pct,
+            "buffers": buffers,
+            "buffer_avg_occupancy": avg,
+            "idle_s": idle,
+            "wip": wip,
+            "units_completed": completed,
+            "units_lost": lost,
+            "lead_time_s": {"count": lead_n, "mean": lead_mean, "p50": p50, "p90": p90, "p99": p99,
+                            "max": lead_max},
+            "queue_time_s_mean": queue_s,
+            "littles_law": {"L": L, "lambda_per_s": lam, "W_s": W, "lambda_W": lam_W, "rel_error": ll_err},
+            "steady_state": steady,
+            "bottleneck_station": _name(bneck),
+            "bottleneck_utilization": bneck_util,
+            "line_idle_pct": idle_pct,
+            "downtime_s": downtime_s,
+            "availability": availability,
+            "fault_any": fault_any,
+            "stations": stations,
+            "scans": scans,
+        }
+
+    def close(self):
+        if self._mm is not None:
+            self._mm.close()
+            self._mm = None
+
+
+if __name__ == "__main__":
+    import argparse
+    import json
+
+    ap = argparse.ArgumentParser(description="Read the PLC KPI bus")
+    ap.add_argument("path", nargs="?", default=DEFAULT_PATH)
+    ap.add_argument("--watch", action="store_true", help="print every new snapshot")
+    ap.add_argument("--interval", type=float, default=0.2)
+    a = ap.parse_args()
+
+    rd = KpiBusReader(a.path)
+    if not a.watch:
+        print(json.dumps(rd.read(), indent=2))
+        sys.exit(0)
+    last = None
+    try:
+        while True:
+            snap = rd.read()
+            if snap and snap.get("seq") != last:
+                last = snap.get("seq")
+                print(json.dumps(snap))
+            time.sleep(a.interval)
+    except KeyboardInterrupt:
+        pass
@@ -0,0 +1,219 @@
+# pythonGateways/line_bottleneck.py
+"""
+Online bottleneck detection with the active-period method.
+
+A station is active while it works on a unit or is being repaired (busy,
+fault, or held in reset); it is inactive while it waits (starved, blocked,
+idle). At any instant the momentary bottleneck is the station whose current
+active period is the longest. Where the active periods of two successive
+momentary bottlenecks overlap, the bottleneck is shifting between them;
+otherwise it is a sole bottleneck.
+
+Each sliding window reports per station the share of time it was the sole
+and the shifting bottleneck. The primary bottleneck is the station with the
+largest combined share.
+
+    det = ActivePeriodDetector(["S1", ..., "S6"], windows_s=(300, 1800))
+    det.observe(now_ns, {"S1": 1, "S2": 0, ...})    # whole line, e.g. per PLC scan
+    det.update("S3", now_ns, active)                 # or one station at a time
+    det.summary(now_ns)
+
+Both feeds take samples; a state is assumed to hold until the next sample
+for that station. Samples must arrive in time order. Sources on separate
+clocks (one log file per station, tailed independently) get one detector
+each, and merge() combines them up to the time every source has reached:
+
+    line = merge(detectors)          # None until every source has a sample
+    line.summary()
+"""
+from collections import deque
+
+DEFAULT_WINDOWS_S = (300.0, 1800.0)
+REFRESH_S = 10.0   # summary() recomputes at most this often (simulated time)
+
+
+class ActivePeriodDetector:
+    def __init__(self, stations=(), windows_s=DEFAULT_WINDOWS_S, refresh_s=REFRESH_S):
+        self.windows_ns = tuple(int(w * 1e9) for w in windows_s)
+        self.horizon_ns = max(self.windows_ns) if self.windows_ns else 0
+        self.refresh_ns = int(refresh_s * 1e9)
+        self.order = []
+        self.closed = {}      # station -> deque[(start_ns, end_ns)]
+        self.open = {}        # station -> start_ns of the running active period
+        self.last_ns = None
+        self._cache_ns = None
+        self._cache = None
+        for st in stations:
+            self._add(st)
+
+    def _add(self, st):
+        if st not in self.closed:
+            self.order.append(st)
+            self.closed[st] = deque()
+
+    # ---------------- feeding ----------------
+    def update(self, st, t_ns, active):
+        self._add(st)
+        t_ns = int(t_ns)
+        if active:
+            self.open.setdefault(st, t_ns)
+        elif st in self.open:
+            start = self.open.pop(st)
+            if t_ns > start:
+                self.closed[st].append((start, t_ns))
+        if self.last_ns is None or t_ns > self.last_ns:
+            self.last_ns = t_ns
+            self._trim(t_ns)
+
+    def observe(self, t_ns, active_by_station):
+        for st, a in active_by_station.items():
+            self.update(st, t_ns, a)
+
+    def _trim(self, now_ns):
+        cut = now_ns - self.horizon_ns
+        for q in self.closed.values():
+            while q and q[0][1] <= cut:
+                q.popleft()
+
+    # ---------------- analysis ----------------
+    def _periods(self, now_ns):
+        """station -> [(start, end)] with the open period running until now."""
+        out = {}
+        for st in self.order:
+            ps = list(self.closed[st])
+            if st in self.open and now_ns > self.open[st]:
+                ps.append((self.open[st], now_ns))
+            out[st] = ps
+        return out
+
+    def current(self, now_ns=None):
+        """Momentary bottleneck right now (longest running active period), or None."""
+        now_ns = self.last_ns if now_ns is None else int(now_ns)
+        best, best_len = None, 0
+        for st in self.order:
+            if st in self.open and now_ns - self.open[st] > best_len:
+                best, best_len = st, now_ns - self.open[st]
+        return best
+
+    def window(self, w_ns, now_ns=None):
+        now_ns = self.last_ns if now_ns is None else int(now_ns)
+        if now_ns is None:
+            return None
+        w0 = now_ns - w_ns
+        periods = self._periods(now_ns)
+
+        # elementary intervals between period boundaries inside the window
+        cuts = {w0, now_ns}
+        for ps in periods.values():
+            for s, e in ps:
+                if s > w0:
+                    cuts.add(s)
+                if e < now_ns:
+                    cuts.add(e)
+        cuts = sorted(c for c in cuts if w0 <= c <= now_ns)
+
+        idx = {st: 0 for st in self.order}
+        segs = []          # (t0, t1, station, (p_start, p_end)) merged per active period
+        for a, b in zip(cuts, cuts[1:]):
+            best, best_p = None, None
+            for st in self.order:
+                ps = periods[st]
+                k = idx[st]
+                while k < len(ps) and ps[k][1] <= a:
+                    k += 1
+                idx[st] = k
+                if k < len(ps) and ps[k][0] <= a:
+                    p = ps[k]
+                    if best_p is None or (p[1] - p[0]) > (best_p[1] - best_p[0]):
+                        best, best_p = st, p
+            if best is None:
+                continue
+            if segs and segs[-1][2] == best and segs[-1][3] == best_p and segs[-1][1] == a:
+                segs[-1] = (segs[-1][0], b, best, best_p)
+            else:
+                segs.append((a, b, best, best_p))
+
+        # shifting: overlap of consecutive bottlenecks' active periods at the hand-over
+        shifting = {st: [] for st in self.order}
+        for (a0, a1, sa, pa), (b0, b1, sb, pb) in zip(segs, segs[1:]):
+            if sa == sb or a1 != b0:
+                continue
+            lo, hi = max(pa[0], pb[0], w0), min(pa[1], pb[1], now_ns)
+            if hi > lo:
+                shifting[sa].append((lo, hi))
+                shifting[sb].append((lo, hi))
+
+        span = float(max(1, now_ns - w0))
+        sole_ns = {st: 0 for st in self.order}
+        shift_ns = {st: _union_len(iv) for st, iv in shifting.items()}
+        for t0, t1, st, _ in segs:
+            sole_ns[st] += (t1 - t0) - _overlap_len(t0, t1, shifting[st])
+        active_ns = {st: sum(max(0, min(e, now_ns) - max(s, w0)) for s, e in periods[st]) for st in self.order}
+
+        share = {st: (sole_ns[st] + shift_ns[st]) / span for st in self.order}
+        primary = max(self.order, key=lambda st: share[st]) if self.order else None
+        if primary is not None and share[primary] <= 0:
+            primary = None
+        return {
+            "window_s": w_ns / 1e9,
+            "primary": primary,
+            "primary_share": share.get(primary, 0.0) if primary else 0.0,
+            "sole_pct": {st: 100.0 * sole_ns[st] / span for st in self.order},
+            "shifting_pct": {st: 100.0 * shift_ns[st] / span for st in self.order},
+            "active_pct": {st: 100.0 * active_ns[st] / span for st in self.order},
+        }
+
+    def summary(self, now_ns=None, force=False):
+        now_ns = self.last_ns if now_ns is None else int(now_ns)
+        if now_ns is None:
+            return {"current": None, "windows": {}}
+        if (not force and self._cache is not None and self._cache_ns is not None
+                and 0 <= now_ns - self._cache_ns < self.refresh_ns):
+            out = dict(self._cache)
+            out["current"] = self.current(now_ns)
+            return out
+        out = {
+            "current": self.current(now_ns),
+            "windows": {f"{w / 1e9:g}": self.window(w, now_ns) for w in self.windows_ns},
+        }
+        self._cache_ns = now_ns
+        self._cache = out
+        return out
+
+
+def merge(detectors, windows_s=DEFAULT_WINDOWS_S):
+    """
+    One detector over the stations of several detectors, each fed on its
+    own clock. Its clock is the earliest of theirs, so a source that lags
+    behind never makes the line clock run backwards; later periods of the
+    others are clipped there.
+    """
+    dets = [d for d in detectors if d.last_ns is not None]
+    if not dets:
+        return None
+    out = ActivePeriodDetector(windows_s=windows_s)
+    for d in dets:
+        for st in d.order:
+            out._add(st)
+            out.closed[st].extend(d.closed[st])
+            if st in d.open:
+                out.open[st] = d.open[st]
+    out.last_ns = min(d.last_ns for d in dets)
+    return out
+
+
+def _union_len(intervals):
+    total, end = 0, None
+    for s, e in sorted(intervals):
+        if end is None or s > end:
+            total += e - s
+            end = e
+        elif e > end:
+            total += e - end
+            end = e
+    return total
+
+
+def _overlap_len(t0, t1, intervals):
+    clipped = [(max(s, t0), min(e, t1)) for s, e in intervals if e > t0 and s < t1]
+    return _union_len(clipped)
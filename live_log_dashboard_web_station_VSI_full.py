@@ -30,17 +30,19 @@ from typing import Dict, Any, Optional, Tuple, List
 
 from aiohttp import web
 
+import line_bottleneck
+
 
 # -------------------------
 # Config
 # -------------------------
-DEFAULT_CODE_FONT_PX = 12
-RAW_LINES_PER_STATION = 220
-RAW_LINES_PER_FILE_FALLBACK = 260
-# Keep station KPI cards local to each station log by default.
-# Set to True only if running with PLC-only logs and no per-station files.
-ENABLE_PLC_KPI_FANOUT = False
-DEFAULT_LOG_FILES = [
+DEFAULT_CODE_FONT_PX = 12
+RAW_LINES_PER_STATION = 220
+RAW_LINES_PER_FILE_FALLBACK = 260
+# Keep station KPI cards local to each station log by default.
+# Set to True only if running with PLC-only logs and no per-station files.
+ENABLE_PLC_KPI_FANOUT = False
+DEFAULT_LOG_FILES = [
     # Windows local defaults
     r"D:\KPIs\check.PLC_LineCoordinator.log",
     r"D:\KPIs\check.ST1_ComponentKitting.log",
@@ -149,29 +151,29 @@ def _parse_value(raw: str) -> Any:
     return raw
 
 
-def _to_int01(v: Any) -> int:
-    if isinstance(v, bool):
-        return 1 if v else 0
-    if isinstance(v, (int, float)):
-        return 1 if int(v) != 0 else 0
-    return 0
-
-
-def _to_nonneg_int(v: Any) -> Optional[int]:
-    if isinstance(v, bool):
-        return int(v)
-    if isinstance(v, (int, float)):
-        return max(0, int(v))
-    if isinstance(v, str):
-        p = _parse_value(v)
-        if isinstance(p, bool):
-            return int(p)
-        if isinstance(p, (int, float)):
-            return max(0, int(p))
-    return None
-
-
-LOG_KPI_KEYS = {
+def _to_int01(v: Any) -> int:
+    if isinstance(v, bool):
+        return 1 if v else 0
+    if isinstance(v, (int, float)):
+        return 1 if int(v) != 0 else 0
+    return 0
+
+
+def _to_nonneg_int(v: Any) -> Optional[int]:
+    if isinstance(v, bool):
+        return int(v)
+    if isinstance(v, (int, float)):
+        return max(0, int(v))
+    if isinstance(v, str):
+        p = _parse_value(v)
+        if isinstance(p, bool):
+            return int(p)
+        if isinstance(p, (int, float)):
+            return max(0, int(p))
+    return None
+
+
+LOG_KPI_KEYS = {
     "inventory_ok",
     "any_arm_failed",
     "batch_id",
@@ -538,6 +540,10 @@ class StatsStore:
         self.station_lines: Dict[Tuple[str, str], deque] = {}
         self.file_lines: Dict[str, deque] = {}
         self.file_stopped: Dict[str, bool] = {}
+        # active periods per station (busy, fault or held in reset), sim time;
+        # one detector per log file, each file's VSI clock only moves forward
+        self.bneck: Dict[str, line_bottleneck.ActivePeriodDetector] = {}
+        self._bneck_summary: Tuple[Optional[int], Dict[str, Any]] = (None, {})
 
     def _stq(self, file: str, station: str) -> deque:
         key = (file, station)
@@ -616,6 +622,13 @@ class StatsStore:
         accept_now = _to_int01(st.outputs.get("accept", 0))
         reject_now = _to_int01(st.outputs.get("reject", 0))
 
+        if str(st.station).upper() != "PLC":
+            active = _to_int01(st.outputs.get("busy", 0)) or fault or cmd_reset
+            det = self.bneck.get(snap.source_file)
+            if det is None:
+                det = self.bneck[snap.source_file] = line_bottleneck.ActivePeriodDetector()
+            det.update(st.station, snap.vsi_time_ns, active)
+
         if st._prev_done == 0 and done == 1:
             st.cycles_done += 1
         if st._prev_fault == 0 and fault == 1:
@@ -751,117 +764,117 @@ class StatsStore:
             if not lines:
                 lines = list(self.file_lines.get(file, []))
 
-            key = f"{os.path.basename(file)}::{station}"
-
-            log_kpis = dict(st.log_kpis)
-            total_completed_candidates = [
-                st.cycles_done,
-                st.cumulative_accepts + st.cumulative_rejects,
-            ]
-            for key_name in ("total_completed", "packages_completed", "kpis_total_completed", "kpis_packages_completed"):
-                val = _to_nonneg_int(log_kpis.get(key_name))
-                if val is not None:
-                    total_completed_candidates.append(val)
-
-            completed_sample = _to_nonneg_int(log_kpis.get("completed"))
-            if completed_sample is not None and completed_sample > 1:
-                total_completed_candidates.append(completed_sample)
-
-            completed_total = max(total_completed_candidates) if total_completed_candidates else 0
-
-            accepted_candidates = [st.cumulative_accepts]
-            rejected_candidates = [st.cumulative_rejects]
-
-            for key_name in ("accepted", "accepted_total", "accept_total",
-                             "kpis_accepted", "kpis_accepted_total", "kpis_accept_total"):
-                val = _to_nonneg_int(log_kpis.get(key_name))
-                if val is not None:
-                    accepted_candidates.append(val)
-
-            accept_sample = _to_nonneg_int(log_kpis.get("accept"))
-            if accept_sample is not None and accept_sample > 1:
-                accepted_candidates.append(accept_sample)
-
-            for key_name in ("rejected", "rejected_total", "reject_total",
-                             "kpis_rejected", "kpis_rejected_total", "kpis_reject_total"):
-                val = _to_nonneg_int(log_kpis.get(key_name))
-                if val is not None:
-                    rejected_candidates.append(val)
-
-            reject_sample = _to_nonneg_int(log_kpis.get("reject"))
-            if reject_sample is not None and reject_sample > 1:
-                rejected_candidates.append(reject_sample)
-
-            accepted_total = max(accepted_candidates) if accepted_candidates else 0
-            rejected_total = max(rejected_candidates) if rejected_candidates else 0
-
-            if completed_total > 0:
-                if accepted_total > 0 and rejected_total == 0:
-                    rejected_total = max(0, completed_total - accepted_total)
-                elif rejected_total > 0 and accepted_total == 0:
-                    accepted_total = max(0, completed_total - rejected_total)
-
-            completed_total = max(completed_total, accepted_total + rejected_total)
-
-            accept_now = _to_int01(st.outputs.get("accept", log_kpis.get("accept", 0)))
-            reject_now = _to_int01(st.outputs.get("reject", log_kpis.get("reject", 0)))
-            completed_now = _to_int01(st.outputs.get("completed", st.outputs.get("done", log_kpis.get("completed", 0))))
-
-            kpis_payload = {
-                "cycles_done": st.cycles_done,
-                "faults_count": st.faults_count,
-                "start_pulses": st.start_pulses,
-                "reset_pulses": st.reset_pulses,
-                "stop_asserts": st.stop_asserts,
-                "busy_total_s": round(busy_s, 3),
-                "last_cycle_ms": (st.cycle_time_ms_hist[-1] if st.cycle_time_ms_hist else None),
-                "cumulative_accepts": st.cumulative_accepts,
-                "cumulative_rejects": st.cumulative_rejects,
-                **log_kpis,
-                "accept_now": accept_now,
-                "reject_now": reject_now,
-                "completed_now": completed_now,
-                "accept": accepted_total,
-                "reject": rejected_total,
-                "completed": completed_total,
-                "accepted_total": accepted_total,
-                "rejected_total": rejected_total,
-                "completed_total": completed_total,
-            }
-
-            items.append({
-                "id": key,
-                "file": os.path.basename(file),
-                "station": station,
+            key = f"{os.path.basename(file)}::{station}"
+
+            log_kpis = dict(st.log_kpis)
+            total_completed_candidates = [
+                st.cycles_done,
+                st.cumulative_accepts + st.cumulative_rejects,
+            ]
+            for key_name in ("total_completed", "packages_completed", "kpis_total_completed", "kpis_packages_completed"):
+                val = _to_nonneg_int(log_kpis.get(key_name))
+                if val is not None:
+                    total_completed_candidates.append(val)
+
+            completed_sample = _to_nonneg_int(log_kpis.get("completed"))
+            if completed_sample is not None and completed_sample > 1:
+                total_completed_candidates.append(completed_sample)
+
+            completed_total = max(total_completed_candidates) if total_completed_candidates else 0
+
+            accepted_candidates = [st.cumulative_accepts]
+            rejected_candidates = [st.cumulative_rejects]
+
+            for key_name in ("accepted", "accepted_total", "accept_total",
+                             "kpis_accepted", "kpis_accepted_total", "kpis_accept_total"):
+                val = _to_nonneg_int(log_kpis.get(key_name))
+                if val is not None:
+                    accepted_candidates.append(val)
+
+            accept_sample = _to_nonneg_int(log_kpis.get("accept"))
+            if accept_sample is not None and accept_sample > 1:
+                accepted_candidates.append(accept_sample)
+
+            for key_name in ("rejected", "rejected_total", "reject_total",
+                             "kpis_rejected", "kpis_rejected_total", "kpis_reject_total"):
+                val = _to_nonneg_int(log_kpis.get(key_name))
+                if val is not None:
+                    rejected_candidates.append(val)
+
+            reject_sample = _to_nonneg_int(log_kpis.get("reject"))
+            if reject_sample is not None and reject_sample > 1:
+                rejected_candidates.append(reject_sample)
+
+            accepted_total = max(accepted_candidates) if accepted_candidates else 0
+            rejected_total = max(rejected_candidates) if rejected_candidates else 0
+
+            if completed_total > 0:
+                if accepted_total > 0 and rejected_total == 0:
+                    rejected_total = max(0, completed_total - accepted_total)
+                elif rejected_total > 0 and accepted_total == 0:
+                    accepted_total = max(0, completed_total - rejected_total)
+
+            completed_total = max(completed_total, accepted_total + rejected_total)
+
+            accept_now = _to_int01(st.outputs.get("accept", log_kpis.get("accept", 0)))
+            reject_now = _to_int01(st.outputs.get("reject", log_kpis.get("reject", 0)))
+            completed_now = _to_int01(st.outputs.get("completed", st.outputs.get("done", log_kpis.get("completed", 0))))
+
+            kpis_payload = {
+                "cycles_done": st.cycles_done,
+                "faults_count": st.faults_count,
+                "start_pulses": st.start_pulses,
+                "reset_pulses": st.reset_pulses,
+                "stop_asserts": st.stop_asserts,
+                "busy_total_s": round(busy_s, 3),
+                "last_cycle_ms": (st.cycle_time_ms_hist[-1] if st.cycle_time_ms_hist else None),
+                "cumulative_accepts": st.cumulative_accepts,
+                "cumulative_rejects": st.cumulative_rejects,
+                **log_kpis,
+                "accept_now": accept_now,
+                "reject_now": reject_now,
+                "completed_now": completed_now,
+                "accept": accepted_total,
+                "reject": rejected_total,
+                "completed": completed_total,
+                "accepted_total": accepted_total,
+                "rejected_total": rejected_total,
+                "completed_total": completed_total,
+            }
+
+            items.append({
+                "id": key,
+                "file": os.path.basename(file),
+                "station": station,
                 "station_raw": st.station_raw,
                 "station_num": st.station_num,
                 "state": state,
                 "updated_wall_ts": st.last_wall_ts,
                 "elapsed_s": round(elapsed_s, 2),
-                "utilization": round(util, 3),
-                "inputs": st.inputs,
-                "outputs": st.outputs,
-                "log": lines,
-                "kpis": kpis_payload,
-                "cycle_time_ms_hist": list(st.cycle_time_ms_hist),
-                "utilization_hist_pct": list(st.utilization_hist_pct),
-                "batch_id_hist": list(st.batch_id_hist),
-            })
-
-        if ENABLE_PLC_KPI_FANOUT:
-            # Optional fallback: copy PLC-prefixed KPI mirrors (sN_*) into station N.
-            # Disabled by default to avoid cross-station KPI duplication in station cards.
-            plc_item = next((x for x in items if x["station"] == "PLC"), None)
-            if plc_item:
-                plc_kpis = plc_item.get("kpis", {})
-                for k, v in plc_kpis.items():
-                    m = re.match(r"^s(\d+)_(.+)$", str(k), re.IGNORECASE)
-                    if m:
-                        target_num = int(m.group(1))
-                        suffix = m.group(2).lower()
-                        for item in items:
-                            if item.get("station_num") == target_num:
-                                item["kpis"][suffix] = v
+                "utilization": round(util, 3),
+                "inputs": st.inputs,
+                "outputs": st.outputs,
+                "log": lines,
+                "kpis": kpis_payload,
+                "cycle_time_ms_hist": list(st.cycle_time_ms_hist),
+                "utilization_hist_pct": list(st.utilization_hist_pct),
+                "batch_id_hist": list(st.batch_id_hist),
+            })
+
+        if ENABLE_PLC_KPI_FANOUT:
+            # Optional fallback: copy PLC-prefixed KPI mirrors (sN_*) into station N.
+            # Disabled by default to avoid cross-station KPI duplication in station cards.
+            plc_item = next((x for x in items if x["station"] == "PLC"), None)
+            if plc_item:
+                plc_kpis = plc_item.get("kpis", {})
+                for k, v in plc_kpis.items():
+                    m = re.match(r"^s(\d+)_(.+)$", str(k), re.IGNORECASE)
+                    if m:
+                        target_num = int(m.group(1))
+                        suffix = m.group(2).lower()
+                        for item in items:
+                            if item.get("station_num") == target_num:
+                                item["kpis"][suffix] = v
 
         cycles = {x["id"]: x["kpis"]["cycles_done"] for x in items}
         faults = {x["id"]: x["kpis"]["faults_count"] for x in items}
@@ -875,10 +888,22 @@ class StatsStore:
                 "cycles_by_station": cycles,
                 "faults_by_station": faults,
                 "util_by_station": util,
+                "bottleneck": self.bottleneck_summary(),
             }
         }
 
 
+    def bottleneck_summary(self) -> Dict[str, Any]:
+        """Line bottleneck over all files, up to the time the slowest file has reached."""
+        line = line_bottleneck.merge(self.bneck.values())
+        if line is None:
+            return {}
+        at_ns, cached = self._bneck_summary
+        if at_ns is None or not 0 <= line.last_ns - at_ns < line.refresh_ns:
+            self._bneck_summary = (line.last_ns, line.summary(force=True))
+        return self._bneck_summary[1]
+
+
 class Engine:
     def __init__(self, files: List[str], from_start: bool):
         self.q_in: "queue.Queue[tuple]" = queue.Queue()
@@ -1424,158 +1449,158 @@ function drawStepLine(canvas, values){
 let payload = __INITIAL_PAYLOAD__;
 let selectedId = "ALL";
 
-function safeText(s){ return (s===undefined || s===null) ? "" : String(s); }
-function fmt(obj){ try { return JSON.stringify(obj, null, 2); } catch(e){ return String(obj); } }
-function kpiLabel(name){
-  const key = safeText(name);
-  return KPI_LABELS[key] || key.replace(/_/g, " ");
-}
-
-const KPI_LABELS = {
-  inventory_ok: "Inventory OK",
-  any_arm_failed: "Any Arm Failed",
-  scrapped: "Scrapped",
-  reworks: "Reworks",
-  cycle_time_avg_s: "Cycle Time Avg (s)",
-  continuity_ok: "Continuity OK",
-  strain_relief_ok: "Strain Relief OK",
-  total: "Total",
-  accepted_total: "Accepted",
-  rejected_total: "Rejected",
-  completed_total: "Completed",
-  total_completed: "Total Completed",
-  accept: "Accepted",
-  reject: "Rejected",
-  last_accept: "Last Accept",
-  packages_completed: "Packages Completed",
-  arm_cycles: "Arm Cycles",
-  total_repairs: "Total Repairs",
-  availability: "Availability",
-  operational_time_s: "Operational Time (s)",
-  downtime_s: "Downtime (s)"
-};
-
-const BASE_KPI_KEYS = new Set([
-  "cycles_done",
-  "faults_count",
-  "start_pulses",
+function safeText(s){ return (s===undefined || s===null) ? "" : String(s); }
+function fmt(obj){ try { return JSON.stringify(obj, null, 2); } catch(e){ return String(obj); } }
+function kpiLabel(name){
+  const key = safeText(name);
+  return KPI_LABELS[key] || key.replace(/_/g, " ");
+}
+
+const KPI_LABELS = {
+  inventory_ok: "Inventory OK",
+  any_arm_failed: "Any Arm Failed",
+  scrapped: "Scrapped",
+  reworks: "Reworks",
+  cycle_time_avg_s: "Cycle Time Avg (s)",
+  continuity_ok: "Continuity OK",
+  strain_relief_ok: "Strain Relief OK",
+  total: "Total",
+  accepted_total: "Accepted",
+  rejected_total: "Rejected",
+  completed_total: "Completed",
+  total_completed: "Total Completed",
+  accept: "Accepted",
+  reject: "Rejected",
+  last_accept: "Last Accept",
+  packages_completed: "Packages Completed",
+  arm_cycles: "Arm Cycles",
+  total_repairs: "Total Repairs",
+  availability: "Availability",
+  operational_time_s: "Operational Time (s)",
+  downtime_s: "Downtime (s)"
+};
+
+const BASE_KPI_KEYS = new Set([
+  "cycles_done",
+  "faults_count",
+  "start_pulses",
   "reset_pulses",
   "stop_asserts",
-  "busy_total_s",
-  "last_cycle_ms"
-]);
-
-const STATION_KPI_PROFILES = {
-  1: ["total_completed", "inventory_ok", "any_arm_failed"],
-  2: ["completed_total", "scrapped", "reworks", "cycle_time_avg_s"],
-  3: ["total_completed", "continuity_ok", "strain_relief_ok"],
-  4: ["total_completed", "completed_total", "total"],
-  5: ["accepted_total", "rejected_total", "completed_total", "last_accept"],
-  6: ["total_completed", "packages_completed", "arm_cycles", "total_repairs", "availability", "operational_time_s", "downtime_s"]
-};
-
-const STATION5_FALLBACK_KEYS = ["accept", "reject", "total_completed", "last_accept"];
-
-const EXTRA_KPI_HIDE_KEYS = new Set([
-  "batch_id",
-  "recipe_id",
-  "cumulative_accepts",
-  "cumulative_rejects",
-  "accept_now",
-  "reject_now",
-  "completed_now",
-  "completed",
-  "total_completed"
-]);
-
-function hasKpiValue(v){
-  if(v === null || v === undefined) return false;
-  if(typeof v === "string") return v.trim().length > 0;
-  return true;
-}
-
-function formatKpiValue(key, value){
-  if(value === null || value === undefined) return "-";
-  if(key.endsWith("_ok") || key === "last_accept"){
-    const n = Number(value);
-    const num = Number.isFinite(n) ? Math.trunc(n) : 0;
-    return `${num} (${num === 1 ? "Yes" : "No"})`;
-  }
-  if(key === "availability"){
-    const n = Number(value);
-    if(Number.isFinite(n)){
-      const pct = (n <= 1) ? (n * 100) : n;
-      return `${Math.round(pct * 10) / 10}%`;
-    }
-  }
-  if(typeof value === "number"){
-    if(Number.isInteger(value)) return String(value);
-    return String(Math.round(value * 100) / 100);
-  }
-  return safeText(value);
-}
-
-function selectStationKpiEntries(it, k){
-  const stationNum = stationNumberOf(it);
-  const profile = STATION_KPI_PROFILES[stationNum] || [];
-  const selected = [];
-  const seen = new Set();
-
-  const resolvedProfileValue = (key) => {
-    if(key === "completed_total"){
-      if(Object.prototype.hasOwnProperty.call(k, "completed_total") && hasKpiValue(k.completed_total)) return k.completed_total;
-      if(Object.prototype.hasOwnProperty.call(k, "total_completed") && hasKpiValue(k.total_completed)) return k.total_completed;
-      if(Object.prototype.hasOwnProperty.call(k, "completed") && Number(k.completed) > 1) return k.completed;
-      if(Object.prototype.hasOwnProperty.call(k, "cycles_done") && hasKpiValue(k.cycles_done)) return k.cycles_done;
-      return undefined;
-    }
-    if(key === "total_completed"){
-      if(Object.prototype.hasOwnProperty.call(k, "total_completed") && hasKpiValue(k.total_completed)) return k.total_completed;
-      if(Object.prototype.hasOwnProperty.call(k, "completed_total") && hasKpiValue(k.completed_total)) return k.completed_total;
-      return undefined;
-    }
-    if(Object.prototype.hasOwnProperty.call(k, key)) return k[key];
-    return undefined;
-  };
-
-  profile.forEach((key) => {
-    const value = resolvedProfileValue(key);
-    if(value !== undefined && hasKpiValue(value) && !seen.has(key)){
-      selected.push([key, value]);
-      seen.add(key);
-    }
-  });
-
-  if(!selected.length && stationNum === 5){
-    STATION5_FALLBACK_KEYS.forEach((key) => {
-      if(Object.prototype.hasOwnProperty.call(k, key) && hasKpiValue(k[key]) && !seen.has(key)){
-        selected.push([key, k[key]]);
-        seen.add(key);
-      }
-    });
-  }
-
-  if(selected.length) return selected;
-
-  return Object.entries(k || {})
-    .filter(([kk, vv]) => !BASE_KPI_KEYS.has(kk))
-    .filter(([kk]) => !EXTRA_KPI_HIDE_KEYS.has(kk))
-    .filter(([kk]) => !/^s\d+_/i.test(kk))
-    .filter(([, vv]) => hasKpiValue(vv))
-    .slice(0, 4);
-}
-
-function renderExtraLogKpis(it, k){
-  const entries = selectStationKpiEntries(it, k || {});
-  if(!entries.length) return "";
-  const cards = entries.map(([kk, vv]) => {
-    return `<div class="kpi"><div class="lab">${kpiLabel(kk)}</div><div class="val">${safeText(formatKpiValue(kk, vv))}</div></div>`;
-  }).join("");
-  return `
-    <div class="sub" style="margin:4px 0 8px;">Station-Specific KPIs</div>
-    <div class="kpiGrid" style="margin-bottom:12px;">${cards}</div>
-  `;
-}
+  "busy_total_s",
+  "last_cycle_ms"
+]);
+
+const STATION_KPI_PROFILES = {
+  1: ["total_completed", "inventory_ok", "any_arm_failed"],
+  2: ["completed_total", "scrapped", "reworks", "cycle_time_avg_s"],
+  3: ["total_completed", "continuity_ok", "strain_relief_ok"],
+  4: ["total_completed", "completed_total", "total"],
+  5: ["accepted_total", "rejected_total", "completed_total", "last_accept"],
+  6: ["total_completed", "packages_completed", "arm_cycles", "total_repairs", "availability", "operational_time_s", "downtime_s"]
+};
+
+const STATION5_FALLBACK_KEYS = ["accept", "reject", "total_completed", "last_accept"];
+
+const EXTRA_KPI_HIDE_KEYS = new Set([
+  "batch_id",
+  "recipe_id",
+  "cumulative_accepts",
+  "cumulative_rejects",
+  "accept_now",
+  "reject_now",
+  "completed_now",
+  "completed",
+  "total_completed"
+]);
+
+function hasKpiValue(v){
+  if(v === null || v === undefined) return false;
+  if(typeof v === "string") return v.trim().length > 0;
+  return true;
+}
+
+function formatKpiValue(key, value){
+  if(value === null || value === undefined) return "-";
+  if(key.endsWith("_ok") || key === "last_accept"){
+    const n = Number(value);
+    const num = Number.isFinite(n) ? Math.trunc(n) : 0;
+    return `${num} (${num === 1 ? "Yes" : "No"})`;
+  }
+  if(key === "availability"){
+    const n = Number(value);
+    if(Number.isFinite(n)){
+      const pct = (n <= 1) ? (n * 100) : n;
+      return `${Math.round(pct * 10) / 10}%`;
+    }
+  }
+  if(typeof value === "number"){
+    if(Number.isInteger(value)) return String(value);
+    return String(Math.round(value * 100) / 100);
+  }
+  return safeText(value);
+}
+
+function selectStationKpiEntries(it, k){
+  const stationNum = stationNumberOf(it);
+  const profile = STATION_KPI_PROFILES[stationNum] || [];
+  const selected = [];
+  const seen = new Set();
+
+  const resolvedProfileValue = (key) => {
+    if(key === "completed_total"){
+      if(Object.prototype.hasOwnProperty.call(k, "completed_total") && hasKpiValue(k.completed_total)) return k.completed_total;
+      if(Object.prototype.hasOwnProperty.call(k, "total_completed") && hasKpiValue(k.total_completed)) return k.total_completed;
+      if(Object.prototype.hasOwnProperty.call(k, "completed") && Number(k.completed) > 1) return k.completed;
+      if(Object.prototype.hasOwnProperty.call(k, "cycles_done") && hasKpiValue(k.cycles_done)) return k.cycles_done;
+      return undefined;
+    }
+    if(key === "total_completed"){
+      if(Object.prototype.hasOwnProperty.call(k, "total_completed") && hasKpiValue(k.total_completed)) return k.total_completed;
+      if(Object.prototype.hasOwnProperty.call(k, "completed_total") && hasKpiValue(k.completed_total)) return k.completed_total;
+      return undefined;
+    }
+    if(Object.prototype.hasOwnProperty.call(k, key)) return k[key];
+    return undefined;
+  };
+
+  profile.forEach((key) => {
+    const value = resolvedProfileValue(key);
+    if(value !== undefined && hasKpiValue(value) && !seen.has(key)){
+      selected.push([key, value]);
+      seen.add(key);
+    }
+  });
+
+  if(!selected.length && stationNum === 5){
+    STATION5_FALLBACK_KEYS.forEach((key) => {
+      if(Object.prototype.hasOwnProperty.call(k, key) && hasKpiValue(k[key]) && !seen.has(key)){
+        selected.push([key, k[key]]);
+        seen.add(key);
+      }
+    });
+  }
+
+  if(selected.length) return selected;
+
+  return Object.entries(k || {})
+    .filter(([kk, vv]) => !BASE_KPI_KEYS.has(kk))
+    .filter(([kk]) => !EXTRA_KPI_HIDE_KEYS.has(kk))
+    .filter(([kk]) => !/^s\d+_/i.test(kk))
+    .filter(([, vv]) => hasKpiValue(vv))
+    .slice(0, 4);
+}
+
+function renderExtraLogKpis(it, k){
+  const entries = selectStationKpiEntries(it, k || {});
+  if(!entries.length) return "";
+  const cards = entries.map(([kk, vv]) => {
+    return `<div class="kpi"><div class="lab">${kpiLabel(kk)}</div><div class="val">${safeText(formatKpiValue(kk, vv))}</div></div>`;
+  }).join("");
+  return `
+    <div class="sub" style="margin:4px 0 8px;">Station-Specific KPIs</div>
+    <div class="kpiGrid" style="margin-bottom:12px;">${cards}</div>
+  `;
+}
 
 function stateClass(state){
   if(state==="READY") return "statePill ready";
@@ -1783,6 +1808,7 @@ function renderOverviewRight(){
       <div class="kpi"><div class="lab">Running</div><div class="val" id="k_running">-</div></div>
       <div class="kpi"><div class="lab">Faults</div><div class="val" id="k_fault">-</div></div>
       <div class="kpi"><div class="lab">Stopped</div><div class="val" id="k_stopped">-</div></div>
+      <div class="kpi"><div class="lab">Bottleneck</div><div class="val" id="k_bneck">-</div></div>
     </div>
 
     <div class="charts">
@@ -1811,6 +1837,13 @@ function renderOverviewRight(){
   const totalFaults = Object.values(faultsMap).reduce((sum, v) => sum + (Number(v) || 0), 0);
   document.getElementById("k_fault").textContent = String(totalFaults);
   document.getElementById("k_stopped").textContent = String(sc.STOPPED ?? 0);
+  const bn = s.bottleneck || {};
+  const bnWins = Object.keys(bn.windows || {}).sort((a, b) => Number(a) - Number(b));
+  const bnW = bnWins.length ? bn.windows[bnWins[0]] : null;
+  const bnEl = document.getElementById("k_bneck");
+  bnEl.textContent = bnW && bnW.primary ? `${bnW.primary} ${Math.round(100 * (bnW.primary_share || 0))}%` : "-";
+  bnEl.title = bnW ? `last ${bnW.window_s}s: sole ${Math.round(bnW.sole_pct[bnW.primary] || 0)}%, ` +
+    `shifting ${Math.round(bnW.shifting_pct[bnW.primary] || 0)}%; now ${bn.current || "-"}` : "";
 
   const stateOrder = ["READY","RUNNING","STOPPED"];
   const stateColors = {
@@ -1864,7 +1897,7 @@ function renderStationRight(it){
       <div class="kpi"><div class="lab">last cycle ms</div><div class="val">${k.last_cycle_ms ?? "-"}</div></div>
     </div>
 
-    ${renderExtraLogKpis(it, k)}
+    ${renderExtraLogKpis(it, k)}
 
     <div class="charts" style="grid-template-columns: 1fr;">
       <div>
@@ -2142,4 +2175,4 @@ def main():
 
 
 if __name__ == "__main__":
-    main()
+    main()
@@ -0,0 +1,251 @@
+# pythonGateways/log_synth.py
+"""
+Synthetic VSI log generator for the live log dashboard.
+
+Emits the same blocks the generated components print every scan:
+
+    +=ST3_ElectronicsWiring+=
+      VSI time: 12000000000 ns
+      Inputs:
+    	cmd_start = 1
+      ...
+      Outputs:
+    	ready = 0
+      ...
+
+Each station runs a small ready/busy/done/fault cycle so the dashboard's edge
+counters, utilisation and cycle-time histories see realistic traffic. More
+than six stations reuse the ST1..ST6 templates (ST7_ComponentKitting, ...).
+
+    python log_synth.py --out-dir log --stations 6 --duration 600
+    python log_synth.py --out-dir log --realtime   # one scan per step, for live tail tests
+"""
+import argparse
+import os
+import random
+import time
+
+# station template -> (output fields, nominal cycle seconds)
+TEMPLATES = [
+    ("ComponentKitting", ("ready", "busy", "fault", "done", "cycle_time_ms", "inventory_ok", "any_arm_failed",
+                          "done_time_ns"), 9.6),
+    ("FrameCoreAssembly", ("ready", "busy", "fault", "done", "cycle_time_ms", "completed", "scrapped", "reworks",
+                           "cycle_time_avg_s", "done_time_ns"), 14.0),
+    ("ElectronicsWiring", ("ready", "busy", "fault", "done", "cycle_time_ms", "strain_relief_ok", "continuity_ok",
+                           "done_time_ns"), 16.0),
+    ("CalibrationTesting", ("ready", "busy", "fault", "done", "cycle_time_ms", "total", "completed",
+                            "done_time_ns"), 41.0),
+    ("QualityInspection", ("ready", "busy", "fault", "done", "cycle_time_ms", "accept", "reject", "last_accept",
+                           "done_time_ns"), 2.5),
+    ("PackagingDispatch", ("ready", "busy", "fault", "done", "cycle_time_ms", "packages_completed", "arm_cycles",
+                           "total_repairs", "operational_time_s", "downtime_s", "availability", "done_time_ns"), 12.0),
+]
+
+FAULT_PROB = 0.002        # per completed cycle
+FAULT_SCANS = 3           # scans a fault stays latched before the PLC resets it
+
+
+def station_name(idx):
+    """1-based station index -> component name, e.g. 3 -> ST3_ElectronicsWiring."""
+    return f"ST{idx}_{TEMPLATES[(idx - 1) % len(TEMPLATES)][0]}"
+
+
+class _Station:
+    def __init__(self, idx, rng):
+        self.idx = idx
+        self.name = station_name(idx)
+        _, self.fields, self.cycle_s = TEMPLATES[(idx - 1) % len(TEMPLATES)]
+        self.rng = rng
+        self.busy_left_ns = 0
+        self.fault_left = 0
+        self.cmd_start = 0
+        self.batch_id = 0
+        self.done = 0
+        self.cycle_time_ms = 0
+        self.done_time_ns = 0
+        self.cycles = 0
+        self.accepts = 0
+        self.rejects = 0
+        self.last_accept = 0
+        self.busy_ns = 0
+        self.elapsed_ns = 0
+
+    def step(self, step_ns):
+        self.elapsed_ns += step_ns
+        self.done = 0
+        self.cmd_start = 0
+        if self.fault_left:
+            self.fault_left -= 1
+            return
+        if self.busy_left_ns > 0:
+            self.busy_ns += step_ns
+            self.busy_left_ns -= step_ns
+            if self.busy_left_ns <= 0:
+                self.done = 1
+                self.done_time_ns = self.elapsed_ns + self.busy_left_ns
+                self.cycles += 1
+                if "accept" in self.fields:
+                    # running totals, as ST5 publishes them
+                    self.last_accept = 0 if self.rng.random() < 0.1 else 1
+                    self.accepts += self.last_accept
+                    self.rejects += 1 - self.last_accept
+                if self.rng.random() < FAULT_PROB:
+                    self.fault_left = FAULT_SCANS
+            return
+        # idle: the PLC starts the next unit with some slack
+        if self.rng.random() < 0.5:
+            self.cmd_start = 1
+            self.batch_id += 1
+            cycle_s = self.cycle_s * self.rng.uniform(0.85, 1.25)
+            self.cycle_time_ms = int(cycle_s * 1000.0)
+            self.busy_left_ns = int(cycle_s * 1e9)
+
+    def outputs(self):
+        busy = 1 if self.busy_left_ns > 0 else 0
+        fault = 1 if self.fault_left else 0
+        out = {}
+        for f in self.fields:
+            if f == "ready":
+                v = 1 if (not busy and not fault) else 0
+            elif f == "busy":
+                v = busy
+            elif f == "fault":
+                v = fault
+            elif f == "done":
+                v = self.done
+            elif f == "cycle_time_ms":
+                v = self.cycle_time_ms
+            elif f == "done_time_ns":
+                v = self.done_time_ns
+            elif f in ("completed", "total", "packages_completed", "arm_cycles"):
+                v = self.cycles
+            elif f == "accept":
+                v = self.accepts
+            elif f in ("reject", "scrapped"):
+                v = self.rejects
+            elif f == "last_accept":
+                v = self.last_accept
+            elif f == "cycle_time_avg_s":
+                v = round(self.cycle_s, 3)
+            elif f == "operational_time_s":
+                v = self.busy_ns // 1_000_000_000
+            elif f == "downtime_s":
+                v = (self.elapsed_ns - self.busy_ns) // 1_000_000_000
+            elif f == "availability":
+                v = int(100 * self.busy_ns / self.elapsed_ns) if self.elapsed_ns else 0
+            else:
+                v = 1 if f.endswith("_ok") else 0
+            out[f] = v
+        return out
+
+    def inputs(self):
+        return {"cmd_start": self.cmd_start, "cmd_stop": 0, "cmd_reset": 1 if self.fault_left == 1 else 0,
+                "batch_id": self.batch_id, "recipe_id": 1}
+
+
+class LogSynth:
+    """
+    Generates one block per component per simulation step.
+
+    blocks() returns (component_name, lines) in scan order: PLC first (if
+    enabled), then ST1..STn, each block ending with the blank line that
+    flushes BlockParser.
+    """
+
+    def __init__(self, stations=6, step_ms=1000, seed=1, plc=True, rx_lines=True):
+        self.step_ns = int(step_ms * 1_000_000)
+        self.now_ns = 0
+        self.plc = bool(plc)
+        self.rx_lines = bool(rx_lines)
+        self.stations = [_Station(i, random.Random(f"{seed}:{i}")) for i in range(1, int(stations) + 1)]
+
+    @property
+    def components(self):
+        names = [s.name for s in self.stations]
+        return (["PLC_LineCoordinator"] + names) if self.plc else names
+
+    def step(self):
+        self.now_ns += self.step_ns
+        for s in self.stations:
+            s.step(self.step_ns)
+
+    @staticmethod
+    def _block(name, vsi_ns, inputs, outputs, rx_from=()):
+        lines = [f"Received packet from {src}" for src in rx_from]
+        lines.append("")
+        lines.append(f"+={name}+=")
+        lines.append(f"  VSI time: {vsi_ns} ns")
+        lines.append("  Inputs:")
+        lines.extend(f"\t{k} = {v}" for k, v in inputs.items())
+        lines.append("  Outputs:")
+        lines.extend(f"\t{k} = {v}" for k, v in outputs.items())
+        lines.append("")
+        return lines
+
+    def blocks(self):
+        """One scan's worth of blocks: list of (component_name, lines)."""
+        self.step()
+        out = []
+        st_out = [(s, s.outputs(), s.inputs()) for s in self.stations]
+        if self.plc:
+            plc_in = {}
+            plc_cmd = {}
+            for s, o, i in st_out:
+                for k, v in o.items():
+                    plc_in[f"S{s.idx}_{k}"] = v
+                for k, v in i.items():
+                    plc_cmd[f"S{s.idx}_{k}"] = v
+            rx = [s.name for s in self.stations] if self.rx_lines else ()
+            out.append(("PLC_LineCoordinator", self._block("PLC_LineCoordinator", self.now_ns, plc_in, plc_cmd, rx)))
+        for s, o, i in st_out:
+            rx = ("PLC_LineCoordinator",) if self.rx_lines else ()
+            out.append((s.name, self._block(s.name, self.now_ns, i, o, rx)))
+        return out
+
+
+def log_path(out_dir, component):
+    return os.path.join(out_dir, f"check.{component}.log")
+
+
+def write_logs(out_dir, duration_s, stations=6, step_ms=1000, seed=1, rate=None, plc=True):
+    """
+    Write check.<component>.log files covering duration_s of simulated time.
+    rate = scans per wall second (None -> as fast as possible; use with the
+    dashboard tailing the files to watch it keep up or lag).
+    """
+    os.makedirs(out_dir, exist_ok=True)
+    synth = LogSynth(stations=stations, step_ms=step_ms, seed=seed, plc=plc)
+    files = {c: open(log_path(out_dir, c), "w", encoding="utf-8") for c in synth.components}
+    scans = int(duration_s * 1000 / step_ms)
+    t0 = time.perf_counter()
+    try:
+        for k in range(scans):
+            for comp, lines in synth.blocks():
+                files[comp].write("\n".join(lines) + "\n")
+            if rate:
+                for f in files.values():
+                    f.flush()
+                delay = t0 + (k + 1) / float(rate) - time.perf_counter()
+                if delay > 0:
+                    time.sleep(delay)
+    finally:
+        for f in files.values():
+            f.close()
+    return [log_path(out_dir, c) for c in synth.components]
+
+
+if __name__ == "__main__":
+    ap = argparse.ArgumentParser(description="Write synthetic VSI station logs")
+    ap.add_argument("--out-dir", default="log")
+    ap.add_argument("--stations", type=int, default=6)
+    ap.add_argument("--duration", type=float, default=600.0, help="simulated seconds")
+    ap.add_argument("--step-ms", type=float, default=1000.0)
+    ap.add_argument("--seed", type=int, default=1)
+    ap.add_argument("--rate", type=float, default=None, help="scans per wall second (default: unthrottled)")
+    ap.add_argument("--realtime", action="store_true", help="shorthand for --rate 1000/step-ms")
+    ap.add_argument("--no-plc", action="store_true")
+    a = ap.parse_args()
+    rate = a.rate if a.rate else (1000.0 / a.step_ms if a.realtime else None)
+    paths = write_logs(a.out_dir, a.duration, a.stations, a.step_ms, a.seed, rate, plc=not a.no_plc)
+    for p in paths:
+        print(p)
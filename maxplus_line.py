@@ -0,0 +1,287 @@
+# pythonGateways/maxplus_line.py
+"""
+Max-plus engine for the serial line: departure times of n units through
+S1..S6, evaluated in numpy, under one of two controllers:
+
+    serial      what PLC_LineCoordinator runs: one unit in the line at a
+                time, every station start waits for the previous station's
+                done plus the PLC's hand-off (SERIAL_HANDOFF_S, measured on
+                headless runs at the default 2 s step). Comparable with
+                recorded runs; buffer capacities have no effect.
+    pipelined   an idealised line that keeps every station busy, with finite
+                buffers (blocking after service). It is what a pipelining
+                controller could reach, about three times the serial rate,
+                and not comparable with recorded runs. Buffer caps and
+                allocate() only mean something here.
+
+Serial times are a running sum over the stations of every unit in turn.
+In the pipelined line, for unit j at station i with processing time p and
+buffer capacity b between i and i+1:
+
+    S[i][j] = max(D[i-1][j], D[i][j-1])            start: unit arrived, station free
+    D[i][j] = max(S[i][j] + p[i][j], D[i+1][j-b-1]) leave: room downstream
+
+The recursion is max-plus linear in a small state (each station's last
+departures, as far back as its upstream buffer reaches). The units are cut
+into chunks; one pass runs all chunks side by side with every time kept as
+a max-plus vector over the chunk's start state, a short sequential pass
+chains the chunk states, and a second side-by-side pass fills in every
+unit. The result is exact, and 10^6 units take about a second.
+
+    p = sample_times(1_000_000, seed=1, handoff_s=SERIAL_HANDOFF_S)
+    r = evaluate(p)                                # serial: throughput, lead time, shares per station
+    q = sample_times(1_000_000, seed=1)
+    r = evaluate(q, caps={"S3_to_S4": 3}, controller="pipelined")
+    best = allocate(12, q)                         # greedy buffer allocation (pipelined), 12 slots
+
+    python maxplus_line.py --n 1000000
+    python maxplus_line.py --n 1000000 --controller pipelined --caps S3_to_S4=3,S4_to_S5=1
+    python maxplus_line.py --n 200000 --allocate 10
+
+As in the PLC, every unit visits all stations (scrapped and rejected units
+included) and a unit whose station faults is run again after fault_recovery_s.
+PLC scan and hand-off delays are not modelled beyond a fixed handoff_s per
+start; confirm candidates with headless_line / doe.py.
+"""
+import argparse
+import json
+import sys
+import time
+
+import numpy as np
+
+import headless_line
+import mc_kernels
+
+STATIONS = ["S1", "S2", "S3", "S4", "S5", "S6"]
+BUFFERS = ["S1_to_S2", "S2_to_S3", "S3_to_S4", "S4_to_S5", "S5_to_S6"]
+CONTROLLERS = ("serial", "pipelined")
+
+# Mean gap from a station's done to the next station's start under the PLC,
+# 2 s step: about 2.5 scans (done seen, START pulse, station latch)
+SERIAL_HANDOFF_S = 5.4
+
+
+def default_caps():
+    """Pipelined buffer capacities when none are given: the PLC's BUF_MAX for every buffer."""
+    plc = headless_line.import_component("PLC_LineCoordinator")
+    return {b: plc.BUF_MAX for b in BUFFERS}
+
+
+def _caps_list(caps):
+    if caps is None or isinstance(caps, dict):
+        full = default_caps()
+        full.update({b: v for b, v in (caps or {}).items() if v is not None})
+        return [max(0, int(full[b])) for b in BUFFERS]
+    return [max(0, int(c)) for c in caps]
+
+
+def sample_times(n, recipe_id=0, seed=None, params=None, fault_recovery_s=0.0, handoff_s=0.0):
+    """
+    Processing times (stations x n) plus a per-unit good mask, from mc_kernels.
+    A faulted attempt is followed by fault_recovery_s and one fresh attempt.
+    """
+    rng = np.random.default_rng(seed)
+    line = mc_kernels.sample_line(n, recipe_id, rng, params=params)
+    p = np.empty((len(STATIONS), int(n)))
+    good = np.ones(int(n), dtype=bool)
+    per_station = mc_kernels._split_params(params)
+    for i, st in enumerate(STATIONS):
+        s = line[st]
+        p[i] = s["cycle_s"] + float(handoff_s)
+        fault = s["fault"]
+        k = int(fault.sum())
+        if k:
+            again = mc_kernels.sample_station(st, k, recipe_id, rng, params=per_station.get(st))
+            p[i, fault] += float(fault_recovery_s) + again["cycle_s"] + float(handoff_s)
+        good &= s["ok"] | fault
+    return {"p": p, "good": good}
+
+
+def serial_departures(p):
+    """Start/departure times (stations x n) with one unit in the line at a time. Returns (S, D)."""
+    p = np.asarray(p, dtype=float)
+    D = np.cumsum(p.T.ravel()).reshape(p.shape[1], p.shape[0]).T
+    return D - p, D
+
+
+def departures(p, caps, chunk=None):
+    """
+    Exact start/departure times (stations x n) of the pipelined line for
+    processing times p and buffer capacities caps (one per buffer).
+    Returns (S, D).
+    """
+    p = np.asarray(p, dtype=float)
+    m, n = p.shape
+    caps = _caps_list(caps)
+    L = int(chunk or max(16, int(np.sqrt(n))))
+    C = -(-n // L)
+    # pad with zero-time units at the end; later units never affect earlier ones
+    pc = np.zeros((m, C * L))
+    pc[:, :n] = p
+    pc = pc.reshape(m, C, L)
+
+    # chunk state: D[i] of the last H[i] units (own previous unit, and the unit
+    # station i-1 waits on when blocked), plus slot 0 = the constant 0
+    H = [1] + [caps[i - 1] + 1 for i in range(1, m)]
+    off = np.cumsum([1] + H[:-1]).tolist()
+    d = 1 + sum(H)
+
+    def unit(k):
+        v = np.full((C, d), -np.inf)
+        v[:, k] = 0.0
+        return v
+
+    # pass 1: every chunk at once, D as max-plus linear in the chunk's start state
+    hist = [[unit(off[i] + r - 1) for r in range(H[i], 0, -1)] for i in range(m)]
+    zero = unit(0)
+    for j in range(L):
+        for i in range(m):
+            a = hist[i - 1][-1] if i > 0 else zero
+            u = np.maximum(a, hist[i][-1])
+            u += pc[i, :, j][:, None]
+            if i < m - 1:
+                np.maximum(u, hist[i + 1][0], out=u)
+            hist[i].append(u)
+            del hist[i][0]
+    F = np.empty((C, d, d))
+    F[:, 0] = unit(0)
+    for i in range(m):
+        for r in range(1, H[i] + 1):
+            F[:, off[i] + r - 1] = hist[i][-r]
+
+    # pass 2: chain the chunks
+    X0 = np.full((C, d), -np.inf)
+    X0[0, 0] = 0.0
+    for c in range(C - 1):
+        X0[c + 1] = (F[c] + X0[c][None, :]).max(axis=1)
+
+    # pass 3: numeric rerun of every chunk from its start state
+    S = np.empty((m, C, L))
+    D = np.empty((m, C, L))
+    hist = [[X0[:, off[i] + r - 1] for r in range(H[i], 0, -1)] for i in range(m)]
+    for j in range(L):
+        for i in range(m):
+            a = D[i - 1, :, j] if i > 0 else 0.0
+            s = np.maximum(a, hist[i][-1])
+            S[i, :, j] = s
+            u = s + pc[i, :, j]
+            if i < m - 1:
+                np.maximum(u, hist[i + 1][0], out=u)
+            D[i, :, j] = u
+            hist[i].append(D[i, :, j])
+            del hist[i][0]
+    return S.reshape(m, -1)[:, :n], D.reshape(m, -1)[:, :n]
+
+
+def evaluate(times, caps=None, warmup=0.05, controller="serial"):
+    """Throughput, WIP, lead time and per-station shares under controller (caps: pipelined only)."""
+    if controller not in CONTROLLERS:
+        raise ValueError(f"unknown controller {controller!r} (one of {', '.join(CONTROLLERS)})")
+    p = times["p"] if isinstance(times, dict) else np.asarray(times, dtype=float)
+    good = times.get("good") if isinstance(times, dict) else None
+    caps_l = _caps_list(caps) if controller == "pipelined" else None
+    t0 = time.perf_counter()
+    S, D = departures(p, caps_l) if caps_l is not None else serial_departures(p)
+    m, n = p.shape
+    w = min(max(0, int(n * float(warmup))), n - 2)
+    out_t = D[-1]
+    span = float(out_t[-1] - out_t[w])
+    units = n - 1 - w
+    tph = 3600.0 * units / span if span > 0 else 0.0
+    lead = D[-1, w:] - S[0, w:]
+    C = S + p
+    prev_d = np.concatenate((S[:, :1], D[:, :-1]), axis=1)   # unit 0 never waits for a predecessor
+    stations = {}
+    for i, st in enumerate(STATIONS):
+        stations[st] = {
+            "utilization_pct": 100.0 * float(p[i, w + 1:].sum()) / span if span > 0 else 0.0,
+            "blocked_pct": 100.0 * float((D[i, w + 1:] - C[i, w + 1:]).sum()) / span if span > 0 else 0.0,
+            "starved_pct": 100.0 * float((S[i, w + 1:] - prev_d[i, w + 1:]).sum()) / span if span > 0 else 0.0,
+        }
+    yield_ = float(good[w:].mean()) if good is not None else 1.0
+    return {
+        "n": n,
+        "controller": controller,
+        "caps": dict(zip(BUFFERS, caps_l)) if caps_l is not None else None,
+        "throughput_per_hour": tph,
+        "good_per_hour": tph * yield_,
+        "yield": yield_,
+        "lead_time_s": {"mean": float(lead.mean()), "p50": float(np.percentile(lead, 50)),
+                        "p90": float(np.percentile(lead, 90))},
+        # Little's law over the measured window
+        "wip": tph / 3600.0 * float(lead.mean()),
+        "stations": stations,
+        "bottleneck": max(STATIONS, key=lambda st: stations[st]["utilization_pct"]),
+        "elapsed_s": time.perf_counter() - t0,
+    }
+
+
+def allocate(total_slots, times, start=None, warmup=0.05):
+    """
+    Greedy buffer allocation on the pipelined line: from start (default
+    all 0), add one slot at a time where it raises throughput most, until
+    total_slots are placed.
+    """
+    caps = list(_caps_list(start)) if start is not None else [0] * len(BUFFERS)
+    best = evaluate(times, caps, warmup, "pipelined")
+    trail = [(list(caps), best["throughput_per_hour"])]
+    while sum(caps) < int(total_slots):
+        cand = None
+        for k in range(len(BUFFERS)):
+            trial = list(caps)
+            trial[k] += 1
+            r = evaluate(times, trial, warmup, "pipelined")
+            if cand is None or r["throughput_per_hour"] > cand[1]["throughput_per_hour"]:
+                cand = (trial, r)
+        caps, best = cand
+        trail.append((list(caps), best["throughput_per_hour"]))
+    best["trail"] = [{"caps": dict(zip(BUFFERS, c)), "throughput_per_hour": t} for c, t in trail]
+    return best
+
+
+def _parse_caps(text):
+    caps = {}
+    for item in (text or "").split(","):
+        if item.strip():
+            name, _, value = item.partition("=")
+            caps[name.strip()] = int(value)
+    return caps
+
+
+def main(argv=None):
+    ap = argparse.ArgumentParser(description="Max-plus throughput estimate for the S1..S6 line")
+    ap.add_argument("--n", type=int, default=1_000_000)
+    ap.add_argument("--recipe", type=int, default=0)
+    ap.add_argument("--seed", type=int, default=None)
+    ap.add_argument("--controller", choices=CONTROLLERS, default="serial",
+                    help="serial: the PLC as it runs; pipelined: idealised line with buffers")
+    ap.add_argument("--caps", default="", help="pipelined only, e.g. S3_to_S4=3,S4_to_S5=1 (others BUF_MAX)")
+    ap.add_argument("--set", action="append", default=[], metavar="CONST=VALUE",
+                    help="override a station module constant (see mc_kernels)")
+    ap.add_argument("--handoff-s", type=float, default=None,
+                    help=f"fixed delay added to every station start (default {SERIAL_HANDOFF_S} serial, 0 pipelined)")
+    ap.add_argument("--fault-recovery-s", type=float, default=0.0)
+    ap.add_argument("--warmup", type=float, default=0.05, help="fraction of units left out of the estimates")
+    ap.add_argument("--allocate", type=int, default=None, metavar="SLOTS",
+                    help="greedy search for the best split of SLOTS buffer places")
+    a = ap.parse_args(argv)
+
+    params = {}
+    for item in a.set:
+        name, _, value = item.partition("=")
+        params[name.strip()] = mc_kernels._parse_value(value.strip())
+
+    serial = a.controller == "serial" and a.allocate is None
+    handoff_s = a.handoff_s if a.handoff_s is not None else (SERIAL_HANDOFF_S if serial else 0.0)
+    times = sample_times(a.n, a.recipe, a.seed, params, a.fault_recovery_s, handoff_s)
+    if a.allocate is not None:
+        res = allocate(a.allocate, times, warmup=a.warmup)
+    else:
+        res = evaluate(times, _parse_caps(a.caps), a.warmup, a.controller)
+    print(json.dumps(res, indent=2))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
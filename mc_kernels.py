@@ -0,0 +1,234 @@
+# pythonGateways/mc_kernels.py
+"""
+Vectorised Monte Carlo samplers for the station models.
+
+Each sampler draws n independent units through one station in a single
+numpy call and returns per-unit arrays, using the constants of the station
+module itself (imported headless), so a change to e.g. ST2_P_SCRAP in
+ST2_FrameCoreAssembly.py shows up here without editing this file.
+
+    s = sample_station("S2", 1_000_000, recipe_id=1, params={"ST2_BASE_TIME_RECIPE1_S": 14.0})
+    summarize(s)     # cycle mean/p50/p90, yield, rework and fault rates, good units/h
+    line = sample_line(100_000, seed=1)      # {"S1": samples, ..., "S6": samples}
+
+    python mc_kernels.py S2 --n 1000000 --recipe 1 --set ST2_BASE_TIME_RECIPE1_S=14
+    python mc_kernels.py all --n 200000
+
+Every sample dict has float64 "cycle_s" and bool "ok" (unit leaves the
+station good), "rework" (went through the station's rework/retry path)
+and "fault" (station latches a fault and needs a PLC reset). ST6 adds
+"repairs" and "refill" per unit.
+
+A unit is sampled in isolation: queueing, blocking and PLC hand-off delays
+are not modelled here (see headless_line for the full line). ST6 stock
+refills depend on the unit index since reset; pass first_unit to start
+the sequence elsewhere.
+"""
+import argparse
+import contextlib
+import json
+import sys
+
+import numpy as np
+
+import headless_line
+
+STATION_MODULES = {
+    "S1": "ST1_ComponentKitting",
+    "S2": "ST2_FrameCoreAssembly",
+    "S3": "ST3_ElectronicsWiring",
+    "S4": "ST4_CalibrationTesting",
+    "S5": "ST5_QualityInspection",
+    "S6": "ST6_PackagingDispatch",
+}
+
+
+def _module(st):
+    return headless_line.import_component(STATION_MODULES[st])
+
+
+@contextlib.contextmanager
+def _constants(st, params):
+    """Station module with params patched over its constants for the duration."""
+    mod = _module(st)
+    saved = {}
+    try:
+        for name, value in (params or {}).items():
+            if not hasattr(mod, name):
+                raise KeyError(f"{STATION_MODULES[st]} has no constant {name}")
+            saved[name] = getattr(mod, name)
+            setattr(mod, name, value)
+        yield mod
+    finally:
+        for name, value in saved.items():
+            setattr(mod, name, value)
+
+
+def _rng(rng=None, seed=None):
+    if isinstance(rng, np.random.Generator):
+        return rng
+    return np.random.default_rng(seed)
+
+
+def _result(cycle_s, ok, rework, fault, **extra):
+    out = {"cycle_s": cycle_s, "ok": ok, "rework": rework, "fault": fault}
+    out.update(extra)
+    return out
+
+
+# ---------------- per station ----------------
+def _st1(m, n, recipe_id, rng, first_unit):
+    none = np.zeros(n, dtype=bool)
+    return _result(np.full(n, float(m.ST1_NOMINAL_CYCLE_S)), ~none, none, none.copy())
+
+
+def _st2(m, n, recipe_id, rng, first_unit):
+    base = m.ST2_BASE_TIME_RECIPE1_S if int(recipe_id) == 1 else m.ST2_BASE_TIME_S
+    jitter = 1.0 + rng.uniform(-m.ST2_JITTER, m.ST2_JITTER, n)
+    cycle = np.maximum(m.ST2_MIN_CYCLE_S, base * jitter)
+    r = rng.random(n)
+    scrap = r < m.ST2_P_SCRAP
+    rework = ~scrap & (r < m.ST2_P_SCRAP + m.ST2_P_REWORK)
+    return _result(cycle, ~scrap, rework, np.zeros(n, dtype=bool))
+
+
+def _st3(m, n, recipe_id, rng, first_unit):
+    cycle = np.full(n, float(m.T_MOUNT_PSU_S + m.T_MOUNT_BOARD_S + m.T_MOUNT_SCREEN_S
+                             + m.T_ROUTE_CABLES_S + m.T_STRAIN_RELIEF_S + m.T_CONTINUITY_TEST_S))
+    first_ok = (rng.random(n) <= m.P_STRAIN_OK) & (rng.random(n) <= m.P_CONTINUITY_OK)
+    rework = ~first_ok
+    cycle[rework] += m.T_REWORK_S + m.T_CONTINUITY_TEST_S
+    retest_ok = ((rng.random(n) <= min(m.P_STRAIN_REWORK_CAP, m.P_STRAIN_OK + m.P_STRAIN_REWORK_GAIN))
+                 & (rng.random(n) <= min(m.P_CONTINUITY_REWORK_CAP, m.P_CONTINUITY_OK + m.P_CONTINUITY_REWORK_GAIN)))
+    fault = rework & ~retest_ok
+    return _result(cycle, ~fault, rework, fault)
+
+
+def _st4(m, n, recipe_id, rng, first_unit):
+    cycle = np.full(n, float(m.T_MOTION_S + m.T_THERMAL_S + m.T_CALIBRATION_S + m.T_TESTPRINT_S))
+    retry = ~(rng.random(n) <= m.P_PASS)
+    cycle[retry] += m.T_RETRY_S
+    fault = retry & ~(rng.random(n) <= m.P_PASS_AFTER_RETRY)
+    return _result(cycle, ~fault, retry, fault)
+
+
+def _st5(m, n, recipe_id, rng, first_unit):
+    fault = rng.random(n) < m.ST5_P_FAULT
+    cycle = np.full(n, float(m.ST5_T_CAPTURE_S + m.ST5_T_COMPUTE_S + m.ST5_T_COMPARE_S + m.ST5_T_DIVERT_S))
+    cycle[fault] = m.ST5_T_FAULT_S
+    p_accept = m._st5_accept_rate(recipe_id)
+    recheck = ~fault & ~(rng.random(n) < p_accept)
+    cycle[recheck] += m.ST5_T_WIPE_S + m.ST5_T_RECOMPUTE_S
+    recovered = rng.random(n) < min(m.ST5_RECHECK_CAP, p_accept + m.ST5_RECHECK_GAIN)
+    ok = ~fault & (~recheck | recovered)
+    return _result(cycle, ok, recheck, fault)
+
+
+def _st6(m, n, recipe_id, rng, first_unit):
+    cycle = np.zeros(n)
+    repairs = np.zeros(n, dtype=np.int64)
+    for p_fault, repair_s, operate_s in m.ST6_STEPS.values():
+        hit = rng.random(n) < p_fault
+        cycle += operate_s + hit * repair_s
+        repairs += hit
+    # every material runs out after ST6_STOCK_INITIAL units, then every ST6_STOCK_REFILL
+    idx = np.arange(int(first_unit), int(first_unit) + n)
+    since = idx - int(m.ST6_STOCK_INITIAL)
+    refill = (since >= 0) & (since % int(m.ST6_STOCK_REFILL) == 0)
+    cycle[refill] += sum(m.ST6_REFILL_S.values())
+    none = np.zeros(n, dtype=bool)
+    return _result(cycle, ~none, none, none.copy(), repairs=repairs, refill=refill)
+
+
+_SAMPLERS = {"S1": _st1, "S2": _st2, "S3": _st3, "S4": _st4, "S5": _st5, "S6": _st6}
+
+
+# ---------------- public API ----------------
+def sample_station(st, n, recipe_id=0, rng=None, seed=None, params=None, first_unit=0):
+    """n units through station st ("S1".."S6"); params overrides module constants."""
+    st = st.upper()
+    if st not in _SAMPLERS:
+        raise KeyError(f"unknown station {st}")
+    n = int(n)
+    with _constants(st, params) as mod:
+        return _SAMPLERS[st](mod, n, recipe_id, _rng(rng, seed), first_unit)
+
+
+def _split_params(params):
+    """Flat {CONSTANT: value} -> {station: {CONSTANT: value}} by the module that owns it."""
+    out = {}
+    for name, value in (params or {}).items():
+        owners = [st for st in STATION_MODULES if hasattr(_module(st), name)]
+        if not owners:
+            raise KeyError(f"no station module has a constant {name}")
+        for st in owners:
+            out.setdefault(st, {})[name] = value
+    return out
+
+
+def sample_line(n, recipe_id=0, rng=None, seed=None, params=None, first_unit=0):
+    """n units through each station, one shared RNG: {station: samples}."""
+    rng = _rng(rng, seed)
+    per_station = _split_params(params)
+    return {st: sample_station(st, n, recipe_id, rng, params=per_station.get(st), first_unit=first_unit)
+            for st in _SAMPLERS}
+
+
+def summarize(s):
+    cycle = s["cycle_s"]
+    n = int(cycle.size)
+    if n == 0:
+        return {"n": 0}
+    mean = float(cycle.mean())
+    yield_ = float(s["ok"].mean())
+    p50, p90, p99 = (float(v) for v in np.percentile(cycle, (50, 90, 99)))
+    out = {
+        "n": n,
+        "cycle_mean_s": mean,
+        "cycle_std_s": float(cycle.std()),
+        "cycle_p50_s": p50,
+        "cycle_p90_s": p90,
+        "cycle_p99_s": p99,
+        "yield": yield_,
+        "rework_rate": float(s["rework"].mean()),
+        "fault_rate": float(s["fault"].mean()),
+        # station running flat out, one unit at a time
+        "good_per_hour": 3600.0 * yield_ / mean if mean > 0 else 0.0,
+    }
+    if "repairs" in s:
+        out["repairs_per_unit"] = float(s["repairs"].mean())
+    return out
+
+
+def _parse_value(text):
+    try:
+        return json.loads(text)
+    except ValueError:
+        return text
+
+
+def main(argv=None):
+    ap = argparse.ArgumentParser(description="Monte Carlo station cycle-time and yield estimates")
+    ap.add_argument("station", help="S1..S6 or 'all'")
+    ap.add_argument("--n", type=int, default=1_000_000)
+    ap.add_argument("--recipe", type=int, default=0)
+    ap.add_argument("--seed", type=int, default=None)
+    ap.add_argument("--set", action="append", default=[], metavar="CONST=VALUE",
+                    help="override a station module constant, e.g. ST2_P_SCRAP=0.03")
+    a = ap.parse_args(argv)
+
+    params = {}
+    for item in a.set:
+        name, _, value = item.partition("=")
+        params[name.strip()] = _parse_value(value.strip())
+
+    if a.station.lower() == "all":
+        res = {st: summarize(s) for st, s in sample_line(a.n, a.recipe, seed=a.seed, params=params).items()}
+    else:
+        res = summarize(sample_station(a.station, a.n, a.recipe, seed=a.seed, params=params))
+    print(json.dumps(res, indent=2))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,345 @@
+# pythonGateways/metrics_exporter.py
+"""
+OpenMetrics (Prometheus text) exporter for the PLC line coordinator.
+
+The PLC calls observe_scan() once per scan; a background HTTP thread serves
+the latest values on /metrics so long runs can be scraped and graphed with
+standard tooling instead of parsing stdout or kpi_latest.json.
+"""
+import sys
+import threading
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+# ----------------------------
+# Config
+# ----------------------------
+METRICS_HOST = "127.0.0.1"
+METRICS_PORT = 9108
+
+CONTENT_TYPE = "application/openmetrics-text; version=1.0.0; charset=utf-8"
+
+# Wall time of one full PLC scan (includes the advanceSimulation barrier)
+SCAN_BUCKETS_S = (0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1.0, 2.5)
+
+# Station cycle times (ST1 ~9.6 s ... ST4 ~41 s plus retries)
+CYCLE_BUCKETS_MS = (2000, 5000, 8000, 10000, 12000, 14000, 16000, 18000, 20000,
+                    25000, 30000, 40000, 45000, 50000, 60000, 90000, 120000)
+
+
+# ----------------------------
+# Metric primitives
+# ----------------------------
+class Histogram:
+    """Fixed-bucket cumulative histogram (OpenMetrics semantics)."""
+
+    def __init__(self, buckets):
+        self.bounds = tuple(float(b) for b in buckets)
+        self.counts = [0] * (len(self.bounds) + 1)  # last slot is +Inf
+        self.sum = 0.0
+        self.count = 0
+
+    def observe(self, v):
+        v = float(v)
+        i = 0
+        n = len(self.bounds)
+        while i < n and v > self.bounds[i]:
+            i += 1
+        self.counts[i] += 1
+        self.sum += v
+        self.count += 1
+
+    def render(self, name, labels=""):
+        out = []
+        cum = 0
+        sep = "," if labels else ""
+        for b, c in zip(self.bounds, self.counts):
+            cum += c
+            out.append(f'{name}_bucket{{{labels}{sep}le="{_fmt(b)}"}} {cum}')
+        cum += self.counts[-1]
+        out.append(f'{name}_bucket{{{labels}{sep}le="+Inf"}} {cum}')
+        lb = f"{{{labels}}}" if labels else ""
+        out.append(f"{name}_count{lb} {self.count}")
+        out.append(f"{name}_sum{lb} {_fmt(self.sum)}")
+        return out
+
+
+def _fmt(v):
+    if isinstance(v, bool):
+        return "1" if v else "0"
+    if isinstance(v, int):
+        return str(v)
+    v = float(v)
+    if v == int(v) and abs(v) < 1e15:
+        return str(int(v)) + ".0"
+    return repr(v)
+
+
+def _esc(s):
+    return str(s).replace("\\", "\\\\").replace("\n", "\\n").replace('"', '\\"')
+
+
+# ----------------------------
+# Exporter state (module globals, lock-protected like opt_dashboard)
+# ----------------------------
+_lock = threading.Lock()
+_scans_total = 0
+_scan_hist = Histogram(SCAN_BUCKETS_S)
+_cycle_hist = {}
+_prev_done = {}
+_done_total = {}
+_last_scan_wall = None
+_snapshot = {}
+_started_at = time.time()
+
+# Optional extra renderers (e.g. scan_profiler); each returns a list of lines
+_collectors = []
+_collector_errors = 0
+
+_srv_thread = None
+_srv_started = False
+
+
+def register_collector(fn):
+    with _lock:
+        if fn not in _collectors:
+            _collectors.append(fn)
+
+
+def observe_scan(plc, ms, stations, snap=None):
+    """Record one PLC scan. Call once per scan after the TX block."""
+    global _scans_total, _last_scan_wall, _snapshot
+
+    now = time.perf_counter()
+    if snap is None:
+        import opt_dashboard
+        snap = opt_dashboard.build_kpi_snapshot(plc, ms, stations)
+
+    with _lock:
+        _scans_total += 1
+        if _last_scan_wall is not None:
+            _scan_hist.observe(now - _last_scan_wall)
+        _last_scan_wall = now
+
+        for st in stations:
+            done = bool(getattr(ms, f"{st}_done", 0))
+            # cycle_time_ms is valid on the done rising edge
+            if done and not _prev_done.get(st, False):
+                ct = int(getattr(ms, f"{st}_cycle_time_ms", 0) or 0)
+                if ct > 0:
+                    _cycle_hist.setdefault(st, Histogram(CYCLE_BUCKETS_MS)).observe(ct)
+                _done_total[st] = _done_total.get(st, 0) + 1
+            _prev_done[st] = done
+
+        _snapshot = snap
+
+
+def render():
+    global _collector_errors
+    with _lock:
+        snap = dict(_snapshot)
+        scans = _scans_total
+        scan_lines = _scan_hist.render("plc_scan_wall_seconds")
+        cycle = {st: h.render("station_cycle_time_ms", f'station="{_esc(st)}"')
+                 for st, h in sorted(_cycle_hist.items())}
+        done_total = dict(_done_total)
+        collectors = list(_collectors)
+
+    out = []
+
+    out.append("# TYPE plc_scans counter")
+    out.append("# HELP plc_scans PLC scans executed.")
+    out.append(f"plc_scans_total {scans}")
+    out.append(f"plc_scans_created {_fmt(_started_at)}")
+
+    out.append("# TYPE plc_scan_wall_seconds histogram")
+    out.append("# UNIT plc_scan_wall_seconds seconds")
+    out.append("# HELP plc_scan_wall_seconds Wall time between consecutive PLC scans.")
+    out.extend(scan_lines)
+
+    out.append("# TYPE plc_sim_time_seconds gauge")
+    out.append("# UNIT plc_sim_time_seconds seconds")
+    out.append("# HELP plc_sim_time_seconds VSI simulation time seen by the PLC.")
+    out.append(f"plc_sim_time_seconds {_fmt(snap.get('sim_time_s', 0.0))}")
+
+    out.append("# TYPE plc_state info")
+    out.append("# HELP plc_state Current PLC state machine state.")
+    out.append(f'plc_state_info{{state="{_esc(snap.get("plc_state", ""))}"}} 1')
+
+    out.append("# TYPE line_packages_completed gauge")
+    out.append("# HELP line_packages_completed Packages completed since the last line reset.")
+    out.append(f"line_packages_completed {int(snap.get('packages_completed', 0))}")
+
+    out.append("# TYPE line_throughput_per_minute gauge")
+    out.append("# HELP line_throughput_per_minute Packages per simulated minute.")
+    out.append(f"line_throughput_per_minute {_fmt(snap.get('throughput_per_min', 0.0))}")
+
+    # ST5 counters restart from zero when ST5 is reset; rate() treats that as a counter reset
+    out.append("# TYPE line_units_accepted counter")
+    out.append("# HELP line_units_accepted Units accepted by ST5 quality inspection.")
+    out.append(f"line_units_accepted_total {int(snap.get('accept', 0))}")
+    out.append("# TYPE line_units_rejected counter")
+    out.append("# HELP line_units_rejected Units rejected by ST5 quality inspection.")
+    out.append(f"line_units_rejected_total {int(snap.get('reject', 0))}")
+
+    out.append("# TYPE line_yield_percent gauge")
+    out.append("# HELP line_yield_percent ST5 accept / (accept + reject).")
+    out.append(f"line_yield_percent {_fmt(snap.get('yield_pct', 0.0))}")
+
+    out.append("# TYPE line_availability_percent gauge")
+    out.append("# HELP line_availability_percent ST6 availability reported by the station.")
+    out.append(f"line_availability_percent {_fmt(snap.get('availability', 0.0))}")
+
+    out.append("# TYPE line_downtime_seconds gauge")
+    out.append("# UNIT line_downtime_seconds seconds")
+    out.append("# HELP line_downtime_seconds ST6 accumulated downtime.")
+    out.append(f"line_downtime_seconds {_fmt(snap.get('downtime_s', 0.0))}")
+
+    out.append("# TYPE line_fault gauge")
+    out.append("# HELP line_fault 1 while any station reports a fault.")
+    out.append(f"line_fault {int(snap.get('fault_any', 0))}")
+
+    out.append("# TYPE line_buffer_occupancy gauge")
+    out.append("# HELP line_buffer_occupancy Units held in each inter-station buffer.")
+    for name, v in sorted((snap.get("buffers") or {}).items()):
+        out.append(f'line_buffer_occupancy{{buffer="{_esc(name)}"}} {int(v)}')
+
+    out.append("# TYPE line_buffer_avg_occupancy gauge")
+    out.append("# HELP line_buffer_avg_occupancy Time-weighted mean units held in each buffer.")
+    for name, v in sorted((snap.get("buffer_avg_occupancy") or {}).items()):
+        out.append(f'line_buffer_avg_occupancy{{buffer="{_esc(name)}"}} {_fmt(v)}')
+
+    out.append("# TYPE station_idle_seconds counter")
+    out.append("# UNIT station_idle_seconds seconds")
+    out.append("# HELP station_idle_seconds Simulated time each station spent ready, not busy and not faulted.")
+    for st, v in sorted((snap.get("idle_s") or {}).items()):
+        out.append(f'station_idle_seconds_total{{station="{_esc(st)}"}} {_fmt(v)}')
+
+    out.append("# TYPE station_watchdog_deadline_seconds gauge")
+    out.append("# UNIT station_watchdog_deadline_seconds seconds")
+    out.append("# HELP station_watchdog_deadline_seconds Current start-to-done deadline per station (simulated time).")
+    for st, v in sorted((snap.get("watchdog_deadline_s") or {}).items()):
+        out.append(f'station_watchdog_deadline_seconds{{station="{_esc(st)}"}} {_fmt(v)}')
+
+    out.append("# TYPE station_watchdog_alarms counter")
+    out.append("# HELP station_watchdog_alarms Watchdog trips per station (each one triggers fault recovery).")
+    for st, v in sorted((snap.get("watchdog_alarms") or {}).items()):
+        out.append(f'station_watchdog_alarms_total{{station="{_esc(st)}"}} {int(v)}')
+
+    out.append("# TYPE line_fault_recoveries counter")
+    out.append("# HELP line_fault_recoveries Fault recoveries by mode (line = whole-line reset, local = faulted station only).")
+    for mode, v in sorted((snap.get("recoveries") or {}).items()):
+        out.append(f'line_fault_recoveries_total{{mode="{_esc(mode)}"}} {int(v)}')
+
+    out.append("# TYPE line_recovery_seconds counter")
+    out.append("# UNIT line_recovery_seconds seconds")
+    out.append("# HELP line_recovery_seconds Simulated time from a fault until production resumed, by mode.")
+    for mode, v in sorted((snap.get("recovery_s") or {}).items()):
+        out.append(f'line_recovery_seconds_total{{mode="{_esc(mode)}"}} {_fmt(v)}')
+
+    out.append("# TYPE line_fast_handoffs counter")
+    out.append("# HELP line_fast_handoffs START pulses sent in the same scan the upstream unit was handed over (--fast-handoff).")
+    out.append(f"line_fast_handoffs_total {int(snap.get('fast_handoffs', 0) or 0)}")
+
+    out.append("# TYPE station_bottleneck_ratio gauge")
+    out.append("# HELP station_bottleneck_ratio Share of the window a station was the sole or shifting bottleneck (active-period method).")
+    for win, w in sorted((snap.get("bottleneck_windows") or {}).items(), key=lambda kv: float(kv[0])):
+        if not w:
+            continue
+        for kind in ("sole", "shifting"):
+            for st, v in sorted((w.get(f"{kind}_pct") or {}).items()):
+                out.append(f'station_bottleneck_ratio{{station="{_esc(st)}",kind="{kind}",window_s="{_esc(win)}"}} '
+                           f'{_fmt(float(v) / 100.0)}')
+
+    out.append("# TYPE line_wip_units gauge")
+    out.append("# HELP line_wip_units Units currently in buffers or stations.")
+    out.append(f"line_wip_units {int(snap.get('wip', 0) or 0)}")
+
+    lead = snap.get("lead_time_s") or {}
+    out.append("# TYPE line_lead_time_seconds gauge")
+    out.append("# UNIT line_lead_time_seconds seconds")
+    out.append("# HELP line_lead_time_seconds Lead time (S1 start to S6 done) over recent finished units.")
+    for q in ("mean", "p50", "p90", "p99", "max"):
+        if q in lead:
+            out.append(f'line_lead_time_seconds{{stat="{q}"}} {_fmt(lead[q])}')
+
+    ll = snap.get("littles_law") or {}
+    if ll:
+        out.append("# TYPE line_littles_law_rel_error gauge")
+        out.append("# HELP line_littles_law_rel_error |L - lambda*W| / L over the run (time-average WIP vs. throughput x lead time).")
+        out.append(f"line_littles_law_rel_error {_fmt(ll.get('rel_error', 0.0))}")
+
+    stations = snap.get("stations") or {}
+    for field in ("ready", "busy", "fault"):
+        out.append(f"# TYPE station_{field} gauge")
+        out.append(f"# HELP station_{field} Station {field} flag from its last status packet.")
+        for st, sx in sorted(stations.items()):
+            out.append(f'station_{field}{{station="{_esc(st)}"}} {int(sx.get(field, 0))}')
+
+    out.append("# TYPE station_cycles counter")
+    out.append("# HELP station_cycles Done edges observed by the PLC.")
+    for st, n in sorted(done_total.items()):
+        out.append(f'station_cycles_total{{station="{_esc(st)}"}} {n}')
+
+    out.append("# TYPE station_cycle_time_ms histogram")
+    out.append("# HELP station_cycle_time_ms Station cycle_time_ms reported on each done edge.")
+    for lines in cycle.values():
+        out.extend(lines)
+
+    errors = 0
+    for fn in collectors:
+        try:
+            out.extend(fn())
+        except Exception as e:
+            # OpenMetrics has no free-form comments: log it and count it instead
+            errors += 1
+            print(f"metrics_exporter: collector {getattr(fn, '__qualname__', fn)} failed: {e}", file=sys.stderr)
+    with _lock:
+        _collector_errors += errors
+        collector_errors = _collector_errors
+
+    out.append("# TYPE metrics_collector_errors counter")
+    out.append("# HELP metrics_collector_errors Extra collectors (e.g. the scan profiler) that raised while rendering.")
+    out.append(f"metrics_collector_errors_total {collector_errors}")
+
+    out.append("# EOF")
+    return ("\n".join(out) + "\n").encode("utf-8")
+
+
+# ============================================================
+# HTTP server
+# ============================================================
+class _MetricsHandler(BaseHTTPRequestHandler):
+    def log_message(self, format, *args):
+        return
+
+    def _send(self, code, body, ctype):
+        self.send_response(code)
+        self.send_header("Content-Type", ctype)
+        self.send_header("Cache-Control", "no-store")
+        self.send_header("Content-Length", str(len(body)))
+        self.end_headers()
+        self.wfile.write(body)
+
+    def do_GET(self):
+        path = self.path.split("?", 1)[0]
+        if path == "/metrics":
+            return self._send(200, render(), CONTENT_TYPE)
+        return self._send(404, b"not found\n", "text/plain; charset=utf-8")
+
+
+def start_server(host, port):
+    srv = ThreadingHTTPServer((host, int(port)), _MetricsHandler)
+    print(f"Metrics exporter listening on http://{host}:{port}/metrics")
+    srv.serve_forever()
+
+
+def start_in_thread(host=METRICS_HOST, port=METRICS_PORT):
+    global _srv_thread, _srv_started, METRICS_HOST, METRICS_PORT
+    METRICS_HOST = host
+    METRICS_PORT = int(port)
+    if _srv_started:
+        return
+    _srv_started = True
+    _srv_thread = threading.Thread(target=start_server, args=(METRICS_HOST, METRICS_PORT), daemon=True)
+    _srv_thread.start()
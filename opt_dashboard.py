@@ -13,7 +13,6 @@ import base64
 import re
 from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
 from urllib.parse import parse_qs
-from html import escape as html_escape
 
 # ----------------------------
 # Config
@@ -39,10 +38,17 @@ COOKIE_SECURE = os.environ.get("OPT_COOKIE_SECURE", "0") == "1"
 _BASE_DIR = os.path.dirname(os.path.abspath(__file__))
 KPI_JSON_PATH = os.path.join(_BASE_DIR, "kpi_latest.json")
 KPI_CSV_PATH = os.path.join(_BASE_DIR, "kpi_history.csv")
+# runs recorded by other processes (doe.py / optimizer.py CLIs), read on server start
+RUNS_LOG_PATH = os.path.join(_BASE_DIR, "runs_offline.jsonl")
 
 AUTH_DB_PATH = os.path.join(_BASE_DIR, "opt_auth.sqlite3")
 SECRET_PATH = os.path.join(_BASE_DIR, ".opt_cookie_secret")
 
+# When the dashboard runs in its own process, read KPIs from the PLC's
+# shared-memory bus (PLC option --kpi-bus PATH)
+KPI_BUS_PATH = os.environ.get("OPT_KPI_BUS", "")
+_kpi_bus_reader = None
+
 KPI_WRITE_EVERY_TICKS = 2
 _kpi_tick_counter = 0
 _kpi_csv_header_written = False
@@ -62,7 +68,9 @@ _opt_params = {
     "operators_total": 2,
     "operators_required": {st: 1 for st in STATIONS_DEFAULT},
     "fault_reset_all": True,
+    "fast_handoff": False,
 }
+_params_version = 0  # bumped by every set_params() that changes a value
 
 # active overrides (maintenance / fault blocks)
 _over_lock = threading.Lock()
@@ -401,24 +409,39 @@ def consume_web_cmds():
     return s, p, r
 
 
+def _copy_params():
+    p = dict(_opt_params)
+    p["operators_required"] = dict(_opt_params.get("operators_required", {}))
+    return p
+
+
 def get_params():
     with _params_lock:
-        p = dict(_opt_params)
-        p["operators_required"] = dict(_opt_params.get("operators_required", {}))
-        return p
+        return _copy_params()
+
+
+def params_snapshot():
+    """(version, params) taken under one lock; the PLC polls this at each scan boundary."""
+    with _params_lock:
+        return _params_version, _copy_params()
 
 
 def set_params(patch: dict):
+    global _params_version
     if not isinstance(patch, dict):
         return
     with _params_lock:
+        changed = False
         for k, v in patch.items():
             if k not in _opt_params:
                 continue
             if k == "operators_required" and isinstance(v, dict):
-                _opt_params[k] = dict(v)
-            else:
+                v = dict(v)
+            if _opt_params[k] != v:
                 _opt_params[k] = v
+                changed = True
+        if changed:
+            _params_version += 1
 
 
 def set_kpi_snapshot(snap: dict):
@@ -430,8 +453,15 @@ def set_kpi_snapshot(snap: dict):
 
 
 def get_kpi_snapshot():
+    global _kpi_bus_reader
     with _kpi_lock:
-        return dict(_kpi_snapshot)
+        snap = dict(_kpi_snapshot)
+    if snap or not KPI_BUS_PATH:
+        return snap
+    if _kpi_bus_reader is None:
+        import kpi_bus
+        _kpi_bus_reader = kpi_bus.KpiBusReader(KPI_BUS_PATH)
+    return _kpi_bus_reader.read()
 
 
 def get_overrides(sim_time_s: float):
@@ -510,22 +540,74 @@ def run_stop(final_snap: dict):
         if not _current_run:
             return None
         _current_run["ended_at"] = time.time()
-        _current_run["summary"] = {
-            "packages_completed": int(final_snap.get("packages_completed", 0)),
-            "throughput_per_min": float(final_snap.get("throughput_per_min", 0.0)),
-            "accept": int(final_snap.get("accept", 0)),
-            "reject": int(final_snap.get("reject", 0)),
-            "yield_pct": float(final_snap.get("yield_pct", 0.0)),
-            "availability": float(final_snap.get("availability", 0.0)),
-            "downtime_s": float(final_snap.get("downtime_s", 0.0)),
-            "state": str(final_snap.get("plc_state", "")),
-        }
+        _current_run["summary"] = _run_summary(final_snap)
         _runs.append(_current_run)
         finished = _current_run
         _current_run = None
         return finished
 
 
+def _run_summary(final_snap: dict):
+    return {
+        "packages_completed": int(final_snap.get("packages_completed", 0)),
+        "units_completed": int(final_snap.get("units_completed", 0)),
+        "sim_time_s": float(final_snap.get("sim_time_s", 0.0)),
+        "throughput_per_min": float(final_snap.get("throughput_per_min", 0.0)),
+        "accept": int(final_snap.get("accept", 0)),
+        "reject": int(final_snap.get("reject", 0)),
+        "yield_pct": float(final_snap.get("yield_pct", 0.0)),
+        "availability": float(final_snap.get("availability", 0.0)),
+        "downtime_s": float(final_snap.get("downtime_s", 0.0)),
+        "state": str(final_snap.get("plc_state", "")),
+        "steady_throughput_per_min": float((final_snap.get("steady_state") or {})
+                                           .get("throughput_per_min", {}).get("mean", 0.0)),
+        "warmup_s": float((final_snap.get("steady_state") or {}).get("warmup", {}).get("truncated_s", 0.0)),
+    }
+
+
+def record_run(params: dict, final_snap: dict, meta=None, log_path=None):
+    """
+    Append a finished offline run (e.g. from doe.py) without touching the
+    live run; with log_path also as a JSON line there, for load_runs().
+    """
+    p = get_params()
+    p.update(params or {})
+    now = time.time()
+    r = {
+        "run_id": str(uuid.uuid4())[:8],
+        "started_at": now,
+        "ended_at": now,
+        "params": p,
+        "meta": meta or {},
+        "summary": _run_summary(final_snap or {}),
+    }
+    with _runs_lock:
+        _runs.append(r)
+        if log_path:
+            with open(log_path, "a", encoding="utf-8") as f:
+                f.write(json.dumps(r) + "\n")
+    return r
+
+
+def load_runs(path=RUNS_LOG_PATH):
+    """Add the runs appended to path that are not in the store yet; returns how many."""
+    if not os.path.exists(path):
+        return 0
+    added = 0
+    with open(path, encoding="utf-8") as f, _runs_lock:
+        seen = {r["run_id"] for r in _runs}
+        for line in f:
+            try:
+                r = json.loads(line)
+            except ValueError:
+                continue            # a line cut short by a killed writer
+            if r.get("run_id") not in seen:
+                _runs.append(r)
+                seen.add(r.get("run_id"))
+                added += 1
+    return added
+
+
 def write_kpis_to_files(snapshot: dict):
     global _kpi_tick_counter, _kpi_csv_header_written
     if not bool(get_params().get("file_logging", False)):
@@ -590,13 +672,21 @@ def build_kpi_snapshot(plc, ms, stations):
             "fault": int(getattr(ms, f"{st}_fault", 0) or 0),
             "done": int(getattr(ms, f"{st}_done", 0) or 0),
             "cycle_time_ms": int(getattr(ms, f"{st}_cycle_time_ms", 0) or 0),
+            "done_time_s": int(getattr(ms, f"{st}_done_time_ns", 0) or 0) / 1e9,
         }
 
-    bneck = "-"
-    if any(busy_map.values()):
-        bneck = [k for k, v in busy_map.items() if v][0]
-
     busy_frac = (sum(busy_map.values()) / max(1, len(stations)))
+
+    # active-period detector over the shortest window; the old "first busy station" as fallback
+    bn = plc.bottleneck_summary() if hasattr(plc, "bottleneck_summary") else {}
+    bn_windows = bn.get("windows") or {}
+    bn_short = bn_windows[min(bn_windows, key=float)] if bn_windows else None
+    if bn_short and bn_short.get("primary"):
+        bneck = bn_short["primary"]
+        bneck_util = bn_short["active_pct"].get(bneck, 0.0) / 100.0
+    else:
+        bneck = next((k for k, v in busy_map.items() if v), "-")
+        bneck_util = busy_frac
     idle_pct = (1.0 - busy_frac) * 100.0
 
     downtime_s = float(getattr(ms, "S6_downtime_s", 0.0) or 0.0)
@@ -604,6 +694,13 @@ def build_kpi_snapshot(plc, ms, stations):
 
     ov = get_overrides(t_s)
 
+    flow = plc.flow_summary() if hasattr(plc, "flow_summary") else {}
+    wd = plc.watchdog_summary() if hasattr(plc, "watchdog_summary") else {}
+    rec = plc.recovery_summary() if hasattr(plc, "recovery_summary") else {}
+    wip = plc.wip_summary() if hasattr(plc, "wip_summary") else {}
+    # warm-up truncated estimates; throughput_per_min above still counts from time zero
+    ss = plc.steady_state_summary() if hasattr(plc, "steady_state_summary") else {}
+
     return {
         "sim_time_s": t_s,
         "plc_state": str(getattr(plc, "_state", "")),
@@ -615,8 +712,26 @@ def build_kpi_snapshot(plc, ms, stations):
         "reject": reject,
         "yield_pct": float(yield_pct),
         "buffers": dict(getattr(plc, "_buffers", {}) or {}),
+        "buffer_avg_occupancy": flow.get("buffer_avg_occupancy", {}),
+        "idle_s": flow.get("idle_s", {}),
+        "watchdog_deadline_s": wd.get("deadline_s", {}),
+        "watchdog_alarms": wd.get("alarms", {}),
+        "last_watchdog_alarm": wd.get("last_alarm"),
+        "recovery_mode": rec.get("mode", "line"),
+        "recoveries": rec.get("count", {}),
+        "recovery_s": rec.get("seconds", {}),
+        "fast_handoffs": int(getattr(plc, "_fast_handoffs", 0) or 0),
+        "wip": wip.get("wip", 0),
+        "units_completed": wip.get("units_completed", 0),
+        "units_lost": wip.get("units_lost", 0),
+        "lead_time_s": wip.get("lead_time_s", {}),
+        "queue_time_s_mean": wip.get("queue_time_s_mean", 0.0),
+        "littles_law": wip.get("littles_law", {}),
+        "steady_state": ss,
         "bottleneck_station": bneck,
-        "bottleneck_utilization": float(busy_frac),
+        "bottleneck_utilization": float(bneck_util),
+        "bottleneck_current": bn.get("current"),
+        "bottleneck_windows": bn_windows,
         "line_idle_pct": float(idle_pct),
         "downtime_s": float(downtime_s),
         "availability": float(availability),
@@ -931,7 +1046,7 @@ HTML_PAGE = ("""<!doctype html>
       border-color: rgba(251,113,133,.30);
     }
 
-    input, select{
+    input, select, textarea{
       width:100%;
       color:var(--text);
       background: rgba(0,0,0,.25);
@@ -1071,7 +1186,7 @@ HTML_PAGE = ("""<!doctype html>
       <div class="kpi">
         <div class="kpiLabel">Throughput</div>
         <div class="kpiValue" id="kpi_tpm">0.0</div>
-        <div class="kpiSub">units / minute</div>
+        <div class="kpiSub" id="kpi_tpm_ss">units / minute</div>
         <div class="kpiGlow" id="kpi_idle">idle: -%</div>
       </div>
 
@@ -1124,16 +1239,15 @@ HTML_PAGE = ("""<!doctype html>
         <div class="h"><b>Line tuning</b><span class="muted">PLC reads each scan</span></div>
         <div class="line"></div>
         <div class="cols2">
-          <div>
-            <div class="muted">buf_max</div>
-            <input id="buf_max" type="number" min="0" max="20" value="2"/>
-          </div>
           <div>
             <div class="muted">reset_pulse_ticks</div>
             <input id="reset_ticks" type="number" min="1" max="20" value="3"/>
           </div>
+          <div class="muted">buffer caps: none (one unit in flight)</div>
+          <label><input id="run_enable" type="checkbox" checked/> run_enable</label>
           <label><input id="file_logging" type="checkbox"/> file_logging</label>
           <label><input id="fault_reset_all" type="checkbox" checked/> fault_reset_all</label>
+          <label><input id="fast_handoff" type="checkbox"/> fast_handoff</label>
         </div>
         <div class="line"></div>
         <button class="primary" onclick="applyLine()">Apply line params</button>
@@ -1201,6 +1315,89 @@ HTML_PAGE = ("""<!doctype html>
         <div id="blocks" style="margin-top:10px" class="muted">none</div>
       </div>
 
+      <div class="card span12">
+        <div class="h"><b>Experiments (DOE)</b><span class="muted">headless runs in a process pool • results land in Runs</span></div>
+        <div class="line"></div>
+        <div class="cols2">
+          <div>
+            <div class="muted">design spec (design: full | lhs | frac)</div>
+            <textarea id="doe_spec" rows="7" class="mono" style="width:100%">{"design": "full", "factors": {"reset_pulse_ticks": [1, 3, 5], "fast_handoff": [0, 1]}, "n": 10, "horizon_s": 3600, "seeds": [1, 2]}</textarea>
+            <div style="margin-top:10px"><button class="primary" onclick="doeStart()">Run DOE</button></div>
+          </div>
+          <div>
+            <div class="muted">response surface (throughput_per_min) • <span id="doe_state">idle</span></div>
+            <pre id="doe_table">no experiment yet</pre>
+          </div>
+        </div>
+      </div>
+
+      <div class="card span12">
+        <div class="h"><b>Optimizer</b><span class="muted">GP surrogate + expected improvement • best config with 95% CI</span></div>
+        <div class="line"></div>
+        <div class="cols2">
+          <div>
+            <div class="muted">search space (integer ranges) and budget</div>
+            <textarea id="opt_spec" rows="7" class="mono" style="width:100%">{"space": {"reset_pulse_ticks": [1, 6], "fault_reset_all": [0, 1], "fast_handoff": [0, 1]}, "budget": 10, "batch": 3, "horizon_s": 3600, "seeds": [1, 2]}</textarea>
+            <div style="margin-top:10px; display:flex; gap:10px; flex-wrap:wrap">
+              <button class="primary" onclick="optStart()">Optimise</button>
+              <button onclick="optApply()">Apply best to line</button>
+            </div>
+          </div>
+          <div>
+            <div class="muted">result • <span id="opt_state">idle</span></div>
+            <pre id="opt_table">no optimisation yet</pre>
+          </div>
+        </div>
+      </div>
+
+      <div class="card span12">
+        <div class="h"><b>Analysis</b><span class="muted">serial line model + surrogate from the run history • instant what-if</span></div>
+        <div class="line"></div>
+        <div class="cols2">
+          <div>
+            <div class="muted">one unit in flight, as the PLC runs • buffer caps have no effect</div>
+            <div class="muted">handoff_s (PLC delay per station start) • fault_recovery_s</div>
+            <div class="hrrow"><div class="mono">hand</div><input id="an_handoff_s" type="range" min="0" max="10" step="0.2" value="5.4" oninput="analyse()"/><div class="mono" id="anv_handoff_s">5.4</div></div>
+            <div class="hrrow"><div class="mono">rec</div><input id="an_fault_recovery_s" type="range" min="0" max="60" step="1" value="0" oninput="analyse()"/><div class="mono" id="anv_fault_recovery_s">0</div></div>
+            <div style="margin-top:10px"><button onclick="analysisAccuracy()">Accuracy vs recorded runs</button></div>
+          </div>
+          <div>
+            <div class="muted">serial model • <span id="an_state">idle</span></div>
+            <pre id="an_table">move a slider</pre>
+          </div>
+        </div>
+      </div>
+
+      <div class="card span12">
+        <div class="h"><b>Forecast</b><span class="muted">N continuations of a fork of the line • bands p10/p50/p90</span></div>
+        <div class="line"></div>
+        <div class="cols2">
+          <div>
+            <div class="muted">station down from now (none = as is)</div>
+            <select id="fc_st">
+              <option selected>none</option><option>S1</option><option>S2</option><option>S3</option>
+              <option>S4</option><option>S5</option><option>S6</option>
+            </select>
+            <div class="muted" style="margin-top:10px">down_min • horizon_min • runs</div>
+            <div style="display:flex; gap:10px">
+              <input id="fc_down" type="number" value="15" style="max-width:110px"/>
+              <input id="fc_horizon" type="number" value="60" style="max-width:110px"/>
+              <input id="fc_n" type="number" value="16" style="max-width:110px"/>
+            </div>
+            <div class="muted" style="margin-top:10px">target units today • deadline_min from now (blank = none)</div>
+            <div style="display:flex; gap:10px">
+              <input id="fc_target" type="number" value="" style="max-width:110px"/>
+              <input id="fc_deadline" type="number" value="" style="max-width:110px"/>
+            </div>
+            <div style="margin-top:10px"><button class="primary" onclick="forecastStart()">Forecast</button></div>
+          </div>
+          <div>
+            <div class="muted">forecast • <span id="fc_state">idle</span></div>
+            <pre id="fc_table">no forecast yet</pre>
+          </div>
+        </div>
+      </div>
+
       <div class="card span6">
         <div class="h"><b>Debug</b><span class="muted">raw JSON (optional)</span></div>
         <div class="line"></div>
@@ -1255,10 +1452,11 @@ function setAllReq(v){
 
 async function loadParams(){
   const p = await get("/params");
-  i("buf_max").value = p.buf_max ?? 2;
   i("reset_ticks").value = p.reset_pulse_ticks ?? 3;
+  i("run_enable").checked = p.run_enable !== false;
   i("file_logging").checked = !!p.file_logging;
   i("fault_reset_all").checked = !!p.fault_reset_all;
+  i("fast_handoff").checked = !!p.fast_handoff;
 
   i("ops_total").value = p.operators_total ?? 2;
 
@@ -1270,14 +1468,17 @@ async function loadParams(){
       syncVal(st);
     }
   });
+
+  analyse();
 }
 
 async function applyLine(){
   await post("/params",{
-    buf_max: parseInt(i("buf_max").value||"2"),
     reset_pulse_ticks: parseInt(i("reset_ticks").value||"3"),
+    run_enable: !!i("run_enable").checked,
     file_logging: !!i("file_logging").checked,
-    fault_reset_all: !!i("fault_reset_all").checked
+    fault_reset_all: !!i("fault_reset_all").checked,
+    fast_handoff: !!i("fast_handoff").checked
   });
   await loadParams();
 }
@@ -1475,8 +1676,16 @@ function updateUI(k){
   i("kpi_batch").textContent = String(k.batch_id ?? "-");
   i("kpi_recipe").textContent = String(k.recipe_id ?? "-");
 
-  i("kpi_bneck").textContent = "bneck: " + (k.bottleneck_station ?? "-");
+  const bw = k.bottleneck_windows || {};
+  const bwk = Object.keys(bw).sort((a, b) => Number(a) - Number(b));
+  const bshare = bwk.length && bw[bwk[0]]?.primary ? ` ${Math.round(100 * (bw[bwk[0]].primary_share || 0))}%` : "";
+  i("kpi_bneck").textContent = "bneck: " + (k.bottleneck_station ?? "-") + bshare +
+    (k.bottleneck_current && k.bottleneck_current !== k.bottleneck_station ? ` (now ${k.bottleneck_current})` : "");
   i("kpi_idle").textContent = "idle: " + Number(k.line_idle_pct ?? 0).toFixed(1) + "%";
+  const ss = k.steady_state || {}, sst = ss.throughput_per_min;
+  i("kpi_tpm_ss").textContent = (sst && sst.half_width != null)
+    ? "steady " + sst.mean.toFixed(2) + " \u00b1 " + sst.half_width.toFixed(2) + " (warm-up " + ss.warmup.truncated_s.toFixed(0) + " s" + (ss.warmup.settled ? "" : ", not settled") + ")"
+    : "units / minute";
 
   pushSpark(Number(k.throughput_per_min ?? 0));
   drawSpark();
@@ -1485,6 +1694,122 @@ function updateUI(k){
   renderStations(k);
 }
 
+async function doeStart(){
+  let spec;
+  try{ spec = JSON.parse(i("doe_spec").value); }catch(e){ i("doe_state").textContent = "invalid JSON"; return; }
+  const r = await post("/doe/start", spec);
+  i("doe_state").textContent = r.ok ? ("started " + r.doe_id + " (" + r.runs + " runs)") : ("error: " + r.error);
+}
+async function doeTick(){
+  const d = await get("/doe");
+  if(d.state === "idle") return;
+  i("doe_state").textContent = d.doe_id + " " + d.state + " " + d.done + "/" + d.total + (d.error ? " " + d.error : "");
+  i("doe_table").textContent = d.table;
+}
+
+const AN_KEYS = ["handoff_s","fault_recovery_s"];
+let anModel = "", anSurrogate = "", anTimer = null;
+async function analyse(){
+  const q = AN_KEYS.map(k=>{
+    i("anv_"+k).textContent = i("an_"+k).value;
+    return k + "=" + encodeURIComponent(i("an_"+k).value);
+  }).join("&");
+  const r = await get("/analysis?" + q);
+  if(!r.ok){ i("an_state").textContent = "error: " + r.error; return; }
+  const a = r.result;
+  i("an_state").textContent = "solved in " + a.elapsed_us.toFixed(0) + " us";
+  const rows = ["station  mean_s   scv    util%   idle%"];
+  Object.entries(a.stations).forEach(([st,v])=>{
+    rows.push(st.padEnd(8) + v.mean_s.toFixed(1).padStart(6) + v.scv.toFixed(3).padStart(7)
+      + v.utilization_pct.toFixed(1).padStart(8) + v.idle_pct.toFixed(1).padStart(8));
+  });
+  anModel = "throughput/h " + a.throughput_per_hour.toFixed(1) + "  good/h " + a.good_per_hour.toFixed(1)
+    + "\\nWIP " + a.wip.toFixed(2) + "  lead time " + a.lead_time_s.toFixed(0) + " s  bottleneck " + a.bottleneck
+    + "\\n\\n" + rows.join("\\n");
+  anRender();
+  // the surrogate (and its refit) once the slider settles, not on every oninput
+  clearTimeout(anTimer);
+  anTimer = setTimeout(async ()=>{ anSurrogate = await surrogateLine(); anRender(); }, 400);
+}
+function anRender(){ i("an_table").textContent = anModel + (anSurrogate ? "\\n\\n" + anSurrogate : ""); }
+async function surrogateLine(){
+  // line tuning as entered (buffer caps are not surrogate features)
+  const q = "reset_pulse_ticks=" + encodeURIComponent(i("reset_ticks").value || "3")
+    + "&fault_reset_all=" + (i("fault_reset_all").checked ? 1 : 0) + "&fast_handoff=" + (i("fast_handoff").checked ? 1 : 0);
+  await post("/surrogate/refresh");
+  const r = await get("/surrogate/predict?" + q);
+  if(!r.ok) return "surrogate: " + r.error;
+  const p = r.result, t = p.responses.throughput_per_min;
+  if(!t) return "surrogate: " + p.reasons.join("; ");
+  return "surrogate (" + p.configs + " configs, " + p.runs + " runs): throughput/h "
+    + (60*t.mean).toFixed(1) + " ± " + (60*1.96*t.sd).toFixed(1)
+    + "  yield " + p.responses.yield_pct.mean.toFixed(1) + "%  availability " + p.responses.availability.mean.toFixed(3)
+    + (p.needs_simulation ? "\\n  simulate to confirm: " + p.reasons.join("; ") : "");
+}
+async function analysisAccuracy(){
+  clearTimeout(anTimer);
+  const r = await get("/analysis/accuracy");
+  if(!r.ok){ i("an_state").textContent = "error: " + r.error; return; }
+  const e = r.result.throughput_abs_err_pct;
+  i("an_state").textContent = r.result.runs + " runs • mean |err| " + (e.mean == null ? "-" : e.mean.toFixed(1) + "%");
+  const rows = r.result.cases.map(c=>
+    (c.run_id||"").padEnd(10)
+    + c.throughput_per_hour.approx.toFixed(1).padStart(8) + c.throughput_per_hour.sim.toFixed(1).padStart(8)
+    + (c.throughput_per_hour.err_pct.toFixed(1) + "%").padStart(8));
+  i("an_table").textContent = rows.length ? ["run        model/h   run/h     err"].concat(rows).join("\\n")
+    : "no recorded runs with units_completed yet";
+}
+
+async function forecastStart(){
+  const num = id=>{ const v = i(id).value.trim(); return v === "" ? null : Number(v); };
+  const st = i("fc_st").value;
+  const spec = {horizon_s: 60*num("fc_horizon"), n: num("fc_n"), target_units: num("fc_target"),
+                deadline_s: num("fc_deadline") == null ? null : 60*num("fc_deadline"),
+                outage: st === "none" ? null : {station: st, down_s: 60*num("fc_down")}};
+  const r = await post("/forecast/start", spec);
+  i("fc_state").textContent = r.ok ? ("started " + r.forecast_id + " (" + r.runs + " runs)") : ("error: " + r.error);
+}
+async function forecastTick(){
+  const d = await get("/forecast");
+  if(d.state === "idle") return;
+  i("fc_state").textContent = d.forecast_id + " " + d.state + " " + d.done + "/" + d.total + " from " + d.source
+    + " • " + d.elapsed_s.toFixed(1) + " s" + (d.error ? " " + d.error : "");
+  const f = d.result;
+  if(!f.units){ i("fc_table").textContent = (f.errors || []).join("\\n") || "running…"; return; }
+  const b = (x, k=1)=> x == null ? "-" : (k*x).toFixed(1);
+  const band = (v, k=1)=> b(v.p50, k) + " [" + b(v.p10, k) + ", " + b(v.p90, k) + "]";
+  const rows = [f.basis, "", "throughput/h " + band(f.throughput_per_min, 60) + "  units " + band(f.units)
+    + "  (" + Math.round(f.sim_s_per_wall_s || 0) + "x real time per run)", "", " t_min  units p50 [p10, p90]"];
+  f.fan.forEach(p=>rows.push((p.t_s/60).toFixed(0).padStart(6) + "  " + band(p)));
+  if(f.target){
+    const t = f.target;
+    rows.push("", "target " + t.target_units + " (done " + t.done_units + ", " + t.remaining + " to go): P(miss by "
+      + (t.deadline_s/60).toFixed(0) + " min) = " + (100*t.p_miss).toFixed(0) + "%",
+      "reached in min " + band(t.eta_s, 1/60) + "  (" + t.reached_in_horizon + "/" + f.runs + " within the horizon)");
+  }
+  i("fc_table").textContent = rows.join("\\n");
+}
+
+let optBest = null;
+async function optStart(){
+  let spec;
+  try{ spec = JSON.parse(i("opt_spec").value); }catch(e){ i("opt_state").textContent = "invalid JSON"; return; }
+  const r = await post("/opt/start", spec);
+  i("opt_state").textContent = r.ok ? ("started " + r.opt_id + " (budget " + r.budget + ")") : ("error: " + r.error);
+}
+async function optApply(){
+  if(!optBest) return;
+  await post("/params", optBest);
+  await loadParams();
+}
+async function optTick(){
+  const d = await get("/opt");
+  if(d.state === "idle") return;
+  i("opt_state").textContent = d.opt_id + " " + d.state + " " + (d.evaluated||0) + "/" + d.budget + (d.error ? " " + d.error : "");
+  i("opt_table").textContent = d.table;
+  optBest = d.best ? d.best.params : null;
+}
+
 async function tick(){
   const k = await get("/kpi");
   i("kpi").textContent = JSON.stringify(k,null,2);
@@ -1492,6 +1817,10 @@ async function tick(){
 
   const r = await get("/runs");
   i("runs").textContent = JSON.stringify(r,null,2);
+
+  await doeTick();
+  await optTick();
+  await forecastTick();
 }
 
 loadParams();
@@ -1682,6 +2011,68 @@ class _OptHandler(BaseHTTPRequestHandler):
                 return
             return self._json(200, get_params())
 
+        if self.path.startswith("/doe"):
+            s = self._require_auth()
+            if not s:
+                return
+            import doe
+            return self._json(200, doe.current_status())
+
+        if self.path.startswith("/opt"):
+            s = self._require_auth()
+            if not s:
+                return
+            import optimizer
+            return self._json(200, optimizer.current_status())
+
+        if self.path.startswith("/analysis"):
+            s = self._require_auth()
+            if not s:
+                return
+            import queueing_approx
+            path, _, raw = self.path.partition("?")
+            q = {k: v[-1] for k, v in parse_qs(raw).items()}
+            try:
+                kw = {
+                    "recipe_id": int(q.pop("recipe", 0)),
+                    "handoff_s": float(q.pop("handoff_s", queueing_approx.SERIAL_HANDOFF_S)),
+                    "fault_recovery_s": float(q.pop("fault_recovery_s", 0.0)),
+                }
+                if path.startswith("/analysis/accuracy"):
+                    with _runs_lock:
+                        data = list(_runs)
+                    return self._json(200, {"ok": True, "result": queueing_approx.compare_runs(data, **kw)})
+                moments = queueing_approx.station_moments(**kw)
+                return self._json(200, {"ok": True, "result": queueing_approx.approximate(moments)})
+            except (ValueError, TypeError, KeyError) as e:
+                return self._json(400, {"ok": False, "error": str(e)})
+
+        if self.path.startswith("/surrogate"):
+            s = self._require_auth()
+            if not s:
+                return
+            import surrogate
+            path, _, raw = self.path.partition("?")
+            if not path.startswith("/surrogate/predict"):
+                return self._json(200, surrogate.current_status())
+            model = surrogate.current_model()
+            if model is None:
+                return self._json(409, {"ok": False, "error": "no surrogate yet: POST /surrogate/refresh"})
+            point = {}
+            for k, v in parse_qs(raw).items():
+                try:
+                    point[k] = json.loads(v[-1])
+                except ValueError:
+                    return self._json(400, {"ok": False, "error": f"bad value for {k}"})
+            return self._json(200, {"ok": True, "result": model.predict(point)})
+
+        if self.path.startswith("/forecast"):
+            s = self._require_auth()
+            if not s:
+                return
+            import forecast
+            return self._json(200, forecast.current_status())
+
         if self.path.startswith("/runs"):
             s = self._require_auth()
             if not s:
@@ -1815,11 +2206,52 @@ class _OptHandler(BaseHTTPRequestHandler):
             _audit(int(s["user_id"]), self._ip(), "clear_blocks", {})
             return self._json(200, {"ok": True})
 
+        if self.path.startswith("/surrogate/refresh"):
+            import surrogate
+            with _runs_lock:
+                data = list(_runs)
+            surrogate.refresh(data, get_params())
+            return self._json(200, {"ok": True, "status": surrogate.current_status()})
+
+        if self.path.startswith("/doe/start"):
+            import doe
+            spec = self._read_json()
+            try:
+                run = doe.start_in_thread(spec)
+            except (ValueError, TypeError, KeyError) as e:
+                return self._json(400, {"ok": False, "error": str(e)})
+            _audit(int(s["user_id"]), self._ip(), "doe_start", {"doe_id": run.doe_id, "runs": run.total})
+            return self._json(200, {"ok": True, "doe_id": run.doe_id, "runs": run.total})
+
+        if self.path.startswith("/opt/start"):
+            import optimizer
+            spec = self._read_json()
+            try:
+                opt = optimizer.start_in_thread(spec)
+            except (ValueError, TypeError, KeyError) as e:
+                return self._json(400, {"ok": False, "error": str(e)})
+            _audit(int(s["user_id"]), self._ip(), "opt_start", {"opt_id": opt.opt_id, "budget": opt.budget})
+            return self._json(200, {"ok": True, "opt_id": opt.opt_id, "budget": opt.budget})
+
+        if self.path.startswith("/forecast/start"):
+            import forecast
+            spec = self._read_json()
+            try:
+                fc = forecast.start_in_thread(spec)
+            except (ValueError, TypeError, KeyError) as e:
+                return self._json(400, {"ok": False, "error": str(e)})
+            _audit(int(s["user_id"]), self._ip(), "forecast_start",
+                   {"forecast_id": fc.forecast_id, "runs": fc.n, "outage": fc.outage})
+            return self._json(200, {"ok": True, "forecast_id": fc.forecast_id, "runs": fc.n})
+
         return self._json(404, {"ok": False, "error": "not found"})
 
 
 def start_server(host, port):
     _db_init()
+    n = load_runs()
+    if n:
+        print(f"Run store: {n} offline runs from {RUNS_LOG_PATH}")
     srv = ThreadingHTTPServer((host, int(port)), _OptHandler)
     print(f"Dashboard listening on {host}:{port}")
     print(f"Open: http://127.0.0.1:{port}  (or http://localhost:{port})")
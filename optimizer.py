@@ -0,0 +1,505 @@
+# pythonGateways/optimizer.py
+"""
+Black-box optimiser for the line settings (Bayesian optimisation).
+
+Proposes parameter sets from the same factor space as doe.py
+(reset_pulse_ticks, fault_reset_all, fast_handoff), evaluates them
+as parallel headless replications (doe.DoeRun) and refines the proposals with
+a Gaussian-process surrogate and expected improvement. Batches of q points
+are chosen with the "kriging believer" heuristic so they can run in parallel.
+
+Returns the best configuration with a confidence bound on the response
+(throughput_per_min by default) from the GP posterior and from the raw
+replications.
+
+    python optimizer.py --space reset_pulse_ticks=1:6 --space fast_handoff=0:1 --budget 6
+    python optimizer.py --vs-grid        # default space, then the whole grid for comparison
+
+From the dashboard: POST /opt/start with {"space": {...}, "budget", "batch", "seeds"}.
+
+Buffer caps and staffing are not searched (doe.INERT_FACTORS): the PLC
+keeps one unit in flight, so no cap ever binds, and nothing in the line
+models operators. Searching them would only spend budget on ties.
+
+The default space is only 24 configurations, so the default budget
+evaluates 10 of them. Each result reports evaluations_to_best (when the
+pick was first evaluated); --vs-grid then runs the rest of the grid with
+the same seeds and reports where the pick ranks against that exhaustive
+search. On a space this small, when simulations are cheap, doe.py's full
+factorial is the simpler choice.
+
+The GP is O(n^3) in evaluated configurations, which the budget keeps small.
+A configuration whose replications all fail counts against the budget and
+is not proposed again.
+"""
+import argparse
+import itertools
+import json
+import math
+import random
+import statistics
+import threading
+import time
+
+import doe
+from bg_jobs import JobSlot, new_id
+
+DEFAULT_SPACE = {"reset_pulse_ticks": (1, 6), "fault_reset_all": (0, 1), "fast_handoff": (0, 1)}
+DEFAULT_BUDGET = 10         # distinct configurations evaluated (of 24 in DEFAULT_SPACE)
+DEFAULT_BATCH = 3           # proposals per round (run in parallel)
+DEFAULT_N_INIT = 4          # Latin hypercube points before the GP takes over
+MAX_CANDIDATES = 4000       # random subset when the integer grid is larger
+
+LENGTHSCALES = (0.1, 0.2, 0.35, 0.6, 1.0)   # on the unit cube, picked by marginal likelihood
+JITTER = (1e-8, 1e-6, 1e-4, 1e-2)           # diagonal added until the kernel matrix factors
+Z95 = 1.96
+
+
+# ============================================================
+# Small dense linear algebra
+# ============================================================
+def _cholesky(a):
+    n = len(a)
+    L = [[0.0] * n for _ in range(n)]
+    for i in range(n):
+        for j in range(i + 1):
+            s = a[i][j] - sum(L[i][k] * L[j][k] for k in range(j))
+            if i == j:
+                if s <= 0.0:
+                    raise ValueError("matrix not positive definite")
+                L[i][i] = math.sqrt(s)
+            else:
+                L[i][j] = s / L[j][j]
+    return L
+
+
+def _solve_lower(L, b):
+    x = [0.0] * len(b)
+    for i in range(len(b)):
+        x[i] = (b[i] - sum(L[i][k] * x[k] for k in range(i))) / L[i][i]
+    return x
+
+
+def _solve_upper_t(L, b):
+    """Solve L^T x = b."""
+    n = len(b)
+    x = [0.0] * n
+    for i in range(n - 1, -1, -1):
+        x[i] = (b[i] - sum(L[k][i] * x[k] for k in range(i + 1, n))) / L[i][i]
+    return x
+
+
+# ============================================================
+# Gaussian process (RBF kernel, per-point noise)
+# ============================================================
+class GaussianProcess:
+    def __init__(self, lengthscales=LENGTHSCALES):
+        self.lengthscales = tuple(lengthscales)
+        self.ls = lengthscales[0]
+        self.X = []
+        self._L = None
+        self._alpha = None
+        self._mean = 0.0
+        self._scale = 1.0
+
+    @staticmethod
+    def _k(a, b, ls):
+        d2 = sum((x - y) ** 2 for x, y in zip(a, b))
+        return math.exp(-0.5 * d2 / (ls * ls))
+
+    def _factor(self, X, ys, noise, ls):
+        n = len(X)
+        K = [[self._k(X[i], X[j], ls) + (noise[i] if i == j else 0.0) for j in range(n)] for i in range(n)]
+        for jitter in JITTER:
+            try:
+                L = _cholesky([[v + (jitter if i == j else 0.0) for j, v in enumerate(row)]
+                               for i, row in enumerate(K)])
+                break
+            except ValueError:
+                continue
+        else:
+            raise ValueError(f"kernel matrix not positive definite at lengthscale {ls} (jitter up to {JITTER[-1]})")
+        alpha = _solve_upper_t(L, _solve_lower(L, ys))
+        lml = -0.5 * sum(y * a for y, a in zip(ys, alpha)) - sum(math.log(L[i][i]) for i in range(n))
+        return L, alpha, lml
+
+    def fit(self, X, y, noise_var=None):
+        """X: points on the unit cube, y: responses, noise_var: per-point variance of y."""
+        self.X = [list(x) for x in X]
+        self._mean = statistics.fmean(y)
+        sd = statistics.pstdev(y) if len(y) > 1 else 0.0
+        self._scale = sd if sd > 1e-12 else 1.0
+        ys = [(v - self._mean) / self._scale for v in y]
+        if noise_var is None:
+            noise = [1e-4] * len(y)
+        else:
+            noise = [max(1e-4, v / (self._scale ** 2)) for v in noise_var]
+        best, err = None, None
+        for ls in self.lengthscales:
+            try:
+                L, alpha, lml = self._factor(self.X, ys, noise, ls)
+            except ValueError as e:
+                err = e
+                continue
+            if best is None or lml > best[3]:
+                best = (ls, L, alpha, lml)
+        if best is None:
+            raise ValueError(f"GP fit failed for every lengthscale: {err}")
+        self.ls, self._L, self._alpha, _ = best
+        return self
+
+    def predict(self, x, d2=None):
+        """Posterior (mean, sd) of the response at x; d2 = squared distances to X if already known."""
+        if d2 is None:
+            ks = [self._k(x, xi, self.ls) for xi in self.X]
+        else:
+            c = -0.5 / (self.ls * self.ls)
+            ks = [math.exp(c * d) for d in d2]
+        mu = sum(k * a for k, a in zip(ks, self._alpha))
+        v = _solve_lower(self._L, ks)
+        var = max(0.0, 1.0 - sum(t * t for t in v))
+        return self._mean + mu * self._scale, math.sqrt(var) * self._scale
+
+
+def _norm_pdf(z):
+    return math.exp(-0.5 * z * z) / math.sqrt(2.0 * math.pi)
+
+
+def _norm_cdf(z):
+    return 0.5 * (1.0 + math.erf(z / math.sqrt(2.0)))
+
+
+def expected_improvement(mu, sd, best, xi=0.01):
+    if sd <= 1e-12:
+        return max(0.0, mu - best - xi)
+    z = (mu - best - xi) / sd
+    return (mu - best - xi) * _norm_cdf(z) + sd * _norm_pdf(z)
+
+
+# ============================================================
+# Search space (integer boxes)
+# ============================================================
+class Space:
+    def __init__(self, bounds):
+        self.names = list(bounds)
+        for n in self.names:
+            doe.check_factor(n)
+        self.bounds = {n: (int(min(b)), int(max(b))) for n, b in bounds.items()}
+
+    def size(self):
+        return math.prod(hi - lo + 1 for lo, hi in self.bounds.values())
+
+    def to_unit(self, p):
+        out = []
+        for n in self.names:
+            lo, hi = self.bounds[n]
+            out.append((p[n] - lo) / (hi - lo) if hi > lo else 0.0)
+        return out
+
+    def key(self, p):
+        return tuple(p[n] for n in self.names)
+
+    def candidates(self, rng):
+        if self.size() <= MAX_CANDIDATES:
+            ranges = [range(lo, hi + 1) for lo, hi in self.bounds.values()]
+            return [dict(zip(self.names, c)) for c in itertools.product(*ranges)]
+        return [{n: rng.randint(lo, hi) for n, (lo, hi) in self.bounds.items()} for _ in range(MAX_CANDIDATES)]
+
+
+# ============================================================
+# Optimiser
+# ============================================================
+class Optimizer:
+    """Safe to poll status() from another thread while run() executes."""
+
+    def __init__(self, space=None, budget=DEFAULT_BUDGET, batch=DEFAULT_BATCH, n_init=DEFAULT_N_INIT,
+                 seeds=doe.DEFAULT_SEEDS, horizon_s=doe.DEFAULT_HORIZON_S, step_ms=None, workers=None,
+                 response="throughput_per_min", rng_seed=0, record=True, runs_log=None):
+        self.space = Space(space or DEFAULT_SPACE)
+        self.budget = min(int(budget), self.space.size())
+        self.batch = max(1, int(batch))
+        self.n_init = max(2, min(int(n_init), self.budget))
+        self.seeds = [int(s) for s in seeds]
+        self.horizon_s = float(horizon_s)
+        self.step_ms = step_ms
+        self.workers = workers
+        self.response = response
+        self.record = bool(record)
+        self.runs_log = runs_log
+        self.rng = random.Random(rng_seed)
+        self.opt_id = new_id("opt")
+        self.obs = {}            # key -> {"point": p, "ys": [...]}
+        self.failed = {}         # key -> point whose replications all failed
+        self.history = []        # (round, point, mean)
+        self.state = "pending"
+        self.error = ""
+        self.rounds = 0
+        self.gp = None
+        self._lock = threading.Lock()
+
+    # ---------- evaluation ----------
+    def _evaluate(self, points):
+        run = doe.DoeRun(points, horizon_s=self.horizon_s, seeds=self.seeds, step_ms=self.step_ms,
+                         workers=self.workers, record=self.record, runs_log=self.runs_log,
+                         meta={"doe_id": f"{self.opt_id}-r{self.rounds}"})
+        results = run.run()
+        if run.state != "done":
+            raise RuntimeError(run.error or "evaluation failed")
+        with self._lock:
+            for r in results:
+                if not r.get("ok"):
+                    continue
+                p = r["point"]
+                o = self.obs.setdefault(self.space.key(p), {"point": p, "ys": []})
+                o["ys"].append(float(r["kpis"].get(self.response, 0.0)))
+            for p in points:
+                o = self.obs.get(self.space.key(p))
+                if o:
+                    self.history.append((self.rounds, p, statistics.fmean(o["ys"])))
+                else:
+                    self.failed[self.space.key(p)] = p
+            self.rounds += 1
+
+    def _data(self):
+        X, y, nv = [], [], []
+        for o in self.obs.values():
+            ys = o["ys"]
+            X.append(self.space.to_unit(o["point"]))
+            y.append(statistics.fmean(ys))
+            # variance of the mean; pooled later if a point has a single replication
+            nv.append(statistics.variance(ys) / len(ys) if len(ys) > 1 else None)
+        known = [v for v in nv if v is not None]
+        pooled = statistics.fmean(known) if known else 0.0
+        return X, y, [pooled if v is None else v for v in nv]
+
+    def _fit(self):
+        if not self.obs:
+            raise RuntimeError(f"every run failed ({len(self.failed)} configurations)")
+        X, y, nv = self._data()
+        self.gp = GaussianProcess().fit(X, y, nv)
+        return max(y)
+
+    # ---------- proposals ----------
+    def propose(self, q):
+        best = self._fit()
+        cands = [c for c in self.space.candidates(self.rng)
+                 if self.space.key(c) not in self.obs and self.space.key(c) not in self.failed]
+        chosen = []
+        gp = self.gp
+        X, y, nv = self._data()
+        for _ in range(min(q, len(cands))):
+            scored = []
+            for c in cands:
+                mu, sd = gp.predict(self.space.to_unit(c))
+                scored.append((expected_improvement(mu, sd, best), c))
+            ei, c = max(scored, key=lambda t: t[0])
+            chosen.append(c)
+            cands.remove(c)
+            # kriging believer: pretend the prediction was observed and refit
+            mu, _ = gp.predict(self.space.to_unit(c))
+            X.append(self.space.to_unit(c))
+            y.append(mu)
+            nv.append(min(nv) if nv else 1e-4)
+            gp = GaussianProcess([gp.ls]).fit(X, y, nv)
+        return chosen
+
+    def run(self):
+        self.state = "running"
+        try:
+            init = doe.latin_hypercube({n: self.space.bounds[n] for n in self.space.names},
+                                       self.n_init, self.rng.randint(0, 1 << 30))
+            uniq = {self.space.key(p): p for p in init}
+            self._evaluate(list(uniq.values()))
+            while len(self.obs) + len(self.failed) < self.budget:
+                props = self.propose(min(self.batch, self.budget - len(self.obs) - len(self.failed)))
+                if not props:
+                    break
+                self._evaluate(props)
+            self._fit()
+            self.state = "done"
+        except Exception as e:
+            self.state = "error"
+            self.error = str(e)
+        return self.result()
+
+    # ---------- reporting ----------
+    def result(self):
+        with self._lock:
+            obs = list(self.obs.values())
+        if not obs or self.gp is None:
+            return {"opt_id": self.opt_id, "state": self.state, "error": self.error, "evaluated": len(obs),
+                    "failed": len(self.failed)}
+        rows = []
+        for o in obs:
+            mu, sd = self.gp.predict(self.space.to_unit(o["point"]))
+            ys = o["ys"]
+            m = statistics.fmean(ys)
+            se = statistics.stdev(ys) / math.sqrt(len(ys)) if len(ys) > 1 else 0.0
+            rows.append({"point": o["point"], "gp_mean": mu, "gp_sd": sd,
+                         "mean": m, "se": se, "n": len(ys)})
+        # rank by posterior mean: less fooled by one lucky replication than the raw mean
+        rows.sort(key=lambda r: -r["gp_mean"])
+        b = rows[0]
+        best_key = self.space.key(b["point"])
+        order = list(dict.fromkeys(self.space.key(p) for _, p, _ in self.history))
+        return {
+            "opt_id": self.opt_id,
+            "state": self.state,
+            "error": self.error,
+            "response": self.response,
+            "evaluated": len(obs),
+            "failed": len(self.failed),
+            "simulations": sum(r["n"] for r in rows),
+            "grid_size": self.space.size(),
+            "evaluations_to_best": order.index(best_key) + 1 if best_key in order else None,
+            "best": {
+                "params": b["point"],
+                "gp_mean": b["gp_mean"],
+                "ci95": [b["gp_mean"] - Z95 * b["gp_sd"], b["gp_mean"] + Z95 * b["gp_sd"]],
+                "replications_mean": b["mean"],
+                "replications_ci95": [b["mean"] - Z95 * b["se"], b["mean"] + Z95 * b["se"]],
+                "n": b["n"],
+            },
+            "top": rows[:10],
+        }
+
+    def status(self):
+        r = self.result()
+        r["rounds"] = self.rounds
+        r["budget"] = self.budget
+        r["table"] = format_result(r)
+        return r
+
+
+def compare_with_grid(opt):
+    """
+    Exhaustive check of a finished run: evaluate the rest of the grid with
+    the same seeds (replications are deterministic per seed, so the points
+    already evaluated are reused) and rank the optimiser's pick by the
+    replication mean.
+    """
+    r = opt.result()
+    if "best" not in r:
+        raise RuntimeError("the optimisation has no result to compare")
+    if opt.space.size() > MAX_CANDIDATES:
+        raise ValueError(f"grid of {opt.space.size()} configurations is too large to search exhaustively")
+    means = {k: (o["point"], statistics.fmean(o["ys"])) for k, o in opt.obs.items()}
+    rest = [c for c in opt.space.candidates(opt.rng) if opt.space.key(c) not in means]
+    if rest:
+        run = doe.DoeRun(rest, horizon_s=opt.horizon_s, seeds=opt.seeds, step_ms=opt.step_ms,
+                         workers=opt.workers, record=opt.record, runs_log=opt.runs_log,
+                         meta={"doe_id": f"{opt.opt_id}-grid"})
+        ys = {}
+        for res in run.run():
+            if res.get("ok"):
+                ys.setdefault(opt.space.key(res["point"]), (res["point"], []))[1].append(
+                    float(res["kpis"].get(opt.response, 0.0)))
+        means.update({k: (p, statistics.fmean(v)) for k, (p, v) in ys.items()})
+    ranked = sorted(means.values(), key=lambda t: -t[1])
+    pick = opt.space.key(r["best"]["params"])
+    rank = 1 + sum(m > means[pick][1] for _, m in ranked)   # ties share a rank
+    return {
+        "grid_evaluations": len(means),
+        "grid_best": {"params": ranked[0][0], "mean": ranked[0][1]},
+        "pick_rank": rank,
+        "pick_gap": ranked[0][1] - means[pick][1],
+        "evaluations_to_best": r["evaluations_to_best"],
+    }
+
+
+def format_result(r):
+    if "best" not in r:
+        return f"{r.get('state', '')}: {r.get('evaluated', 0)} configurations evaluated"
+    b = r["best"]
+    lines = [f"{r['evaluated']} configurations / {r['simulations']} simulations (grid {r['grid_size']}), "
+             f"best found after {r['evaluations_to_best']}",
+             f"Best {r['response']}: {b['gp_mean']:.3f}  95% CI [{b['ci95'][0]:.3f}, {b['ci95'][1]:.3f}]"
+             f"  (replications {b['replications_mean']:.3f}, n={b['n']})",
+             f"  params: {json.dumps(b['params'])}",
+             "",
+             f"  {'gp_mean':>9}{'gp_sd':>8}{'mean':>9}{'se':>8}  params"]
+    for row in r["top"]:
+        lines.append(f"  {row['gp_mean']:>9.3f}{row['gp_sd']:>8.3f}{row['mean']:>9.3f}{row['se']:>8.3f}  "
+                     f"{json.dumps(row['point'])}")
+    return "\n".join(lines)
+
+
+# ============================================================
+# Background runs for the dashboard
+# ============================================================
+_slot = JobSlot("an optimisation")
+
+
+def start_in_thread(spec):
+    space = {k: tuple(v) for k, v in (spec.get("space") or DEFAULT_SPACE).items()}
+    opt = Optimizer(space,
+                    budget=int(spec.get("budget", DEFAULT_BUDGET)),
+                    batch=int(spec.get("batch", DEFAULT_BATCH)),
+                    n_init=int(spec.get("n_init", DEFAULT_N_INIT)),
+                    seeds=spec.get("seeds") or doe.DEFAULT_SEEDS,
+                    horizon_s=float(spec.get("horizon_s", doe.DEFAULT_HORIZON_S)),
+                    workers=spec.get("workers"))
+    return _slot.start(opt)
+
+
+def current_status():
+    opt = _slot.current()
+    return opt.status() if opt is not None else {"state": "idle"}
+
+
+# ============================================================
+# CLI
+# ============================================================
+def main(argv=None):
+    ap = argparse.ArgumentParser(description="Bayesian optimisation of line settings")
+    ap.add_argument("--space", action="append", default=[], help="name=lo:hi (integer), e.g. reset_pulse_ticks=1:6")
+    ap.add_argument("--budget", type=int, default=DEFAULT_BUDGET, help="distinct configurations to evaluate")
+    ap.add_argument("--batch", type=int, default=DEFAULT_BATCH)
+    ap.add_argument("--n-init", type=int, default=DEFAULT_N_INIT)
+    ap.add_argument("--horizon", type=float, default=doe.DEFAULT_HORIZON_S)
+    ap.add_argument("--step-ms", type=float, default=None)
+    ap.add_argument("--seeds", default=",".join(str(s) for s in doe.DEFAULT_SEEDS))
+    ap.add_argument("--workers", type=int, default=None)
+    ap.add_argument("--response", choices=doe.RESPONSES, default="throughput_per_min")
+    ap.add_argument("--rng-seed", type=int, default=0)
+    ap.add_argument("--out", default="opt_result.json")
+    ap.add_argument("--runs-log", default=None, help="run store log to append to (default: the dashboard's)")
+    ap.add_argument("--no-record", action="store_true", help="do not add the runs to the run store log")
+    ap.add_argument("--vs-grid", action="store_true",
+                    help="afterwards evaluate the whole grid and rank the pick against it (exhaustive search)")
+    a = ap.parse_args(argv)
+
+    space = {}
+    for s in a.space:
+        name, _, rng = s.partition("=")
+        lo, hi = rng.split(":", 1)
+        space[name.strip()] = (int(lo), int(hi))
+    seeds = [int(s) for s in a.seeds.split(",") if s.strip()]
+
+    runs_log = None
+    if not a.no_record:
+        import opt_dashboard
+        runs_log = a.runs_log or opt_dashboard.RUNS_LOG_PATH
+    opt = Optimizer(space or None, a.budget, a.batch, a.n_init, seeds, a.horizon, a.step_ms, a.workers,
+                    a.response, a.rng_seed, record=not a.no_record, runs_log=runs_log)
+    print(f"Optimising {a.response} over {opt.space.bounds} (grid {opt.space.size()}), "
+          f"budget {opt.budget} configurations x {len(seeds)} seeds")
+    t0 = time.perf_counter()
+    r = opt.run()
+    print(f"Done in {time.perf_counter() - t0:.1f}s ({opt.rounds} rounds)\n")
+    print(format_result(r))
+    if a.vs_grid and opt.state == "done":
+        g = compare_with_grid(opt)
+        r["vs_grid"] = g
+        print(f"\nExhaustive search: {g['grid_evaluations']} configurations, best "
+              f"{json.dumps(g['grid_best']['params'])} at {g['grid_best']['mean']:.3f}")
+        print(f"  pick ranks {g['pick_rank']} of {g['grid_evaluations']} (gap {g['pick_gap']:.3f}), "
+              f"found after {g['evaluations_to_best']} of {opt.budget} evaluations")
+    with open(a.out, "w", encoding="utf-8") as f:
+        json.dump(r, f, indent=2)
+    print(f"\nResult written to {a.out}")
+    return 0 if opt.state == "done" else 1
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())
@@ -0,0 +1,443 @@
+# pythonGateways/queueing_approx.py
+"""
+Analytic model of the S1..S6 line for instant what-if answers.
+
+Each station is reduced to the mean and SCV (squared coefficient of
+variation) of its effective process time, worked out in closed form from
+the station module constants: processing steps, rework/retry branches,
+ST5 faults (ST5_P_FAULT, one fresh attempt after fault_recovery_s as in
+maxplus_line), ST6 step repairs (ST6_STEPS, the _repair() delays) and ST6
+stock refills.
+
+Under the PLC's controller (controller="serial", the default) one unit is
+in the line at a time, so a unit takes the sum of the station means (each
+with the hand-off, maxplus_line.SERIAL_HANDOFF_S by default) and that is
+the whole answer: throughput 1 / sum, WIP 1, a station idle whenever
+another one works. Buffer capacities have no effect.
+
+For the idealised pipelined line (controller="pipelined", maxplus_line's
+other controller; not comparable with recorded runs) the line is split
+into five two-machine lines, one per buffer. Each
+is a birth-death chain of the units between its two pseudo-machines
+(b + 2 places with blocking after service); its capacity is stretched by
+2 / (c_u^2 + c_d^2) when the two stations vary less than exponential ones,
+so that steady stations need less buffer. The pseudo-machine rates are
+found by the usual forward/backward sweeps on
+
+    1/mu_u(i) + 1/mu_d(i-1) = 1/mu(i) + 1/TH(i-1)
+
+A solve takes tens of microseconds, so the dashboard can call it on every
+slider move:
+
+    m = station_moments(params={"ST5_P_FAULT": 0.02}, fault_recovery_s=10, handoff_s=5.4)
+    r = approximate(m)                           # serial: throughput, lead time, utilisation
+    r = approximate(station_moments(), caps={"S3_to_S4": 3}, controller="pipelined")
+    accuracy([{"S3_to_S4": 1}, {"S3_to_S4": 4}], n=200_000)   # pipelined, vs maxplus_line
+    compare_runs(runs)                           # serial, vs recorded runs
+
+    python queueing_approx.py --set ST5_P_FAULT=0.02
+    python queueing_approx.py --controller pipelined --caps S3_to_S4=3
+    python queueing_approx.py --accuracy --n 200000
+
+accuracy() checks the pipelined decomposition against the exact max-plus
+simulation of the same idealised line. compare_runs() checks the serial
+model against recorded headless/DOE runs, counting the PLC's completed
+units (units_completed) over the simulated time.
+"""
+import argparse
+import json
+import sys
+import time
+
+import mc_kernels
+from maxplus_line import CONTROLLERS, SERIAL_HANDOFF_S
+
+STATIONS = ["S1", "S2", "S3", "S4", "S5", "S6"]
+BUFFERS = ["S1_to_S2", "S2_to_S3", "S3_to_S4", "S4_to_S5", "S5_to_S6"]
+
+MAX_ITER = 100
+TOL = 1e-9          # relative change in the block throughputs
+
+
+# ---------------- station moments ----------------
+def _branch(p, mean, var=0.0, fault=False):
+    """One outcome of a station cycle: (probability, E[T], E[T^2], faults)."""
+    return (float(p), float(mean), float(var) + float(mean) ** 2, bool(fault))
+
+
+def _uniform_clipped(lo, hi, floor):
+    """E[X], E[X^2] of max(floor, U(lo, hi))."""
+    if floor <= lo or hi <= lo:
+        lo = max(lo, floor)
+        hi = max(hi, floor)
+        return (lo + hi) / 2.0, (lo * lo + lo * hi + hi * hi) / 3.0
+    if floor >= hi:
+        return floor, floor * floor
+    w = hi - lo
+    p_floor = (floor - lo) / w
+    m1 = floor * p_floor + (hi ** 2 - floor ** 2) / (2.0 * w)
+    m2 = floor ** 2 * p_floor + (hi ** 3 - floor ** 3) / (3.0 * w)
+    return m1, m2
+
+
+def _st1(m, recipe_id):
+    return [_branch(1.0, m.ST1_NOMINAL_CYCLE_S)], 1.0
+
+
+def _st2(m, recipe_id):
+    base = m.ST2_BASE_TIME_RECIPE1_S if int(recipe_id) == 1 else m.ST2_BASE_TIME_S
+    m1, m2 = _uniform_clipped(base * (1.0 - m.ST2_JITTER), base * (1.0 + m.ST2_JITTER), m.ST2_MIN_CYCLE_S)
+    return [_branch(1.0, m1, m2 - m1 * m1)], 1.0 - m.ST2_P_SCRAP
+
+
+def _st3(m, recipe_id):
+    c = (m.T_MOUNT_PSU_S + m.T_MOUNT_BOARD_S + m.T_MOUNT_SCREEN_S
+         + m.T_ROUTE_CABLES_S + m.T_STRAIN_RELIEF_S + m.T_CONTINUITY_TEST_S)
+    p_rework = 1.0 - m.P_STRAIN_OK * m.P_CONTINUITY_OK
+    p_retest = (min(m.P_STRAIN_REWORK_CAP, m.P_STRAIN_OK + m.P_STRAIN_REWORK_GAIN)
+                * min(m.P_CONTINUITY_REWORK_CAP, m.P_CONTINUITY_OK + m.P_CONTINUITY_REWORK_GAIN))
+    extra = m.T_REWORK_S + m.T_CONTINUITY_TEST_S
+    return [_branch(1.0 - p_rework, c),
+            _branch(p_rework * p_retest, c + extra),
+            _branch(p_rework * (1.0 - p_retest), c + extra, fault=True)], 1.0
+
+
+def _st4(m, recipe_id):
+    c = m.T_MOTION_S + m.T_THERMAL_S + m.T_CALIBRATION_S + m.T_TESTPRINT_S
+    p_retry = 1.0 - m.P_PASS
+    return [_branch(m.P_PASS, c),
+            _branch(p_retry * m.P_PASS_AFTER_RETRY, c + m.T_RETRY_S),
+            _branch(p_retry * (1.0 - m.P_PASS_AFTER_RETRY), c + m.T_RETRY_S, fault=True)], 1.0
+
+
+def _st5(m, recipe_id):
+    c = m.ST5_T_CAPTURE_S + m.ST5_T_COMPUTE_S + m.ST5_T_COMPARE_S + m.ST5_T_DIVERT_S
+    pf = m.ST5_P_FAULT
+    pa = m._st5_accept_rate(recipe_id)
+    recovered = min(m.ST5_RECHECK_CAP, pa + m.ST5_RECHECK_GAIN)
+    good = pf + (1.0 - pf) * (pa + (1.0 - pa) * recovered)
+    return [_branch(pf, m.ST5_T_FAULT_S, fault=True),
+            _branch((1.0 - pf) * pa, c),
+            _branch((1.0 - pf) * (1.0 - pa), c + m.ST5_T_WIPE_S + m.ST5_T_RECOMPUTE_S)], good
+
+
+def _st6(m, recipe_id):
+    mean = var = 0.0
+    for p_fault, repair_s, operate_s in m.ST6_STEPS.values():
+        mean += operate_s + p_fault * repair_s
+        var += p_fault * (1.0 - p_fault) * repair_s ** 2
+    # long-run share of units that wait for a refill of every material
+    r = 1.0 / max(1, int(m.ST6_STOCK_REFILL))
+    refill = sum(m.ST6_REFILL_S.values())
+    mean += r * refill
+    var += r * (1.0 - r) * refill ** 2
+    return [_branch(1.0, mean, var)], 1.0
+
+
+_MOMENTS = {"S1": _st1, "S2": _st2, "S3": _st3, "S4": _st4, "S5": _st5, "S6": _st6}
+
+
+def _effective(branches, fault_recovery_s, handoff_s):
+    """Mean and SCV of the process time, a faulted attempt adding recovery + one fresh attempt."""
+    h = float(handoff_s)
+    shifted = [(p, m1 + h, m2 + 2.0 * h * m1 + h * h, f) for p, m1, m2, f in branches]
+    ex = sum(p * m1 for p, m1, _, _ in shifted)
+    ex2 = sum(p * m2 for p, _, m2, _ in shifted)
+    r = float(fault_recovery_s)
+    t1 = t2 = 0.0
+    for p, m1, m2, fault in shifted:
+        if fault:
+            t1 += p * (m1 + r + ex)
+            t2 += p * (m2 + 2.0 * r * m1 + r * r + 2.0 * (m1 + r) * ex + ex2)
+        else:
+            t1 += p * m1
+            t2 += p * m2
+    var = max(0.0, t2 - t1 * t1)
+    return t1, (var / (t1 * t1) if t1 > 0 else 0.0)
+
+
+def station_moments(recipe_id=0, params=None, fault_recovery_s=0.0, handoff_s=0.0):
+    """{station: {"mean_s", "scv", "good"}} from the station module constants (params override them)."""
+    per_station = mc_kernels._split_params(params)
+    out = {}
+    for st in STATIONS:
+        with mc_kernels._constants(st, per_station.get(st)) as mod:
+            branches, good = _MOMENTS[st](mod, recipe_id)
+        mean, scv = _effective(branches, fault_recovery_s, handoff_s)
+        out[st] = {"mean_s": mean, "scv": scv, "good": good}
+    return out
+
+
+# ---------------- decomposition ----------------
+def _block(mu_u, mu_d, k):
+    """Two-machine line with k places: (throughput, P(starved), P(blocked), E[n])."""
+    rho = mu_u / mu_d
+    if abs(rho - 1.0) < 1e-9:
+        p0 = 1.0 / (k + 1.0)
+        return mu_d * (1.0 - p0), p0, p0, k / 2.0
+    if rho < 1.0:
+        tail = rho ** (k + 1.0)
+        p0 = (1.0 - rho) / (1.0 - tail)
+        pk = p0 * rho ** k
+        n = rho / (1.0 - rho) - (k + 1.0) * tail / (1.0 - tail)
+    else:
+        # same chain seen from the full end, so rho**k cannot overflow
+        s = 1.0 / rho
+        tail = s ** (k + 1.0)
+        pk = (1.0 - s) / (1.0 - tail)
+        p0 = pk * s ** k
+        n = k - (s / (1.0 - s) - (k + 1.0) * tail / (1.0 - tail))
+    return mu_d * (1.0 - p0), p0, pk, n
+
+
+def _buffered(blk, k_real, k_eff):
+    """
+    Mean buffer content of a block. The empty and full ends keep their
+    probabilities; the partly filled states of the stretched chain are
+    mapped back onto the real ones in between.
+    """
+    _, p0, pk, n = blk
+    mid = 1.0 - p0 - pk
+    if mid <= 1e-12 or k_real <= 2.0:
+        return pk * (k_real - 2.0)
+    n_mid = (n - k_eff * pk) / mid
+    if k_eff > 2.0:
+        n_mid = 1.0 + (n_mid - 1.0) * (k_real - 2.0) / (k_eff - 2.0)
+    else:
+        n_mid *= k_real / k_eff
+    n_mid = min(k_real - 1.0, max(1.0, n_mid))
+    # n counts the downstream station's unit and the blocked upstream one
+    return mid * (n_mid - 1.0) + pk * (k_real - 2.0)
+
+
+def _caps_list(caps):
+    if caps is None or isinstance(caps, dict):
+        import maxplus_line
+        return maxplus_line._caps_list(caps)
+    return [max(0, int(c)) for c in caps]
+
+
+def _serial(moments, t0):
+    """One unit in the line: every station works in turn, the others wait."""
+    means = [moments[st]["mean_s"] for st in STATIONS]
+    cycle = sum(means)
+    th = 1.0 / cycle if cycle > 0 else 0.0
+    good = 1.0
+    for st in STATIONS:
+        good *= moments[st]["good"]
+    stations = {}
+    for i, st in enumerate(STATIONS):
+        util = 100.0 * means[i] * th
+        stations[st] = {"mean_s": means[i], "scv": moments[st]["scv"],
+                        "utilization_pct": util, "idle_pct": 100.0 - util}
+    tph = 3600.0 * th
+    return {
+        "controller": "serial",
+        "caps": None,
+        "throughput_per_hour": tph,
+        "good_per_hour": tph * good,
+        "yield": good,
+        "wip": 1.0,
+        "lead_time_s": cycle,
+        "stations": stations,
+        "bottleneck": max(STATIONS, key=lambda st: stations[st]["utilization_pct"]),
+        "iterations": 0,
+        "elapsed_us": 1e6 * (time.perf_counter() - t0),
+    }
+
+
+def approximate(moments=None, caps=None, controller="serial", **kw):
+    """
+    Throughput, WIP, lead time and per-station shares under controller:
+    utilisation/idle for the serial line, utilisation/blocked/starved for
+    one buffer setting (caps) of the pipelined one. moments defaults to
+    station_moments(**kw), with the serial hand-off unless kw sets one.
+    """
+    if controller not in CONTROLLERS:
+        raise ValueError(f"unknown controller {controller!r} (one of {', '.join(CONTROLLERS)})")
+    t0 = time.perf_counter()
+    if moments is None:
+        if controller == "serial":
+            kw.setdefault("handoff_s", SERIAL_HANDOFF_S)
+        moments = station_moments(**kw)
+    if controller == "serial":
+        return _serial(moments, t0)
+    caps_l = _caps_list(caps)
+    M = len(STATIONS)
+    mu = [1.0 / moments[st]["mean_s"] for st in STATIONS]
+    scv = [moments[st]["scv"] for st in STATIONS]
+    # places per block: b in the buffer, one in the downstream station, one blocked upstream,
+    # stretched to the exponential chain with about the same congestion (never shrunk:
+    # two-point repair delays are far from exponential and shrinking overshoots)
+    k_real = [caps_l[i] + 2.0 for i in range(M - 1)]
+    k_eff = [k_real[i] * max(1.0, 2.0 / max(1e-6, scv[i] + scv[i + 1])) for i in range(M - 1)]
+
+    mu_u = mu[:-1]
+    mu_d = mu[1:]
+    blk = [_block(mu_u[i], mu_d[i], k_eff[i]) for i in range(M - 1)]
+    iters = 0
+    for iters in range(1, MAX_ITER + 1):
+        prev = [b[0] for b in blk]
+        for i in range(1, M - 1):
+            mu_u[i] = 1.0 / max(1.0 / mu[i], 1.0 / mu[i] + 1.0 / blk[i - 1][0] - 1.0 / mu_d[i - 1])
+            blk[i] = _block(mu_u[i], mu_d[i], k_eff[i])
+        for i in range(M - 3, -1, -1):
+            mu_d[i] = 1.0 / max(1.0 / mu[i + 1], 1.0 / mu[i + 1] + 1.0 / blk[i + 1][0] - 1.0 / mu_u[i + 1])
+            blk[i] = _block(mu_u[i], mu_d[i], k_eff[i])
+        if max(abs(b[0] - p) / p for b, p in zip(blk, prev)) < TOL:
+            break
+
+    th = sum(b[0] for b in blk) / len(blk)
+    blocked = [blk[i][2] for i in range(M - 1)] + [0.0]
+    starved = [0.0] + [blk[i][1] for i in range(M - 1)]
+    # a station holds a unit while busy or blocked; the rest of each block is buffer
+    wip = sum(min(1.0, th / mu[i]) + blocked[i] for i in range(M))
+    wip += sum(_buffered(b, k_real[i], k_eff[i]) for i, b in enumerate(blk))
+    good = 1.0
+    for st in STATIONS:
+        good *= moments[st]["good"]
+    stations = {}
+    for i, st in enumerate(STATIONS):
+        stations[st] = {
+            "mean_s": moments[st]["mean_s"],
+            "scv": scv[i],
+            "utilization_pct": 100.0 * min(1.0, th / mu[i]),
+            "blocked_pct": 100.0 * blocked[i],
+            "starved_pct": 100.0 * starved[i],
+        }
+    tph = 3600.0 * th
+    return {
+        "controller": "pipelined",
+        "caps": dict(zip(BUFFERS, caps_l)),
+        "throughput_per_hour": tph,
+        "good_per_hour": tph * good,
+        "yield": good,
+        "wip": wip,
+        "lead_time_s": wip / th if th > 0 else 0.0,
+        "stations": stations,
+        "bottleneck": max(STATIONS, key=lambda st: stations[st]["utilization_pct"]),
+        "iterations": iters,
+        "elapsed_us": 1e6 * (time.perf_counter() - t0),
+    }
+
+
+# ---------------- accuracy ----------------
+def _err_pct(approx, ref):
+    return 100.0 * (approx - ref) / ref if ref else None
+
+
+def accuracy(cases=None, n=200_000, seed=1, recipe_id=0, params=None, fault_recovery_s=0.0, handoff_s=0.0):
+    """
+    Pipelined decomposition vs the max-plus simulation of the same line, for
+    each buffer setting in cases (default: the PLC setting and 0..4 slots
+    everywhere).
+    """
+    import maxplus_line
+    if cases is None:
+        cases = [None] + [[b] * len(BUFFERS) for b in range(5)]
+    moments = station_moments(recipe_id, params, fault_recovery_s, handoff_s)
+    times = maxplus_line.sample_times(n, recipe_id, seed, params, fault_recovery_s, handoff_s)
+    rows = []
+    for caps in cases:
+        a = approximate(moments, caps, "pipelined")
+        s = maxplus_line.evaluate(times, caps, controller="pipelined")
+        rows.append({
+            "caps": a["caps"],
+            "throughput_per_hour": {"approx": a["throughput_per_hour"], "sim": s["throughput_per_hour"],
+                                    "err_pct": _err_pct(a["throughput_per_hour"], s["throughput_per_hour"])},
+            "wip": {"approx": a["wip"], "sim": s["wip"], "err_pct": _err_pct(a["wip"], s["wip"])},
+            "bottleneck": {"approx": a["bottleneck"], "sim": s["bottleneck"]},
+            "approx_us": a["elapsed_us"],
+            "sim_s": s["elapsed_s"],
+        })
+    return _report(rows, n=n)
+
+
+def _run_units_per_hour(summary):
+    """Completed units per hour of a recorded run (PLC count, unaffected by line resets)."""
+    units, t_s = summary.get("units_completed"), summary.get("sim_time_s")
+    if units is None or not t_s:
+        return None
+    return 3600.0 * float(units) / float(t_s)
+
+
+def compare_runs(runs, moments=None, **kw):
+    """
+    Serial model vs recorded runs (opt_dashboard run store entries). Runs
+    recorded before the summary carried units_completed are skipped.
+    """
+    if moments is None:
+        kw.setdefault("handoff_s", SERIAL_HANDOFF_S)
+        moments = station_moments(**kw)
+    a = approximate(moments)
+    rows = []
+    for r in runs:
+        sim = _run_units_per_hour(r.get("summary") or {})
+        if not sim:
+            continue
+        rows.append({
+            "run_id": r.get("run_id"),
+            "throughput_per_hour": {"approx": a["throughput_per_hour"], "sim": sim,
+                                    "err_pct": _err_pct(a["throughput_per_hour"], sim)},
+            "approx_us": a["elapsed_us"],
+        })
+    return _report(rows, runs=len(rows))
+
+
+def _report(rows, **extra):
+    errs = [abs(r["throughput_per_hour"]["err_pct"]) for r in rows
+            if r["throughput_per_hour"]["err_pct"] is not None]
+    out = dict(extra)
+    out["cases"] = rows
+    out["throughput_abs_err_pct"] = {
+        "mean": sum(errs) / len(errs) if errs else None,
+        "max": max(errs) if errs else None,
+    }
+    return out
+
+
+def _parse_caps(text):
+    caps = {}
+    for item in (text or "").split(","):
+        if item.strip():
+            name, _, value = item.partition("=")
+            caps[name.strip()] = int(value)
+    return caps
+
+
+def main(argv=None):
+    ap = argparse.ArgumentParser(description="Analytic throughput/WIP approximation for the S1..S6 line")
+    ap.add_argument("--recipe", type=int, default=0)
+    ap.add_argument("--controller", choices=CONTROLLERS, default="serial",
+                    help="serial: the PLC as it runs; pipelined: idealised line with buffers")
+    ap.add_argument("--caps", default="", help="pipelined only, e.g. S3_to_S4=3,S4_to_S5=1 (others BUF_MAX)")
+    ap.add_argument("--set", action="append", default=[], metavar="CONST=VALUE",
+                    help="override a station module constant (see mc_kernels)")
+    ap.add_argument("--handoff-s", type=float, default=None,
+                    help=f"fixed delay added to every station start (default {SERIAL_HANDOFF_S} serial, 0 pipelined)")
+    ap.add_argument("--fault-recovery-s", type=float, default=0.0)
+    ap.add_argument("--accuracy", action="store_true",
+                    help="pipelined decomposition vs maxplus_line over a set of buffers")
+    ap.add_argument("--n", type=int, default=200_000, help="units simulated for --accuracy")
+    ap.add_argument("--seed", type=int, default=1)
+    a = ap.parse_args(argv)
+
+    params = {}
+    for item in a.set:
+        name, _, value = item.partition("=")
+        params[name.strip()] = mc_kernels._parse_value(value.strip())
+
+    serial = a.controller == "serial" and not a.accuracy
+    handoff_s = a.handoff_s if a.handoff_s is not None else (SERIAL_HANDOFF_S if serial else 0.0)
+    kw = {"recipe_id": a.recipe, "params": params, "fault_recovery_s": a.fault_recovery_s, "handoff_s": handoff_s}
+    if a.accuracy:
+        cases = [None, _parse_caps(a.caps)] if a.caps else None
+        res = accuracy(cases, n=a.n, seed=a.seed, **kw)
+    else:
+        res = approximate(station_moments(**kw), _parse_caps(a.caps), a.controller)
+    print(json.dumps(res, indent=2))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
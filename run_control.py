@@ -0,0 +1,287 @@
+# pythonGateways/run_control.py
+"""
+Sequential run-length control: stop once the steady-state KPIs are known to
+the requested relative precision instead of guessing totalSimulationTime.
+
+Within one run the PLC (--target-precision 0.05) checks its
+steady_state_summary() every CHECK_EVERY_S of simulated time and ends the
+simulation, the same terminate() as any early exit, once the warm-up has
+settled and every chosen KPI has a 95% half-width / mean at or below the
+target over at least MIN_UNITS post-warm-up units. Across replications,
+independent runs of a fixed horizon are added until the t interval over
+their steady-state means is that tight.
+
+MIN_UNITS guards the batch-means interval against too few observations,
+but the serial line makes only about 26-29 units an hour, so the default
+100 means roughly 3.5 h of line time after the warm-up before a run can
+stop at all. --min-units (here and on the PLC) trades that guard for
+earlier stops, e.g. 40 for short what-if runs; below 2 x N_BATCHES
+(steady_state) every batch is a single unit and the interval is weak.
+
+    r = sequential_run(0.05, max_horizon_s=8 * 3600, seed=1, min_units=40)
+    r["stopped_at_s"], r["saved"]["sim_pct"], r["kpis"]["throughput_per_min"]["ci95"]
+    r = replications(0.02, horizon_s=3600, max_reps=30)
+
+    python run_control.py run --target 0.05 --max-horizon 28800 --seed 1 --min-units 40
+    python run_control.py reps --target 0.02 --horizon 3600 --max-reps 30 --kpi cycle_time_s
+
+Compute saved is reported against the fixed budget the run would otherwise
+have used (max_horizon_s, or max_reps x horizon_s); the wall-clock figure
+scales the measured sim/wall rate to that budget.
+"""
+import argparse
+import json
+import math
+import multiprocessing as mp
+import os
+import statistics
+import sys
+import time
+from collections import deque
+
+from steady_state import t975
+
+KPIS = ("throughput_per_min", "cycle_time_s", "yield_pct")
+DEFAULT_KPIS = ("throughput_per_min",)
+CHECK_EVERY_S = 60.0            # simulated seconds between checks within a run
+MIN_UNITS = 100                 # post-warm-up observations before a within-run interval counts
+MIN_REPS = 3
+DEFAULT_MAX_HORIZON_S = 8 * 3600.0
+DEFAULT_MAX_REPS = 30
+
+
+def check_kpis(kpis):
+    kpis = tuple(kpis or DEFAULT_KPIS)
+    for k in kpis:
+        if k not in KPIS:
+            raise ValueError(f"unknown KPI {k!r} (one of {', '.join(KPIS)})")
+    return kpis
+
+
+def precision_met(ss, target, kpis=DEFAULT_KPIS, min_units=MIN_UNITS):
+    """(met, {kpi: relative half-width}) for a steady_state summary."""
+    rel = {k: (ss.get(k) or {}).get("rel_precision") for k in kpis}
+    met = bool((ss.get("warmup") or {}).get("settled")) and all(
+        r is not None and r <= target and (ss[k].get("n") or 0) >= min_units for k, r in rel.items())
+    return met, rel
+
+
+def savings(used_s, budget_s, wall_s):
+    saved = max(0.0, budget_s - used_s)
+    return {
+        "budget_sim_s": budget_s,
+        "used_sim_s": used_s,
+        "sim_s": saved,
+        "sim_pct": 100.0 * saved / budget_s if budget_s > 0 else 0.0,
+        "wall_s_est": wall_s * saved / used_s if used_s > 0 else 0.0,
+    }
+
+
+class PrecisionMonitor:
+    """Within-run stopping rule; the PLC calls check() once per scan."""
+
+    def __init__(self, target, kpis=DEFAULT_KPIS, check_every_s=CHECK_EVERY_S, min_units=MIN_UNITS):
+        if not target > 0:
+            raise ValueError("target precision must be > 0")
+        self.target = float(target)
+        self.kpis = check_kpis(kpis)
+        self.check_every_s = float(check_every_s)
+        self.min_units = int(min_units)
+        if self.min_units < 1:
+            raise ValueError("min_units must be >= 1")
+        self.next_s = None
+        self.trace = deque(maxlen=1000)     # (t_s, {kpi: rel_precision})
+        self.report = None
+
+    def check(self, now_s, summary_fn):
+        if self.report is not None:
+            return True
+        if self.next_s is not None and now_s < self.next_s:
+            return False
+        self.next_s = now_s + self.check_every_s
+        ss = summary_fn()
+        met, rel = precision_met(ss, self.target, self.kpis, self.min_units)
+        self.trace.append((now_s, rel))
+        if met:
+            self.report = {"stopped_at_s": now_s, "target": self.target, "warmup": ss["warmup"],
+                           "kpis": {k: ss[k] for k in self.kpis}}
+        return met
+
+    def describe(self):
+        if self.report is None:
+            return "not reached"
+        return ", ".join(f"{k} {v['mean']:.4g} +/- {v['half_width']:.3g}"
+                         for k, v in self.report["kpis"].items())
+
+
+# ============================================================
+# Within one run
+# ============================================================
+def sequential_run(target, kpis=DEFAULT_KPIS, max_horizon_s=DEFAULT_MAX_HORIZON_S, seed=None,
+                   params=None, min_units=MIN_UNITS, **line_kwargs):
+    """Headless run that the PLC stops at the target precision (or at max_horizon_s)."""
+    import headless_line
+    kpis = check_kpis(kpis)
+    plc_args = dict(line_kwargs.pop("plc_args", None) or {})
+    plc_args.update(target_precision=float(target), precision_kpis=",".join(kpis), min_units=int(min_units))
+    line_kwargs.setdefault("quiet", "mute")
+    line = headless_line.HeadlessLine(horizon_s=max_horizon_s, seed=seed, params=params,
+                                      plc_args=plc_args, **line_kwargs)
+    res = line.run()
+    mon = line.plc._precision
+    ss = res["kpis"].get("steady_state") or {}
+    return {
+        "mode": "run",
+        "target": float(target),
+        "kpis_checked": list(kpis),
+        "min_units": mon.min_units,
+        "reached": mon.report is not None,
+        "stopped_at_s": res["sim_s"],
+        "saved": savings(res["sim_s"], float(max_horizon_s), res["wall_s"]),
+        "warmup": ss.get("warmup"),
+        "kpis": {k: ss.get(k) for k in KPIS},
+        "naive_throughput_per_min": res["kpis"].get("throughput_per_min"),
+        "trace": [{"t_s": t, "rel_precision": rel} for t, rel in mon.trace],
+        "seed": res["seed"],
+        "wall_s": res["wall_s"],
+        "errors": res["errors"],
+    }
+
+
+# ============================================================
+# Across replications
+# ============================================================
+def replication_job(job):
+    """job = (seed, horizon_s, params, step_ms) -> steady-state means of one run (pool worker)."""
+    seed, horizon_s, params, step_ms = job
+    import headless_line
+    kw = {"horizon_s": horizon_s, "seed": seed, "quiet": "devnull", "params": params}
+    if step_ms:
+        kw["step_ms"] = step_ms
+    t0 = time.perf_counter()
+    try:
+        res = headless_line.HeadlessLine(**kw).run()
+    except Exception as e:
+        return {"seed": seed, "ok": False, "error": str(e), "wall_s": time.perf_counter() - t0}
+    ss = res["kpis"].get("steady_state") or {}
+    warm = ss.get("warmup") or {}
+    return {
+        "seed": seed,
+        "ok": True,
+        "sim_s": res["sim_s"],
+        "wall_s": res["wall_s"],
+        "warmup_s": warm.get("truncated_s"),
+        "settled": bool(warm.get("settled")),
+        "kpis": {k: (ss.get(k) or {}).get("mean") for k in KPIS},
+        "errors": len(res["errors"]),
+    }
+
+
+def across(results, kpis=KPIS):
+    """Mean and 95% t interval of each KPI over the replications' steady-state means."""
+    out = {}
+    for k in kpis:
+        xs = [r["kpis"][k] for r in results if r.get("ok") and r["kpis"].get(k) is not None]
+        n = len(xs)
+        mean = statistics.fmean(xs) if xs else 0.0
+        half = t975(n - 1) * statistics.stdev(xs) / math.sqrt(n) if n >= 2 else None
+        out[k] = {
+            "mean": mean,
+            "ci95": [mean - half, mean + half] if half is not None else [None, None],
+            "half_width": half,
+            "rel_precision": half / abs(mean) if half is not None and mean else None,
+            "n": n,
+        }
+    return out
+
+
+def replications(target, kpis=DEFAULT_KPIS, horizon_s=3600.0, min_reps=MIN_REPS, max_reps=DEFAULT_MAX_REPS,
+                 seed0=1, params=None, step_ms=None, workers=None, on_result=None):
+    """Add replications (seeds seed0, seed0+1, ...) until every KPI in kpis meets target."""
+    kpis = check_kpis(kpis)
+    workers = max(1, min(int(workers or os.cpu_count() or 1), int(max_reps)))
+    jobs = [(seed0 + i, float(horizon_s), params, step_ms) for i in range(int(max_reps))]
+    results, summary, reached = [], across([], KPIS), False
+    t0 = time.perf_counter()
+    # spawn + one run per worker, as doe.py; results in seed order so the stop point is reproducible
+    ctx = mp.get_context("spawn")
+    with ctx.Pool(processes=workers, maxtasksperchild=1) as pool:
+        for r in pool.imap(replication_job, jobs):
+            results.append(r)
+            summary = across(results, KPIS)
+            if on_result:
+                on_result(r, summary)
+            ok = sum(1 for x in results if x.get("ok"))
+            if ok >= min_reps and all(summary[k]["rel_precision"] is not None
+                                      and summary[k]["rel_precision"] <= target for k in kpis):
+                reached = True
+                break
+        # leaving the block terminates the runs still in flight
+    wall_s = time.perf_counter() - t0
+    used = sum(r.get("sim_s", 0.0) for r in results)
+    return {
+        "mode": "reps",
+        "target": float(target),
+        "kpis_checked": list(kpis),
+        "reached": reached,
+        "reps": len(results),
+        "max_reps": int(max_reps),
+        "horizon_s": float(horizon_s),
+        "saved": savings(used, float(horizon_s) * int(max_reps), wall_s),
+        "unsettled_reps": sum(1 for r in results if r.get("ok") and not r["settled"]),
+        "kpis": summary,
+        "runs": results,
+        "wall_s": wall_s,
+    }
+
+
+# ============================================================
+# CLI
+# ============================================================
+def main(argv=None):
+    ap = argparse.ArgumentParser(description="Stop simulating once the steady-state KPIs are precise enough")
+    sub = ap.add_subparsers(dest="cmd", required=True)
+    r = sub.add_parser("run", help="one run, stopped by the PLC at the target precision")
+    r.add_argument("--max-horizon", type=float, default=DEFAULT_MAX_HORIZON_S, help="simulated seconds")
+    r.add_argument("--seed", type=int, default=None)
+    r.add_argument("--min-units", type=int, default=MIN_UNITS,
+                   help="post-warm-up units before the run may stop (the serial line makes ~28/h)")
+    p = sub.add_parser("reps", help="replications of a fixed horizon until the target precision")
+    p.add_argument("--horizon", type=float, default=3600.0, help="simulated seconds per replication")
+    p.add_argument("--min-reps", type=int, default=MIN_REPS)
+    p.add_argument("--max-reps", type=int, default=DEFAULT_MAX_REPS)
+    p.add_argument("--seed", type=int, default=1, help="first replication's seed")
+    p.add_argument("--workers", type=int, default=None)
+    for s in (r, p):
+        s.add_argument("--target", type=float, default=0.05, help="relative 95%% half-width, e.g. 0.05")
+        s.add_argument("--kpi", action="append", choices=KPIS, default=None,
+                       help=f"KPI to control (repeatable; default {DEFAULT_KPIS[0]})")
+        s.add_argument("--step-ms", type=float, default=None)
+        s.add_argument("--param", action="append", default=[], metavar="NAME=VALUE",
+                       help="PLC param, e.g. fast_handoff=true or reset_pulse_ticks=2")
+    a = ap.parse_args(argv)
+
+    params = {}
+    for item in a.param:
+        name, _, value = item.partition("=")
+        params[name.strip()] = json.loads(value)
+    kpis = tuple(a.kpi or DEFAULT_KPIS)
+
+    if a.cmd == "run":
+        kw = {"step_ms": a.step_ms} if a.step_ms else {}
+        res = sequential_run(a.target, kpis, a.max_horizon, a.seed, params or None, a.min_units, **kw)
+        res["trace"] = res["trace"][-10:]
+    else:
+        def progress(rep, summary):
+            rel = ", ".join(f"{k} {summary[k]['rel_precision']:.3f}" if summary[k]["rel_precision"] is not None
+                            else f"{k} -" for k in kpis)
+            print(f"  rep seed {rep['seed']}: {rel}", file=sys.stderr, flush=True)
+
+        res = replications(a.target, kpis, a.horizon, a.min_reps, a.max_reps, a.seed, params or None,
+                           a.step_ms, a.workers, on_result=progress)
+    print(json.dumps(res, indent=2))
+    return 0 if res["reached"] else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
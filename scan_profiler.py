@@ -0,0 +1,188 @@
+# pythonGateways/scan_profiler.py
+"""
+Opt-in per-phase timing of the PLC scan loop.
+
+Each scan is split into laps taken with time.perf_counter_ns() at the
+PLC's user-region boundaries. Per-scan phase totals go into log-linear
+(HDR-style) histograms, so percentiles stay accurate to ~3% from nanoseconds
+to seconds at a fixed memory cost.
+"""
+import json
+import threading
+import time
+
+# logic: the "Before sending" region (state machine, trackers)
+# tx:    the six generated sends
+# hooks: the "After sending" region (KPI export, run control)
+# rx:    everything up to the next scan's logic: the generated signal dump,
+#        the VSI time step and the six receives with decapsulation. That is
+#        all generated code, so it is timed as one phase.
+PHASES = ("logic", "tx", "hooks", "rx")
+
+SUB_BITS = 5
+SUB_COUNT = 1 << SUB_BITS          # sub-buckets per power of two
+_LINEAR_MAX = SUB_COUNT << 1       # values below this are recorded exactly
+
+
+class HdrHistogram:
+    """Log-linear histogram of non-negative integers (e.g. nanoseconds)."""
+
+    def __init__(self):
+        self.counts = []
+        self.count = 0
+        self.total = 0
+        self.min = None
+        self.max = 0
+
+    @staticmethod
+    def _index(v):
+        if v < _LINEAR_MAX:
+            return v
+        shift = v.bit_length() - (SUB_BITS + 1)
+        return shift * SUB_COUNT + (v >> shift)
+
+    @staticmethod
+    def _upper(idx):
+        if idx < _LINEAR_MAX:
+            return idx
+        shift = idx // SUB_COUNT - 1
+        mant = idx - shift * SUB_COUNT
+        return ((mant + 1) << shift) - 1
+
+    def record(self, v):
+        v = int(v)
+        if v < 0:
+            v = 0
+        i = self._index(v)
+        if i >= len(self.counts):
+            self.counts.extend([0] * (i + 1 - len(self.counts)))
+        self.counts[i] += 1
+        self.count += 1
+        self.total += v
+        if self.min is None or v < self.min:
+            self.min = v
+        if v > self.max:
+            self.max = v
+
+    def percentile(self, q):
+        if not self.count:
+            return 0
+        target = max(1, int(round(self.count * float(q) / 100.0)))
+        seen = 0
+        for i, c in enumerate(self.counts):
+            if not c:
+                continue
+            seen += c
+            if seen >= target:
+                return min(self._upper(i), self.max)
+        return self.max
+
+    def mean(self):
+        return (self.total / self.count) if self.count else 0.0
+
+
+class ScanProfiler:
+    """
+    Usage inside the scan loop:
+        prof.begin_scan()      # closes the previous scan (remaining time -> last phase)
+        ...; prof.lap("tx")    # time since the previous lap is charged to "tx"
+    """
+
+    def __init__(self, phases=PHASES):
+        self.phases = tuple(phases)
+        self._lock = threading.Lock()
+        self.hist = {ph: HdrHistogram() for ph in self.phases}
+        self.scan_hist = HdrHistogram()
+        self._acc = {ph: 0 for ph in self.phases}
+        self._t_scan = None
+        self._t_last = None
+        self.scans = 0
+
+    def begin_scan(self):
+        now = time.perf_counter_ns()
+        if self._t_scan is not None:
+            self._acc[self.phases[-1]] += now - self._t_last
+            self._commit(now)
+        self._t_scan = now
+        self._t_last = now
+
+    def lap(self, phase):
+        now = time.perf_counter_ns()
+        if self._t_last is None:
+            self._t_last = now
+            return
+        self._acc[phase] += now - self._t_last
+        self._t_last = now
+
+    def finish(self):
+        """Close the scan in progress (call once at shutdown)."""
+        if self._t_scan is None:
+            return
+        now = time.perf_counter_ns()
+        self._acc[self.phases[-1]] += now - self._t_last
+        self._commit(now)
+        self._t_scan = None
+        self._t_last = None
+
+    def _commit(self, now):
+        acc = self._acc
+        with self._lock:
+            for ph in self.phases:
+                self.hist[ph].record(acc[ph])
+                acc[ph] = 0
+            self.scan_hist.record(now - self._t_scan)
+            self.scans += 1
+
+    # ----------------------------
+    # Reporting
+    # ----------------------------
+    def summary(self):
+        with self._lock:
+            scan_total = self.scan_hist.total or 1
+            out = {"scans": self.scans, "phases": {}}
+            for ph in self.phases:
+                h = self.hist[ph]
+                out["phases"][ph] = _hist_summary(h, share=h.total / scan_total)
+            out["scan"] = _hist_summary(self.scan_hist, share=1.0)
+            return out
+
+    def format_summary(self):
+        s = self.summary()
+        lines = [f"PLC scan profile ({s['scans']} scans, times in us)",
+                 f"  {'phase':<8}{'share':>8}{'mean':>10}{'p50':>10}{'p90':>10}{'p99':>10}{'max':>12}"]
+        rows = list(s["phases"].items()) + [("scan", s["scan"])]
+        for ph, r in rows:
+            lines.append(f"  {ph:<8}{r['share'] * 100:>7.1f}%{r['mean_us']:>10.1f}{r['p50_us']:>10.1f}"
+                         f"{r['p90_us']:>10.1f}{r['p99_us']:>10.1f}{r['max_us']:>12.1f}")
+        return "\n".join(lines)
+
+    def write_json(self, path):
+        with open(path, "w", encoding="utf-8") as f:
+            json.dump(self.summary(), f, indent=2)
+
+    def openmetrics_lines(self):
+        """Collector for metrics_exporter.register_collector()."""
+        qs = (0.5, 0.9, 0.99)
+        with self._lock:
+            out = ["# TYPE plc_scan_phase_seconds summary",
+                   "# UNIT plc_scan_phase_seconds seconds",
+                   "# HELP plc_scan_phase_seconds Wall time per PLC scan spent in each phase."]
+            for ph in self.phases:
+                h = self.hist[ph]
+                for q in qs:
+                    out.append(f'plc_scan_phase_seconds{{phase="{ph}",quantile="{q}"}} {h.percentile(q * 100) / 1e9!r}')
+                out.append(f'plc_scan_phase_seconds_sum{{phase="{ph}"}} {h.total / 1e9!r}')
+                out.append(f'plc_scan_phase_seconds_count{{phase="{ph}"}} {h.count}')
+        return out
+
+
+def _hist_summary(h, share):
+    return {
+        "count": h.count,
+        "share": float(share),
+        "mean_us": h.mean() / 1e3,
+        "p50_us": h.percentile(50) / 1e3,
+        "p90_us": h.percentile(90) / 1e3,
+        "p99_us": h.percentile(99) / 1e3,
+        "max_us": h.max / 1e3,
+    }
@@ -0,0 +1,221 @@
+# pythonGateways/station_runtime.py
+"""
+Lazy SimPy stepping for the station models.
+
+A station model keeps its SimPy environment on the VSI timeline without
+running it on every tick. At the end of each tick the station calls
+advance(t_end_ns); the environment only runs when an event is due before
+t_end, so an idle station, or one whose next event is several ticks away,
+costs no env.run() at all. Anything that touches the model from outside
+(a PLC command, a reset, a read of env.now) calls sync(t_now_ns) first,
+which brings env.now up to that VSI time in one env.run(until=...) jump.
+
+    class Station(LazyRuntime):
+        def __init__(self):
+            LazyRuntime.__init__(self)       # creates self.env
+
+    st.sync(now_ns)                  # before start/stop/submit/reset
+    st.advance(now_ns + step_ns)     # end of tick
+    st.hold(now_ns + step_ns)        # paused tick: model time stands still
+    st.step_time_ns(end_t)           # VSI time of an env time inside the last tick
+    st.process(gen)                  # env.process(gen), ended by the next reset_env()
+    st.reset_env()                   # station reset: new Environment, same model time
+
+    st.mark_job(*args)               # job start, for checkpoints (see below)
+    snap = st.snapshot()             # picklable model state
+    st.restore(snap)                 # on a fresh model of the same class
+
+The env -> VSI mapping is anchored when the environment is first used (a
+model rebuilt by a reset continues from the VSI time the old one reached)
+and only shifts while the station is held.
+
+Resets and restores never touch SimPy internals. reset_env() closes the
+generators the model started through process() (their finally blocks run
+at once), swaps in a new Environment whose initial_time is the env time
+the model had reached, and calls build_env() for the model to create its
+Stores/Resources (and point helper objects at the new env). The model then
+starts its standing processes again itself.
+
+Checkpoints hold the model's plain attributes (and those of the helper
+objects named in CHECKPOINT_PARTS), the items waiting in its Stores, and
+for a job in flight the mark taken when it started. SimPy processes cannot
+be pickled, so restore() rebuilds the in-flight one by replaying the job
+from its mark (same env time, same RNG state, same start arguments) up to
+the snapshot's env time, then puts the snapshot state back on top. The
+replay is exact as long as the job is the only consumer of the station's
+RNG while it runs, which holds for every station model here. A model that
+marks jobs implements job_in_flight() and resume_job(*args); resume_idle()
+restarts any standing processes (e.g. a queue worker).
+"""
+import pickle
+import random
+import weakref
+
+import simpy
+
+_SIMPY_TYPES = (simpy.Environment, simpy.Event, simpy.Resource, simpy.Store)
+
+
+def _plain_state(obj, skip=()):
+    """Copy of obj's attributes that are neither SimPy objects nor unpicklable."""
+    out = {}
+    for k, v in vars(obj).items():
+        if k in skip or isinstance(v, _SIMPY_TYPES):
+            continue
+        try:
+            out[k] = pickle.loads(pickle.dumps(v))
+        except (pickle.PicklingError, TypeError, AttributeError):
+            pass
+    return out
+
+
+class LazyRuntime:
+    CHECKPOINT_PARTS = ()       # attributes holding helper objects with their own state
+
+    def __init__(self, env=None):
+        self._gens = weakref.WeakSet()      # generators started through process()
+        self.bind(env if env is not None else simpy.Environment())
+
+    def bind(self, env):
+        """
+        Switch to a (new) environment. A model rebuilt mid-run starts where the
+        old one had got to; a fresh one is anchored at the first call.
+        """
+        reached_ns = getattr(self, "_model_ns", None)
+        self.env = env
+        self._origin_ns = None      # VSI ns of env time 0
+        self._model_ns = None       # VSI ns the model has logically reached
+        self._tick_from = None      # env time at the start of the last advance
+        self.env_runs = getattr(self, "env_runs", 0)      # env.run() calls made
+        self.env_skips = getattr(self, "env_skips", 0)    # ticks that needed none
+        if reached_ns is not None:
+            self._anchor(reached_ns)
+
+    def build_env(self):
+        """Create the model's Stores/Resources on self.env (after every new Environment)."""
+
+    def process(self, gen):
+        """env.process(gen), with gen kept so reset_env() can end it."""
+        self._gens.add(gen)
+        return self.env.process(gen)
+
+    def reset_env(self, env_t=None):
+        """
+        Station reset: close the model's processes, then continue on a new
+        Environment at env time env_t (default: where the model has got to,
+        so the VSI mapping carries on unchanged) and rebuild its resources.
+        """
+        for gen in list(self._gens):
+            gen.close()
+        if env_t is None:
+            env_t = self.env_time(self._model_ns) if self._model_ns is not None else self.env.now
+        self.bind(simpy.Environment(initial_time=env_t))
+        self.build_env()
+
+    def _anchor(self, t_ns):
+        if self._origin_ns is None:
+            self._origin_ns = int(t_ns) - int(round(self.env.now * 1e9))
+            self._model_ns = int(t_ns)
+
+    def env_time(self, t_ns):
+        self._anchor(t_ns)
+        return (int(t_ns) - self._origin_ns) / 1e9
+
+    def vsi_ns(self, env_t):
+        return self._origin_ns + int(round(env_t * 1e9))
+
+    def _run_to(self, t_ns):
+        target = self.env_time(t_ns)
+        if target > self.env.now:
+            self.env.run(until=target)
+            self.env_runs += 1
+        if t_ns > self._model_ns:
+            self._model_ns = int(t_ns)
+
+    def sync(self, t_ns):
+        """Catch env.now up to VSI time t_ns in one jump."""
+        self._run_to(t_ns)
+
+    def advance(self, t_ns):
+        """End of tick: run up to t_ns only if an event is due before it."""
+        self._anchor(t_ns)
+        self._tick_from = self.env_time(self._model_ns)
+        if self.env.peek() < self.env_time(t_ns):
+            self._run_to(t_ns)
+            return True
+        self.env_skips += 1
+        if t_ns > self._model_ns:
+            self._model_ns = int(t_ns)
+        return False
+
+    def hold(self, t_ns):
+        """Paused until t_ns: slide the mapping so no model time passes."""
+        self._anchor(t_ns)
+        self._tick_from = None
+        if t_ns > self._model_ns:
+            self._origin_ns += int(t_ns) - self._model_ns
+            self._model_ns = int(t_ns)
+
+    def step_time_ns(self, env_t):
+        """VSI ns of env_t if it fell inside the last advance(), else None."""
+        if env_t is None or self._tick_from is None:
+            return None
+        if self._tick_from <= env_t <= self.env_time(self._model_ns):
+            return self.vsi_ns(env_t)
+        return None
+
+    # ---------------- checkpoints ----------------
+    def _capture(self):
+        return {"state": _plain_state(self, skip=("_job_mark", "_gens") + tuple(self.CHECKPOINT_PARTS)),
+                "parts": {name: _plain_state(getattr(self, name)) for name in self.CHECKPOINT_PARTS}}
+
+    def _apply(self, captured):
+        for k, v in captured["state"].items():
+            setattr(self, k, v)
+        for name, state in captured["parts"].items():
+            part = getattr(self, name)
+            for k, v in state.items():
+                setattr(part, k, v)
+
+    def mark_job(self, *args):
+        """Job start, before its first random draw: what a replay of it needs."""
+        self._job_mark = (self.env.now, random.getstate(), self._capture(), args)
+
+    def job_in_flight(self):
+        return False
+
+    def resume_job(self, *args):
+        raise NotImplementedError(f"{type(self).__name__} does not mark jobs")
+
+    def resume_idle(self):
+        pass
+
+    def snapshot(self):
+        stores = {k: pickle.loads(pickle.dumps(list(v.items)))
+                  for k, v in vars(self).items() if isinstance(v, simpy.Store)}
+        snap = self._capture()
+        snap.update(now=self.env.now, stores=stores,
+                    job=getattr(self, "_job_mark", None) if self.job_in_flight() else None)
+        return snap
+
+    def restore(self, snap):
+        """Put a snapshot() back: replay the job in flight, then restore the state over it."""
+        snap = pickle.loads(pickle.dumps(snap))     # one snapshot can seed many branches
+        job = snap["job"]
+        if job is not None:
+            t_start, rng_state, captured, args = job
+            self.reset_env(t_start)
+            self._apply(captured)
+            random.setstate(rng_state)
+            self.resume_job(*args)
+            if snap["now"] > self.env.now:
+                self.env.run(until=snap["now"])
+        else:
+            self.reset_env(snap["now"])
+            self.resume_idle()
+        self._apply(snap)
+        self._job_mark = job
+        for name, items in snap["stores"].items():
+            store = getattr(self, name)
+            for item in items:
+                store.put(item)
@@ -0,0 +1,223 @@
+# pythonGateways/steady_state.py
+"""
+Steady-state KPI estimates from the per-unit output series, with the
+warm-up cut off automatically.
+
+build_kpi_snapshot's throughput is packages / time since zero, so the
+empty-pipeline start biases it low until a long run dilutes it. Here every
+unit that leaves the line adds one observation to three series, in
+departure order:
+
+    throughput      gap to the previous completed unit (first: from line start)
+    cycle time      lead time of a completed unit (left - entered S1)
+    yield           1 for an S5 accept, 0 for a reject
+
+Each series is truncated with MSER-5: batch it into means of 5, and cut
+the d batches that minimise the squared deviations of the rest from their
+mean divided by (m - d)^2, searching d over the first half only. The
+latest of the three cut times is the line's warm-up and applies to all
+three. What is left is split into N_BATCHES (or a few more) batch means
+for a 95% t interval. Throughput is 60 / mean gap, its interval the gap interval
+mapped the same way.
+
+    est = SteadyStateEstimator()
+    est.add(left_s, outcome, lead_s)             # per departing unit (PLC _WipTracker)
+    est.summary(t0_s)
+    # {"warmup": {"truncated_s", "units", "settled"},
+    #  "throughput_per_min": {"mean", "ci95", "half_width", "rel_precision", "batches"},
+    #  "cycle_time_s": {...}, "yield_pct": {...}}
+
+    python steady_state.py --horizon 3600 --seed 1     # headless run, naive vs steady-state
+
+settled is False when the MSER minimum sits on the edge of the searched
+half (or there are fewer than MIN_MSER_BATCHES batches): the run has not
+left its warm-up yet and the estimates should not be trusted.
+"""
+import argparse
+import json
+import math
+import sys
+from collections import deque
+
+MSER_BATCH = 5
+MIN_MSER_BATCHES = 10       # MSER batches before a truncation point counts as found
+N_BATCHES = 20              # batch means after truncation (up to 2x as many for short series)
+MAX_UNITS = 50_000          # departures kept (oldest dropped; the warm-up is long gone by then)
+
+# two-sided 95% t quantiles; df above the table uses the next smaller entry (conservative)
+_T975 = {1: 12.706, 2: 4.303, 3: 3.182, 4: 2.776, 5: 2.571, 6: 2.447, 7: 2.365, 8: 2.306, 9: 2.262,
+         10: 2.228, 11: 2.201, 12: 2.179, 13: 2.160, 14: 2.145, 15: 2.131, 16: 2.120, 17: 2.110,
+         18: 2.101, 19: 2.093, 20: 2.086, 25: 2.060, 30: 2.042, 40: 2.021, 60: 2.000, 120: 1.980}
+Z975 = 1.960
+
+_LOST = ("lost", "scrapped")
+
+
+def t975(df):
+    if df < 1:
+        return math.inf
+    if df > 120:
+        return Z975
+    return _T975[max(k for k in _T975 if k <= df)]
+
+
+# ============================================================
+# Estimators
+# ============================================================
+def mser(series, batch=MSER_BATCH):
+    """(observations to cut, settled) for series by MSER-batch."""
+    m = len(series) // batch
+    if m < 2:
+        return 0, False
+    z = [sum(series[j * batch:(j + 1) * batch]) / batch for j in range(m)]
+    stat = [0.0] * m
+    s = q = 0.0
+    for d in range(m - 1, -1, -1):
+        s += z[d]
+        q += z[d] * z[d]
+        n = m - d
+        stat[d] = max(0.0, q - s * s / n) / (n * n)
+    half = m // 2
+    d = min(range(half + 1), key=stat.__getitem__)
+    return d * batch, m >= MIN_MSER_BATCHES and d < half
+
+
+def batch_means(series, n_batches=N_BATCHES):
+    """Mean and 95% half-width by non-overlapping batch means (leading remainder dropped)."""
+    n = len(series)
+    if n == 0:
+        return {"mean": 0.0, "half_width": None, "batches": 0, "n": 0}
+    b = max(1, n // int(n_batches))
+    k = n // b
+    data = series[n - k * b:]
+    means = [sum(data[j * b:(j + 1) * b]) / b for j in range(k)]
+    mean = sum(means) / k
+    if k < 2:
+        return {"mean": mean, "half_width": None, "batches": k, "n": len(data)}
+    var = sum((x - mean) ** 2 for x in means) / (k - 1)
+    return {"mean": mean, "half_width": t975(k - 1) * math.sqrt(var / k), "batches": k, "n": len(data)}
+
+
+def _interval(bm, scale=1.0, invert=False):
+    mean, h = bm["mean"], bm["half_width"]
+    if invert:
+        # 60 / gap: the gap interval maps to [60/(g+h), 60/(g-h)]
+        est = scale / mean if mean > 0 else 0.0
+        if h is None or mean <= 0:
+            lo = hi = None
+        else:
+            # no upper bound while the gap interval reaches zero
+            lo, hi = scale / (mean + h), (scale / (mean - h) if mean > h else None)
+    else:
+        est = scale * mean
+        lo, hi = (None, None) if h is None else (scale * (mean - h), scale * (mean + h))
+    half = None if lo is None or hi is None else (hi - lo) / 2.0
+    return {
+        "mean": est,
+        "ci95": [lo, hi],
+        "half_width": half,
+        "rel_precision": half / abs(est) if half is not None and est else None,
+        "batches": bm["batches"],
+        "n": bm["n"],
+    }
+
+
+def estimate(departures, t0_s=0.0, n_batches=N_BATCHES):
+    """
+    Steady-state KPIs from departures [(left_s, outcome, lead_s)] in
+    departure order; t0_s is when the line started.
+    """
+    done = [(t, lead) for t, outcome, lead in departures if outcome not in _LOST]
+    judged = [(t, 1.0 if outcome == "accept" else 0.0) for t, outcome, _ in departures
+              if outcome in ("accept", "reject")]
+    series = {
+        "throughput_per_min": [(t, t - prev) for (t, _), prev in zip(done, [t0_s] + [t for t, _ in done])],
+        "cycle_time_s": done,
+        "yield_pct": judged,
+    }
+    cut_s, settled, by_kpi = t0_s, bool(done), {}
+    for name, obs in series.items():
+        if not obs:
+            continue
+        d, ok = mser([x for _, x in obs])
+        by_kpi[name] = obs[d - 1][0] if d else t0_s
+        cut_s = max(cut_s, by_kpi[name])
+        settled = settled and ok
+    out = {
+        "warmup": {
+            "truncated_s": cut_s - t0_s,
+            "units": sum(1 for t, _ in done if t <= cut_s),
+            "settled": settled,
+            "by_kpi_s": {k: v - t0_s for k, v in by_kpi.items()},
+        },
+        "units": len(done),
+    }
+    for name, obs in series.items():
+        kept = [x for t, x in obs if t > cut_s]
+        bm = batch_means(kept, n_batches)
+        if name == "throughput_per_min":
+            out[name] = _interval(bm, 60.0, invert=True)
+        elif name == "yield_pct":
+            out[name] = _interval(bm, 100.0)
+        else:
+            out[name] = _interval(bm)
+    return out
+
+
+class SteadyStateEstimator:
+    """
+    Departure log for estimate(). summary() recomputes only when the log
+    has grown by refresh_frac since the last time (at least one unit).
+    """
+
+    def __init__(self, max_units=MAX_UNITS, refresh_frac=0.01):
+        self.log = deque(maxlen=int(max_units))
+        self.added = 0
+        self.refresh_frac = float(refresh_frac)
+        self._cache = None
+        self._cache_added = 0
+
+    def add(self, left_s, outcome, lead_s):
+        self.log.append((float(left_s), outcome, float(lead_s)))
+        self.added += 1
+
+    def summary(self, t0_s=0.0, force=False):
+        grown = self.added - self._cache_added
+        if (not force and self._cache is not None
+                and grown < max(1, int(self.refresh_frac * len(self.log)))):
+            return self._cache
+        # once the log has wrapped, its first entry stands in for the line start
+        start = t0_s if self.added == len(self.log) or not self.log else self.log[0][0]
+        self._cache = estimate(list(self.log) if start == t0_s else list(self.log)[1:], start)
+        self._cache_added = self.added
+        return self._cache
+
+
+# ============================================================
+# CLI
+# ============================================================
+def main(argv=None):
+    ap = argparse.ArgumentParser(description="Steady-state KPIs of a headless run (MSER-5 + batch means)")
+    ap.add_argument("--horizon", type=float, default=3600.0, help="simulated seconds")
+    ap.add_argument("--seed", type=int, default=None)
+    ap.add_argument("--batches", type=int, default=N_BATCHES)
+    a = ap.parse_args(argv)
+
+    import headless_line
+    line = headless_line.HeadlessLine(horizon_s=a.horizon, seed=a.seed, quiet="mute")
+    res = line.run()
+    wip = line.plc._wip
+    est = estimate(list(wip.steady.log), wip.t0_ns / 1e9 if wip.t0_ns is not None else 0.0, a.batches)
+    k = res["kpis"]
+    print(json.dumps({
+        "sim_s": res["sim_s"],
+        "naive": {"throughput_per_min": k.get("throughput_per_min"), "yield_pct": k.get("yield_pct"),
+                  "cycle_time_s": (k.get("lead_time_s") or {}).get("mean")},
+        "steady_state": est,
+        "errors": res["errors"],
+    }, indent=2))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,273 @@
+# pythonGateways/surrogate.py
+"""
+Metamodel of the line trained on the run history, for interactive what-if.
+
+Every finished run (live runs via run_stop, DOE and optimiser replications
+via record_run) lands in the opt_dashboard run store with its params and a
+KPI summary. This module learns throughput_per_min, yield_pct and
+availability from that history with one Gaussian process per response
+(optimizer.GaussianProcess, same kernel and noise handling as the
+optimiser) and predicts them for unseen parameter sets with a 95% band.
+
+    m = Surrogate().update(runs)          # runs: run store entries or doe results
+    m.predict({"reset_pulse_ticks": 2, "fast_handoff": True})
+    # {"responses": {"throughput_per_min": {"mean", "sd", "ci95"}, ...},
+    #  "needs_simulation": True/False, "reasons": [...]}
+
+    python surrogate.py doe_results.json --predict reset_pulse_ticks=2,fast_handoff=1
+
+Training is incremental: update() only reads runs it has not seen and the
+GPs are refitted when something new arrived. Replications of the same
+configuration are pooled into one point with the variance of their mean.
+A prediction is a few kernel evaluations and one triangular solve per
+response (a few ms for MAX_CONFIGS configurations).
+
+needs_simulation is set when the history cannot answer: too few distinct
+configurations, a parameter outside the range seen so far, or a posterior
+sd above SIMULATE_SD_RATIO of the response's spread across the history
+and above the run-to-run noise (one replication would tell more).
+"""
+import argparse
+import json
+import math
+import statistics
+import threading
+import time
+
+from optimizer import GaussianProcess, Z95
+
+RESPONSES = ("throughput_per_min", "yield_pct", "availability")
+
+# numeric view of a params dict; buffer caps and staffing are left out (doe.INERT_FACTORS)
+FEATURES = ("reset_pulse_ticks", "fault_reset_all", "fast_handoff")
+
+MIN_CONFIGS = 3             # distinct configurations before predictions are trusted at all
+MAX_CONFIGS = 120           # most recent configurations kept (GP fit is O(n^3))
+SIMULATE_SD_RATIO = 0.5     # posterior sd / sd of the response over the history
+
+
+def features(params, base=None):
+    """Feature vector of a (possibly partial) params dict; missing keys come from base."""
+    p = dict(base or {})
+    p.update(params or {})
+    return [float(p.get(name, 0)) for name in FEATURES]
+
+
+def _outcome(run):
+    """KPI dict of a run store entry (summary) or a doe result (kpis); None if it has none."""
+    kpis = run.get("summary") or run.get("kpis")
+    if not kpis or run.get("ok") is False:
+        return None
+    try:
+        return {r: float(kpis[r]) for r in RESPONSES}
+    except (KeyError, TypeError, ValueError):
+        return None
+
+
+class Surrogate:
+    """Safe to predict() from one thread while another calls update()."""
+
+    def __init__(self, base_params=None):
+        self.base = dict(base_params or {})
+        self.configs = {}           # feature tuple -> {"x": [...], "ys": {response: [...]}}
+        self.runs_seen = 0
+        self.fitted_at = None
+        self._gps = None            # response -> (GaussianProcess, sd over the history, replication sd)
+        self._X = []
+        self._lo = self._hi = None
+        self._lock = threading.Lock()
+
+    # ---------------- training ----------------
+    def update(self, runs, refit=True):
+        """Add the runs not seen yet (runs is the whole, append-only history) and refit if any."""
+        new = list(runs)[self.runs_seen:]
+        added = 0
+        for r in new:
+            y = _outcome(r)
+            if y is None:
+                continue
+            x = features(r.get("params"), self.base)
+            c = self.configs.pop(tuple(x), None) or {"x": x, "ys": {k: [] for k in RESPONSES}}
+            for k in RESPONSES:
+                c["ys"][k].append(y[k])
+            self.configs[tuple(x)] = c       # re-insert: most recent last
+            added += 1
+        self.runs_seen += len(new)
+        while len(self.configs) > MAX_CONFIGS:
+            del self.configs[next(iter(self.configs))]
+        if added and refit:
+            self.fit()
+        return self
+
+    def fit(self):
+        configs = list(self.configs.values())
+        if len(configs) < MIN_CONFIGS:
+            with self._lock:
+                self._gps = None
+            return self
+        raw = [c["x"] for c in configs]
+        lo = [min(col) for col in zip(*raw)]
+        hi = [max(col) for col in zip(*raw)]
+        X = [_unit(x, lo, hi) for x in raw]
+        gps = {}
+        for k in RESPONSES:
+            y = [statistics.fmean(c["ys"][k]) for c in configs]
+            nv = [statistics.variance(c["ys"][k]) / len(c["ys"][k]) if len(c["ys"][k]) > 1 else None
+                  for c in configs]
+            known = [v for v in nv if v is not None]
+            pooled = statistics.fmean(known) if known else 0.0
+            gp = GaussianProcess().fit(X, y, [pooled if v is None else v for v in nv])
+            reps = [statistics.variance(c["ys"][k]) for c in configs if len(c["ys"][k]) > 1]
+            gps[k] = (gp, statistics.pstdev(y), math.sqrt(statistics.fmean(reps)) if reps else 0.0)
+        with self._lock:
+            self._gps, self._X, self._lo, self._hi = gps, X, lo, hi
+            self.fitted_at = time.time()
+        return self
+
+    # ---------------- prediction ----------------
+    def predict(self, params):
+        t0 = time.perf_counter()
+        with self._lock:
+            gps, X, lo, hi = self._gps, self._X, self._lo, self._hi
+        out = {"configs": len(self.configs), "runs": self.runs_seen, "responses": {}, "reasons": []}
+        if gps is None:
+            out["needs_simulation"] = True
+            out["reasons"].append(f"only {len(self.configs)} configurations in the history (need {MIN_CONFIGS})")
+            out["elapsed_ms"] = 1e3 * (time.perf_counter() - t0)
+            return out
+        raw = features(params, self.base)
+        for name, v, a, b in zip(FEATURES, raw, lo, hi):
+            if v < a or v > b:
+                out["reasons"].append(f"{name}={v:g} outside the history [{a:g}, {b:g}]")
+        x = _unit(raw, lo, hi)
+        d2 = [sum((p - q) ** 2 for p, q in zip(x, xi)) for xi in X]
+        for k, (gp, spread, noise) in gps.items():
+            mu, sd = gp.predict(x, d2)
+            out["responses"][k] = {"mean": mu, "sd": sd, "ci95": [mu - Z95 * sd, mu + Z95 * sd]}
+            # a run is only worth it if it would tell more than the model already does
+            if spread > 0 and sd > SIMULATE_SD_RATIO * spread and sd > noise:
+                out["reasons"].append(f"{k} uncertain (sd {sd:.3g} vs spread {spread:.3g})")
+        out["needs_simulation"] = bool(out["reasons"])
+        out["elapsed_ms"] = 1e3 * (time.perf_counter() - t0)
+        return out
+
+    def status(self):
+        with self._lock:
+            gps = self._gps
+        return {
+            "configs": len(self.configs),
+            "runs": self.runs_seen,
+            "fitted_at": self.fitted_at,
+            "lengthscales": {k: g[0].ls for k, g in gps.items()} if gps else {},
+        }
+
+
+def _unit(x, lo, hi):
+    return [(v - a) / (b - a) if b > a else 0.0 for v, a, b in zip(x, lo, hi)]
+
+
+# ============================================================
+# Shared model for the dashboard
+# ============================================================
+_bg_lock = threading.Lock()
+_model = None
+_fitting = False
+
+
+def _refit(runs, base):
+    """Update the shared model (a fresh one for new base params) and publish it; caller set _fitting."""
+    global _model, _fitting
+    try:
+        with _bg_lock:
+            m = _model
+        if m is None or not _same_base(m.base, base):
+            m = Surrogate(base)
+        m.update(runs)
+        with _bg_lock:
+            _model = m
+    finally:
+        with _bg_lock:
+            _fitting = False
+
+
+def _same_base(a, b):
+    return features({}, a) == features({}, b)
+
+
+def refresh(runs, base_params=None):
+    """
+    Bring the shared model up to date with the run store and the current
+    params, which fill in the features a run or a query leaves out. The
+    first fit runs inline; later ones in a background thread while
+    predictions keep using the previous fit. New base params mean a fresh
+    model over the whole history. One fit at a time: a call made while one
+    is running returns the model as it is (None during the first fit).
+    """
+    global _fitting
+    base = dict(base_params or {})
+    with _bg_lock:
+        if _fitting or (_model is not None and len(runs) <= _model.runs_seen
+                        and _same_base(_model.base, base)):
+            return _model
+        _fitting = True
+        first = _model is None
+    if first:
+        _refit(list(runs), base)
+    else:
+        threading.Thread(target=_refit, args=(list(runs), base), daemon=True).start()
+    return current_model()
+
+
+def current_model():
+    """The shared model as last fitted, or None before the first refresh()."""
+    with _bg_lock:
+        return _model
+
+
+def current_status():
+    with _bg_lock:
+        m, fitting = _model, _fitting
+    if m is None:
+        return {"state": "fitting" if fitting else "idle"}
+    st = m.status()
+    st["state"] = "fitting" if fitting else "ready"
+    return st
+
+
+# ============================================================
+# CLI
+# ============================================================
+def _parse_point(text):
+    p = {}
+    for item in (text or "").split(","):
+        if item.strip():
+            name, _, value = item.partition("=")
+            p[name.strip()] = json.loads(value)
+    return p
+
+
+def main(argv=None):
+    ap = argparse.ArgumentParser(description="Surrogate predictions from recorded runs")
+    ap.add_argument("results", nargs="+", help="doe.py / optimizer result files (JSON with 'results')")
+    ap.add_argument("--predict", action="append", default=[], metavar="NAME=V,...",
+                    help="e.g. reset_pulse_ticks=2,fast_handoff=1")
+    a = ap.parse_args(argv)
+
+    import opt_dashboard
+    runs = []
+    for path in a.results:
+        with open(path, encoding="utf-8") as f:
+            data = json.load(f)
+        runs.extend(data.get("results") or data.get("runs") or [])
+    t0 = time.perf_counter()
+    m = Surrogate(opt_dashboard.get_params()).update(runs)
+    print(f"Fitted on {m.runs_seen} runs / {len(m.configs)} configurations in {time.perf_counter() - t0:.2f}s")
+    print(json.dumps(m.status(), indent=2))
+    for text in a.predict:
+        print(text)
+        print(json.dumps(m.predict(_parse_point(text)), indent=2))
+    return 0
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())
@@ -0,0 +1,29 @@
+import importlib.util
+import os
+import sys
+import unittest
+
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+
+HAVE_SIMPY = importlib.util.find_spec("simpy") is not None
+
+KEYS = ("units_completed", "units_lost", "accept", "reject", "packages_completed", "recoveries")
+
+
+@unittest.skipUnless(HAVE_SIMPY, "needs simpy")
+class TestRoundTrip(unittest.TestCase):
+    def test_branch_continues_the_run_exactly(self):
+        import checkpoint
+        import headless_line
+        full = headless_line.run_line(1200, seed=1, quiet="mute")
+        snap, _ = checkpoint.warm_up(600, seed=1, quiet="mute")
+        snap = checkpoint.loads(checkpoint.dumps(snap))
+        branch = checkpoint.branch(snap, 600, quiet="mute")
+        self.assertEqual(branch["sim_s"] + snap["now_ns"] / 1e9, full["sim_s"])
+        self.assertGreater(full["kpis"]["units_completed"], 0)
+        for k in KEYS:
+            self.assertEqual(branch["kpis"].get(k), full["kpis"].get(k), k)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,59 @@
+import os
+import sys
+import unittest
+
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+
+import doe  # noqa: E402
+
+
+class TestDesigns(unittest.TestCase):
+    def test_full_factorial_covers_every_combination(self):
+        pts = doe.full_factorial({"reset_pulse_ticks": [1, 3, 5], "fast_handoff": [0, 1]})
+        self.assertEqual(len(pts), 6)
+        self.assertEqual({(p["reset_pulse_ticks"], p["fast_handoff"]) for p in pts},
+                         {(r, f) for r in (1, 3, 5) for f in (0, 1)})
+
+    def test_latin_hypercube_one_point_per_stratum(self):
+        n = 8
+        pts = doe.latin_hypercube({"a": (0.0, 8.0), "b": (10.0, 18.0)}, n, seed=3)
+        self.assertEqual(len(pts), n)
+        for name, lo in (("a", 0.0), ("b", 10.0)):
+            strata = sorted(int(p[name] - lo) for p in pts)
+            self.assertEqual(strata, list(range(n)))
+
+    def test_latin_hypercube_is_reproducible(self):
+        r = {"reset_pulse_ticks": (1, 6)}
+        self.assertEqual(doe.latin_hypercube(r, 5, seed=1), doe.latin_hypercube(r, 5, seed=1))
+        self.assertTrue(all(isinstance(p["reset_pulse_ticks"], int) for p in doe.latin_hypercube(r, 5)))
+
+    def test_fractional_half_fraction_defining_relation(self):
+        ranges = {"reset_pulse_ticks": (1, 5), "fault_reset_all": (0, 1), "fast_handoff": (0, 1)}
+        pts = doe.fractional_factorial(ranges)
+        self.assertEqual(len(pts), 4)
+        for p in pts:
+            coded = [-1 if p[k] == lo else 1 for k, (lo, _) in ranges.items()]
+            self.assertEqual(coded[0] * coded[1] * coded[2], 1)
+
+    def test_fractional_with_generator(self):
+        ranges = {"a": (0, 1), "b": (0, 1), "c": (0, 1), "d": (0, 1)}
+        pts = doe.fractional_factorial(ranges, {"d": "a*b"})
+        self.assertEqual(len(pts), 8)
+        for p in pts:
+            self.assertEqual(p["d"] == 1, (p["a"] == 1) == (p["b"] == 1))
+
+    def test_fractional_rejects_bad_generators(self):
+        ranges = {"a": (0, 1), "b": (0, 1), "c": (0, 1)}
+        with self.assertRaises(ValueError):
+            doe.fractional_factorial(ranges, {"c": "a*bogus"})
+        with self.assertRaises(ValueError):
+            doe.fractional_factorial(ranges, {"z": "a*b"})
+
+    def test_build_design_rejects_inert_and_unknown_factors(self):
+        for name in ("buf_max", "operators_total", "operators_required.S3", "nonsense"):
+            with self.assertRaises(ValueError):
+                doe.build_design("full", {name: [1, 2]})
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,86 @@
+import os
+import struct
+import sys
+import tempfile
+import unittest
+
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+
+import kpi_bus  # noqa: E402
+
+SNAP = {
+    "sim_time_s": 120.0, "plc_state": "WAIT_S3_DONE", "batch_id": 7, "recipe_id": 1,
+    "packages_completed": 3, "throughput_per_min": 1.5, "accept": 3, "reject": 1, "yield_pct": 75.0,
+    "buffers": {"S1_to_S2": 1, "S2_to_S3": 0}, "buffer_avg_occupancy": {"S1_to_S2": 0.25},
+    "idle_s": {"S1": 4.0}, "wip": 1, "units_completed": 4, "units_lost": 0,
+    "lead_time_s": {"count": 4, "mean": 200.0, "p50": 190.0, "p90": 250.0, "p99": 260.0, "max": 261.0},
+    "steady_state": {"warmup": {"truncated_s": 60.0, "units": 1, "settled": True}, "units": 3,
+                     "throughput_per_min": {"mean": 0.5, "ci95": [0.4, 0.6], "half_width": 0.1,
+                                            "rel_precision": 0.2, "batches": 10, "n": 30}},
+    "stations": {"S1": {"ready": 1, "busy": 0, "fault": 0, "done": 1, "cycle_time_ms": 9600},
+                 "S3": {"ready": 0, "busy": 1, "fault": 0, "done": 0, "cycle_time_ms": 0}},
+}
+
+
+class TestKpiBus(unittest.TestCase):
+    def setUp(self):
+        fd, self.path = tempfile.mkstemp(prefix="kpi_bus_test")
+        os.close(fd)
+        self.writer = kpi_bus.KpiBusWriter(self.path)
+        self.reader = kpi_bus.KpiBusReader(self.path)
+
+    def tearDown(self):
+        self.reader.close()
+        self.writer.close()
+        os.unlink(self.path)
+
+    def test_nothing_before_the_first_publish(self):
+        self.assertEqual(self.reader.read(), {})
+        self.assertEqual(self.reader.seq(), 0)
+
+    def test_round_trip(self):
+        self.writer.publish(SNAP)
+        snap = self.reader.read()
+        self.assertEqual(snap["seq"], 2)
+        for k in ("sim_time_s", "plc_state", "batch_id", "packages_completed", "throughput_per_min",
+                  "yield_pct", "buffers", "wip", "units_completed", "lead_time_s"):
+            self.assertEqual(snap[k], SNAP[k], k)
+        self.assertEqual(snap["idle_s"], {"S1": 4.0, "S3": 0.0})
+        self.assertEqual(snap["stations"]["S3"]["busy"], 1)
+        self.assertEqual(snap["stations"]["S1"]["cycle_time_ms"], 9600)
+        tpm = snap["steady_state"]["throughput_per_min"]
+        self.assertEqual((tpm["mean"], tpm["ci95"], tpm["n"]), (0.5, [0.4, 0.6], 30))
+        self.assertIsNone(snap["steady_state"]["cycle_time_s"]["mean"])
+        self.writer.publish(dict(SNAP, sim_time_s=122.0))
+        self.assertEqual((self.reader.read()["sim_time_s"], self.reader.seq()), (122.0, 4))
+
+    def test_write_in_progress_is_never_returned(self):
+        self.writer.publish(SNAP)
+        struct.pack_into("<Q", self.writer._mm, kpi_bus._SEQ_OFF, 3)
+        self.assertEqual(self.reader.read(retries=5), {})
+
+    def test_torn_read_is_retried(self):
+        self.writer.publish(SNAP)
+        unpack = kpi_bus.KpiBusReader._unpack
+        calls = []
+
+        def racing_unpack(mm):
+            snap = unpack(mm)
+            if not calls:
+                # the writer publishes while this reader is halfway through
+                self.writer.publish(dict(SNAP, sim_time_s=124.0))
+            calls.append(snap["sim_time_s"])
+            return snap
+        self.reader._unpack = racing_unpack
+        snap = self.reader.read()
+        self.assertEqual(calls, [120.0, 124.0])
+        self.assertEqual((snap["sim_time_s"], snap["seq"]), (124.0, 4))
+
+    def test_other_layout_is_not_mapped(self):
+        struct.pack_into("<I", self.writer._mm, 4, kpi_bus.VERSION + 1)
+        self.writer.publish(SNAP)
+        self.assertEqual(self.reader.read(), {})
+
+
+if __name__ == "__main__":
+    unittest.main()
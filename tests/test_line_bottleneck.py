@@ -0,0 +1,89 @@
+import os
+import sys
+import unittest
+
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+
+import line_bottleneck  # noqa: E402
+from line_bottleneck import ActivePeriodDetector  # noqa: E402
+
+S = 1_000_000_000
+
+
+def feed(det, periods, end_s):
+    """periods: station -> [(start_s, end_s)] of activity; samples at every boundary."""
+    times = sorted({0, end_s} | {t for ps in periods.values() for p in ps for t in p})
+    for t in times:
+        det.observe(t * S, {st: any(a <= t < b for a, b in ps) for st, ps in periods.items()})
+
+
+class TestActivePeriod(unittest.TestCase):
+    def test_overlap_is_shifting_the_rest_sole(self):
+        det = ActivePeriodDetector(["A", "B"], windows_s=(20,))
+        feed(det, {"A": [(0, 10)], "B": [(5, 20)]}, 20)
+        w = det.window(20 * S)
+        # A alone 0-5; B's longer period wins from 5; they overlap 5-10
+        self.assertEqual(w["primary"], "B")
+        self.assertAlmostEqual(w["primary_share"], 0.75)
+        self.assertEqual(w["sole_pct"], {"A": 25.0, "B": 50.0})
+        self.assertEqual(w["shifting_pct"], {"A": 25.0, "B": 25.0})
+        self.assertEqual(w["active_pct"], {"A": 50.0, "B": 75.0})
+
+    def test_back_to_back_periods_do_not_shift(self):
+        det = ActivePeriodDetector(["A", "B", "C"], windows_s=(20,))
+        feed(det, {"A": [(0, 10)], "B": [(10, 20)], "C": []}, 20)
+        w = det.window(20 * S)
+        self.assertEqual(w["sole_pct"], {"A": 50.0, "B": 50.0, "C": 0.0})
+        self.assertEqual(w["shifting_pct"], {"A": 0.0, "B": 0.0, "C": 0.0})
+
+    def test_current_is_the_longest_running_period(self):
+        det = ActivePeriodDetector(["A", "B"])
+        det.update("A", 0, True)
+        det.update("B", 3 * S, True)
+        self.assertEqual(det.current(), "A")
+        det.update("A", 4 * S, False)
+        self.assertEqual(det.current(), "B")
+        det.update("B", 5 * S, False)
+        self.assertIsNone(det.current())
+        self.assertIsNone(ActivePeriodDetector(["A"]).window(S))
+
+    def test_idle_line_has_no_primary(self):
+        det = ActivePeriodDetector(["A", "B"], windows_s=(10,))
+        feed(det, {"A": [], "B": []}, 10)
+        self.assertIsNone(det.window(10 * S)["primary"])
+
+    def test_old_periods_are_trimmed(self):
+        det = ActivePeriodDetector(["A"], windows_s=(10,))
+        for k in range(100):
+            det.update("A", 2 * k * S, True)
+            det.update("A", (2 * k + 1) * S, False)
+        self.assertLessEqual(len(det.closed["A"]), 6)
+        self.assertAlmostEqual(det.window(10 * S)["active_pct"]["A"], 50.0)
+
+    def test_summary_refreshes_at_most_every_refresh_s(self):
+        det = ActivePeriodDetector(["A", "B"], windows_s=(20,), refresh_s=10)
+        feed(det, {"A": [(0, 10)], "B": [(5, 20)]}, 20)
+        first = det.summary()
+        self.assertEqual(first["windows"]["20"]["primary"], "B")
+        det.update("A", 21 * S, True)
+        det.update("B", 22 * S, False)
+        self.assertIs(det.summary()["windows"], first["windows"])
+        self.assertEqual(det.summary()["current"], "A")
+        self.assertIsNot(det.summary(force=True)["windows"], first["windows"])
+
+    def test_merge_runs_on_the_slowest_clock(self):
+        fast, slow = ActivePeriodDetector(["S1"]), ActivePeriodDetector(["S2"])
+        self.assertIsNone(line_bottleneck.merge([fast, slow]))
+        fast.update("S1", 0, True)
+        fast.update("S1", 100 * S, False)
+        slow.update("S2", 10 * S, True)
+        slow.update("S2", 50 * S, True)
+        line = line_bottleneck.merge([fast, slow], windows_s=(50,))
+        self.assertEqual((line.order, line.last_ns), (["S1", "S2"], 50 * S))
+        self.assertEqual(line.current(), "S2")
+        w = line.window(50 * S)
+        self.assertEqual(w["active_pct"], {"S1": 100.0, "S2": 80.0})
+
+
+if __name__ == "__main__":
+    unittest.main()
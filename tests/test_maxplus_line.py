@@ -0,0 +1,68 @@
+import os
+import sys
+import unittest
+
+import numpy as np
+
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+
+import maxplus_line  # noqa: E402
+
+
+def naive_serial(p):
+    m, n = p.shape
+    S, D = np.zeros((m, n)), np.zeros((m, n))
+    t = 0.0
+    for j in range(n):
+        for i in range(m):
+            S[i, j] = t
+            t += p[i, j]
+            D[i, j] = t
+    return S, D
+
+
+def naive_pipelined(p, caps):
+    """The recursion in the maxplus_line docstring, one unit and one station at a time."""
+    m, n = p.shape
+    S, D = np.zeros((m, n)), np.zeros((m, n))
+    for j in range(n):
+        for i in range(m):
+            arrived = D[i - 1, j] if i > 0 else 0.0
+            free = D[i, j - 1] if j > 0 else 0.0
+            S[i, j] = max(arrived, free)
+            d = S[i, j] + p[i, j]
+            if i < m - 1:
+                k = j - caps[i] - 1
+                if k >= 0:
+                    d = max(d, D[i + 1, k])
+            D[i, j] = d
+    return S, D
+
+
+class TestDepartures(unittest.TestCase):
+    def setUp(self):
+        rng = np.random.default_rng(7)
+        self.p = rng.exponential(10.0, size=(len(maxplus_line.STATIONS), 300))
+
+    def test_serial_matches_a_plain_loop(self):
+        S, D = maxplus_line.serial_departures(self.p)
+        nS, nD = naive_serial(self.p)
+        np.testing.assert_allclose(S, nS)
+        np.testing.assert_allclose(D, nD)
+
+    def test_pipelined_matches_a_plain_loop(self):
+        for caps in ([1, 1, 1, 1, 1], [0, 2, 3, 0, 5], [4, 4, 4, 4, 4]):
+            for chunk in (None, 7, 300):
+                S, D = maxplus_line.departures(self.p, caps, chunk=chunk)
+                nS, nD = naive_pipelined(self.p, caps)
+                np.testing.assert_allclose(S, nS, err_msg=f"caps {caps} chunk {chunk}")
+                np.testing.assert_allclose(D, nD, err_msg=f"caps {caps} chunk {chunk}")
+
+    def test_pipelined_never_slower_than_serial(self):
+        _, Ds = maxplus_line.serial_departures(self.p)
+        _, Dp = maxplus_line.departures(self.p, [1] * len(maxplus_line.BUFFERS))
+        self.assertTrue(np.all(Dp[-1] <= Ds[-1] + 1e-9))
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,53 @@
+import importlib.util
+import os
+import sys
+import unittest
+
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+
+HAVE_SIMPY = importlib.util.find_spec("simpy") is not None
+
+
+@unittest.skipUnless(HAVE_SIMPY, "needs simpy")
+class TestSamplers(unittest.TestCase):
+    def setUp(self):
+        import mc_kernels
+        self.mc = mc_kernels
+        self.st2 = mc_kernels._module("S2")
+
+    def test_st2_rates_follow_the_module_constants(self):
+        m = self.st2
+        s = self.mc.summarize(self.mc.sample_station("S2", 200_000, seed=1))
+        self.assertAlmostEqual(1.0 - s["yield"], m.ST2_P_SCRAP, delta=0.002)
+        self.assertAlmostEqual(s["rework_rate"], m.ST2_P_REWORK, delta=0.002)
+        self.assertAlmostEqual(s["cycle_mean_s"], m.ST2_BASE_TIME_S, delta=0.02)
+        self.assertEqual(s["fault_rate"], 0.0)
+
+    def test_params_apply_for_the_call_only(self):
+        base = self.st2.ST2_BASE_TIME_S
+        s = self.mc.sample_station("S2", 1000, seed=2, params={"ST2_BASE_TIME_S": 2 * base, "ST2_JITTER": 0.0})
+        self.assertTrue((s["cycle_s"] == 2 * base).all())
+        self.assertEqual(self.st2.ST2_BASE_TIME_S, base)
+        with self.assertRaises(KeyError):
+            self.mc.sample_station("S2", 10, params={"NO_SUCH_CONSTANT": 1})
+
+    def test_st6_refills_follow_the_unit_index(self):
+        m = self.mc._module("S6")
+        first = int(m.ST6_STOCK_INITIAL)
+        s = self.mc.sample_station("S6", 2 * int(m.ST6_STOCK_REFILL), seed=3)
+        self.assertEqual(s["refill"].nonzero()[0].tolist(), [first, first + int(m.ST6_STOCK_REFILL)])
+        s = self.mc.sample_station("S6", 3, seed=3, first_unit=first - 1)
+        self.assertEqual(s["refill"].tolist(), [False, True, False])
+
+    def test_line_is_reproducible_per_seed(self):
+        a = self.mc.sample_line(500, seed=7)
+        b = self.mc.sample_line(500, seed=7)
+        self.assertEqual(sorted(a), ["S1", "S2", "S3", "S4", "S5", "S6"])
+        for st in a:
+            self.assertTrue((a[st]["cycle_s"] == b[st]["cycle_s"]).all(), st)
+            self.assertTrue((a[st]["ok"] == b[st]["ok"]).all(), st)
+        self.assertEqual(self.mc._split_params({"ST2_P_SCRAP": 0.1}), {"S2": {"ST2_P_SCRAP": 0.1}})
+
+
+if __name__ == "__main__":
+    unittest.main()
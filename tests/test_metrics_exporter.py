@@ -0,0 +1,70 @@
+import importlib
+import os
+import re
+import sys
+import types
+import unittest
+
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+
+import metrics_exporter  # noqa: E402
+
+SAMPLE = re.compile(r'^([a-zA-Z_:][a-zA-Z0-9_:]*)(\{[^}]*\})? (\S+)$')
+
+SNAP = {
+    "sim_time_s": 120.0, "plc_state": "RUN", "packages_completed": 3, "throughput_per_min": 1.5,
+    "accept": 3, "reject": 1, "yield_pct": 75.0, "buffers": {"S1_to_S2": 1},
+    "idle_s": {"S1": 4.0}, "recoveries": {"line": 1}, "lead_time_s": {"mean": 200.0, "p90": 250.0},
+    "stations": {"S1": {"ready": 1, "busy": 0, "fault": 0}},
+}
+
+
+class TestOpenMetrics(unittest.TestCase):
+    def setUp(self):
+        importlib.reload(metrics_exporter)
+        ms = types.SimpleNamespace(S1_done=0, S1_cycle_time_ms=0)
+        for done, ct in ((0, 0), (1, 9600), (0, 0), (1, 12500)):
+            ms.S1_done, ms.S1_cycle_time_ms = done, ct
+            metrics_exporter.observe_scan(None, ms, ["S1"], snap=SNAP)
+        self.text = metrics_exporter.render().decode("utf-8")
+
+    def test_ends_with_eof(self):
+        self.assertTrue(self.text.endswith("# EOF\n"))
+        self.assertEqual(self.text.count("# EOF"), 1)
+
+    def test_every_sample_belongs_to_a_declared_family(self):
+        types_ = {}
+        for line in self.text.splitlines():
+            if line.startswith("# TYPE "):
+                _, _, name, kind = line.split(" ", 3)
+                self.assertNotIn(name, types_, f"family {name} declared twice")
+                types_[name] = kind
+                continue
+            if line.startswith("#"):
+                self.assertRegex(line, r"^# (HELP|UNIT|EOF)")
+                continue
+            m = SAMPLE.match(line)
+            self.assertIsNotNone(m, line)
+            name = m.group(1)
+            suffixes = {"counter": ("_total", "_created"), "histogram": ("_bucket", "_count", "_sum"),
+                        "info": ("_info",)}
+            family = next((f for f in types_ if name == f or any(name == f + s for s in suffixes.get(types_[f], ()))),
+                          None)
+            self.assertIsNotNone(family, f"sample {name} has no # TYPE")
+            if types_[family] == "counter":
+                self.assertTrue(name.endswith(("_total", "_created")), name)
+            float(m.group(3))
+
+    def test_histogram_buckets_are_cumulative(self):
+        buckets = [(m.group(1), int(m.group(2))) for m in
+                   re.finditer(r'station_cycle_time_ms_bucket\{station="S1",le="([^"]+)"\} (\d+)', self.text)]
+        counts = [c for _, c in buckets]
+        self.assertEqual(counts, sorted(counts))
+        self.assertEqual(buckets[-1], ("+Inf", 2))
+        self.assertIn('station_cycle_time_ms_count{station="S1"} 2', self.text)
+        self.assertIn('station_cycle_time_ms_sum{station="S1"} 22100.0', self.text)
+        self.assertIn('station_cycles_total{station="S1"} 2', self.text)
+
+
+if __name__ == "__main__":
+    unittest.main()
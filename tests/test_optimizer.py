@@ -0,0 +1,77 @@
+import math
+import os
+import sys
+import unittest
+
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+
+import optimizer  # noqa: E402
+
+
+class TestGaussianProcess(unittest.TestCase):
+    def setUp(self):
+        self.X = [[x / 6.0] for x in range(7)]
+        self.y = [math.sin(3.0 * x[0]) for x in self.X]
+
+    def test_fit_reproduces_training_points(self):
+        gp = optimizer.GaussianProcess().fit(self.X, self.y)
+        for x, y in zip(self.X, self.y):
+            mu, sd = gp.predict(x)
+            self.assertAlmostEqual(mu, y, delta=0.05)
+            self.assertLess(sd, 0.05)
+
+    def test_uncertainty_grows_away_from_data(self):
+        gp = optimizer.GaussianProcess().fit(self.X[:3], self.y[:3])
+        _, near = gp.predict([1.0 / 6.0])
+        _, far = gp.predict([1.0])
+        self.assertGreater(far, near)
+
+    def test_duplicate_points_factor(self):
+        gp = optimizer.GaussianProcess().fit([[0.5]] * 4, [1.0, 2.0, 1.5, 1.2], [0.0] * 4)
+        mu, _ = gp.predict([0.5])
+        self.assertAlmostEqual(mu, 1.425, delta=0.01)
+
+    def test_fit_failure_is_a_clear_error(self):
+        orig = optimizer._cholesky
+
+        def never(a):
+            raise ValueError("matrix not positive definite")
+        optimizer._cholesky = never
+        try:
+            with self.assertRaisesRegex(ValueError, "every lengthscale"):
+                optimizer.GaussianProcess().fit(self.X, self.y)
+        finally:
+            optimizer._cholesky = orig
+
+
+class TestPropose(unittest.TestCase):
+    def _optimizer(self):
+        opt = optimizer.Optimizer({"reset_pulse_ticks": (1, 6), "fast_handoff": (0, 1)},
+                                  budget=8, batch=3, n_init=3, record=False)
+        for r, f in ((1, 0), (3, 1), (6, 0)):
+            p = {"reset_pulse_ticks": r, "fast_handoff": f}
+            opt.obs[opt.space.key(p)] = {"point": p, "ys": [0.4 - 0.02 * r, 0.41 - 0.02 * r]}
+        return opt
+
+    def test_propose_new_distinct_points_in_the_space(self):
+        opt = self._optimizer()
+        props = opt.propose(3)
+        self.assertEqual(len(props), 3)
+        keys = [opt.space.key(p) for p in props]
+        self.assertEqual(len(set(keys)), 3)
+        for p in props:
+            self.assertNotIn(opt.space.key(p), opt.obs)
+            self.assertTrue(1 <= p["reset_pulse_ticks"] <= 6 and p["fast_handoff"] in (0, 1))
+
+    def test_failed_points_are_not_proposed_again(self):
+        opt = self._optimizer()
+        for r in range(1, 7):
+            for f in (0, 1):
+                p = {"reset_pulse_ticks": r, "fast_handoff": f}
+                if opt.space.key(p) not in opt.obs and (r, f) != (2, 0):
+                    opt.failed[opt.space.key(p)] = p
+        self.assertEqual(opt.propose(3), [{"reset_pulse_ticks": 2, "fast_handoff": 0}])
+
+
+if __name__ == "__main__":
+    unittest.main()
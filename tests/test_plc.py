@@ -0,0 +1,179 @@
+import contextlib
+import io
+import os
+import sys
+import types
+import unittest
+
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+
+import headless_line  # noqa: E402
+
+plc = headless_line.import_component("PLC_LineCoordinator")
+
+S = 1_000_000_000
+
+
+def make_plc(now_s=100.0, **opts):
+    """A coordinator outside mainThread(), on a stub fabric parked at now_s."""
+    headless_line._fabric = headless_line.Fabric(3600 * S, 2 * S, start_ns=int(now_s * S))
+    return plc.PLC_LineCoordinator(types.SimpleNamespace(domain="AF_UNIX", server_url="localhost", **opts))
+
+
+def walk_to(p, st, now_ns=0):
+    """One unit started at S1 and handed on up to st, which is working on it."""
+    for s in plc.STATIONS[:plc.STATIONS.index(st)]:
+        p._wip.start(s, now_ns, 1)
+        p._wip.finish(s, now_ns)
+    p._wip.start(st, now_ns, 1)
+    p._state = f"WAIT_{st}_DONE"
+    p._start_sent[st] = True
+    p._wd.arm(st, now_ns)
+
+
+class TestWatchdog(unittest.TestCase):
+    def test_cold_start_deadline_until_enough_cycles(self):
+        wd = plc._Watchdog()
+        self.assertEqual(wd.deadline_ns("S1", slack_ns=4 * S), int(plc.WATCHDOG_INITIAL_S * S) + 4 * S)
+        for k in range(plc.WATCHDOG_MIN_SAMPLES - 1):
+            wd.arm("S1", 100 * k * S)
+            wd.observe_done("S1", (100 * k + 10) * S)
+        self.assertFalse(wd.summary()["learned"]["S1"])
+        wd.arm("S1", 1000 * S)
+        wd.observe_done("S1", 1020 * S)
+        self.assertTrue(wd.summary()["learned"]["S1"])
+        # p99 of the window (20 s) times the margin, plus the slack
+        self.assertEqual(wd.deadline_ns("S1", slack_ns=4 * S), int(20 * S * plc.WATCHDOG_MARGIN) + 4 * S)
+
+    def test_one_sample_per_start(self):
+        wd = plc._Watchdog()
+        wd.arm("S2", 0)
+        wd.observe_done("S2", 10 * S)
+        wd.observe_done("S2", 12 * S)       # done still high on the next scan
+        wd.observe_done("S3", 5 * S)        # never armed
+        self.assertEqual((list(wd.samples["S2"]), list(wd.samples["S3"])), ([10 * S], []))
+        # the timer keeps running after done until the station is handed on
+        self.assertEqual(wd.waited_ns("S2", 15 * S), 15 * S)
+
+    def test_expiry_and_trip(self):
+        wd = plc._Watchdog()
+        limit = wd.deadline_ns("S4")
+        self.assertFalse(wd.expired("S4", limit + 1))       # not armed
+        wd.arm("S4", 0)
+        self.assertFalse(wd.expired("S4", limit))
+        self.assertTrue(wd.expired("S4", limit + 1))
+        alarm = wd.trip("S4", limit + 1, 0, state="WAIT_S4_DONE")
+        self.assertEqual((alarm["station"], alarm["state"], alarm["samples"]), ("S4", "WAIT_S4_DONE", 0))
+        self.assertFalse(wd.expired("S4", 10 * limit))
+        s = wd.summary()
+        self.assertEqual(s["alarms"]["S4"], 1)
+        self.assertEqual(s["last_alarm"]["station"], "S4")
+
+    def test_disarm(self):
+        wd = plc._Watchdog()
+        wd.arm("S5", 0)
+        wd.arm("S6", 0)
+        wd.disarm("S5")
+        self.assertEqual(wd.waited_ns("S5", 50 * S), 0)
+        wd.disarm_all()
+        self.assertFalse(wd.expired("S6", 10 ** 6 * S))
+
+
+class TestFaultRecovery(unittest.TestCase):
+    def setUp(self):
+        quiet = contextlib.redirect_stdout(io.StringIO())
+        quiet.__enter__()
+        self.addCleanup(quiet.__exit__, None, None, None)
+
+    def tearDown(self):
+        headless_line._fabric = None
+
+    def test_line_mode_drains_the_line(self):
+        p = make_plc()
+        walk_to(p, "S3")
+        p._enter_fault_recovery(p.mySignals, {"S3"})
+        self.assertEqual((p._state, p._recovering, p._fault_stations), ("FAULT_RESET", "line", {"S3"}))
+        self.assertEqual(p.recovery_summary()["count"], {"line": 1, "local": 0})
+
+    def test_unfinished_unit_is_requeued(self):
+        p = make_plc(local_recovery=True)
+        walk_to(p, "S3")
+        unit = p._wip.at["S3"]
+        p._enter_fault_recovery(p.mySignals, {"S3"})
+        self.assertEqual((p._state, p._resume_state, p._recovering), ("LOCAL_RESET", "START_S3", "local"))
+        self.assertEqual(p._buffers["S2_to_S3"], 1)
+        self.assertIsNone(p._wip.at["S3"])
+        self.assertIs(p._wip.fifo["S2_to_S3"][0], unit)
+        self.assertEqual(unit.restarts, 1)
+        self.assertFalse(p._start_sent["S3"])
+        self.assertEqual(p._wd.waited_ns("S3", 200 * S), 0)
+        self.assertEqual(p.recovery_summary()["count"], {"line": 0, "local": 1})
+
+    def test_unit_finished_in_the_fault_scan_is_kept(self):
+        p = make_plc(local_recovery=True)
+        walk_to(p, "S3")
+        p.mySignals.S3_done, p.mySignals.S3_done_time_ns = 1, 99 * S
+        p._enter_fault_recovery(p.mySignals, {"S3"})
+        self.assertEqual((p._state, p._resume_state), ("LOCAL_RESET", "WAIT_S3_DONE"))
+        self.assertTrue(p._done_latched["S3"])
+        self.assertEqual(p._buffers["S2_to_S3"], 0)
+        self.assertIsNotNone(p._wip.at["S3"])
+
+    def test_idle_station_fault_leaves_the_unit_alone(self):
+        p = make_plc(local_recovery=True)
+        walk_to(p, "S2")
+        p._done_latched["S5"] = True
+        p._enter_fault_recovery(p.mySignals, {"S5"})
+        self.assertEqual((p._state, p._resume_state), ("LOCAL_RESET", "WAIT_S2_DONE"))
+        self.assertFalse(p._done_latched["S5"])
+        self.assertIsNotNone(p._wip.at["S2"])
+        self.assertTrue(p._start_sent["S2"])
+
+    def test_fault_while_waiting_for_ready_widens_the_recovery(self):
+        p = make_plc(local_recovery=True)
+        walk_to(p, "S2")
+        p._enter_fault_recovery(p.mySignals, {"S5"})
+        p._state = "LOCAL_WAIT_READY"
+        p._enter_fault_recovery(p.mySignals, {"S6"})
+        self.assertEqual((p._state, p._resume_state), ("LOCAL_RESET", "WAIT_S2_DONE"))
+        self.assertEqual(p._fault_stations, {"S5", "S6"})
+        self.assertEqual(p.recovery_summary()["count"]["local"], 1)
+
+
+class TestDoneLatch(unittest.TestCase):
+    def setUp(self):
+        self.p = make_plc(now_s=100.0)
+        self.ms = self.p.mySignals
+
+    def tearDown(self):
+        headless_line._fabric = None
+
+    def test_done_ns_uses_the_station_timestamp_when_plausible(self):
+        now = 100 * S
+        for t, expected in ((0, now), (97 * S, 97 * S), (now, now), (now + 1, now)):
+            self.ms.S2_done_time_ns = t
+            self.assertEqual(self.p._done_ns(self.ms, "S2", now), expected, t)
+
+    def test_handed_on_completion_is_not_latched_again(self):
+        p, ms = self.p, self.ms
+        self.assertFalse(p._fresh_done(ms, "S2"))
+        walk_to(p, "S2", now_ns=90 * S)
+        ms.S2_done, ms.S2_done_time_ns, ms.S2_cycle_time_ms = 1, 97 * S, 4000
+        self.assertTrue(p._fresh_done(ms, "S2"))
+        unit = p._finish_unit(ms, "S2", 100 * S)
+        # done stays high for the scan that consumed it
+        self.assertFalse(p._fresh_done(ms, "S2"))
+        self.assertEqual((unit.enter_ns["S2"], unit.exit_ns["S2"]), (93 * S, 97 * S))
+        ms.S2_done_time_ns = 130 * S
+        self.assertTrue(p._fresh_done(ms, "S2"))
+
+    def test_station_without_timestamps_latches_on_level(self):
+        p, ms = self.p, self.ms
+        walk_to(p, "S1", now_ns=90 * S)
+        ms.S1_done, ms.S1_done_time_ns = 1, 0
+        p._finish_unit(ms, "S1", 100 * S)
+        self.assertTrue(p._fresh_done(ms, "S1"))
+
+
+if __name__ == "__main__":
+    unittest.main()
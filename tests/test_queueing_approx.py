@@ -0,0 +1,82 @@
+import importlib.util
+import os
+import sys
+import unittest
+
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+
+import queueing_approx as qa  # noqa: E402
+
+HAVE_SIMPY = importlib.util.find_spec("simpy") is not None
+
+
+def moments(means, scv=1.0):
+    return {st: {"mean_s": float(m), "scv": scv, "good": 1.0} for st, m in zip(qa.STATIONS, means)}
+
+
+class TestClosedForms(unittest.TestCase):
+    def test_two_machine_block_matches_the_birth_death_chain(self):
+        # rho = 1/2, three states with weights 4:2:1
+        th, p0, pk, n = qa._block(0.5, 1.0, 2)
+        for got, want in ((th, 3 / 7), (p0, 4 / 7), (pk, 1 / 7), (n, 4 / 7)):
+            self.assertAlmostEqual(got, want)
+        # the same chain seen from the full end
+        th, p0, pk, n = qa._block(2.0, 1.0, 2)
+        for got, want in ((th, 6 / 7), (p0, 1 / 7), (pk, 4 / 7), (n, 10 / 7)):
+            self.assertAlmostEqual(got, want)
+        th, p0, pk, n = qa._block(1.0, 1.0, 3)
+        self.assertEqual((p0, pk, n), (0.25, 0.25, 1.5))
+        self.assertAlmostEqual(th, 0.75)
+
+    def test_clipped_uniform(self):
+        self.assertEqual(qa._uniform_clipped(2.0, 4.0, 1.0), (3.0, 28.0 / 3.0))
+        self.assertEqual(qa._uniform_clipped(2.0, 4.0, 5.0), (5.0, 25.0))
+        m1, m2 = qa._uniform_clipped(0.0, 4.0, 2.0)     # half the mass sits on the floor
+        self.assertAlmostEqual(m1, 0.5 * 2.0 + 0.5 * 3.0)
+        self.assertAlmostEqual(m2, 0.5 * 4.0 + (64.0 - 8.0) / 12.0)
+
+    def test_fault_adds_recovery_and_a_fresh_attempt(self):
+        branches = [qa._branch(0.9, 10.0), qa._branch(0.1, 10.0, fault=True)]
+        mean, scv = qa._effective(branches, fault_recovery_s=5.0, handoff_s=0.0)
+        self.assertAlmostEqual(mean, 0.9 * 10.0 + 0.1 * (10.0 + 5.0 + 10.0))
+        self.assertGreater(scv, 0.0)
+        mean, scv = qa._effective([qa._branch(1.0, 10.0)], 0.0, handoff_s=2.0)
+        self.assertEqual((mean, scv), (12.0, 0.0))
+
+
+class TestApproximate(unittest.TestCase):
+    def test_serial_line_is_the_sum_of_the_stations(self):
+        r = qa.approximate(moments([10, 20, 10, 10, 30, 20]))
+        self.assertAlmostEqual(r["throughput_per_hour"], 36.0)
+        self.assertEqual((r["wip"], r["lead_time_s"], r["bottleneck"]), (1.0, 100.0, "S5"))
+        self.assertAlmostEqual(r["stations"]["S2"]["idle_pct"], 80.0)
+        self.assertAlmostEqual(sum(s["utilization_pct"] for s in r["stations"].values()), 100.0)
+
+    def test_pipelined_line_approaches_its_bottleneck(self):
+        m = moments([10, 10, 20, 10, 10, 10])
+        small = qa.approximate(m, caps=[1] * 5, controller="pipelined")
+        large = qa.approximate(m, caps=[50] * 5, controller="pipelined")
+        self.assertLess(small["throughput_per_hour"], large["throughput_per_hour"])
+        self.assertLessEqual(large["throughput_per_hour"], 180.0)
+        self.assertGreater(large["throughput_per_hour"], 0.95 * 180.0)
+        self.assertEqual(large["bottleneck"], "S3")
+        self.assertAlmostEqual(large["lead_time_s"], large["wip"] * 3600.0 / large["throughput_per_hour"])
+
+    def test_unknown_controller(self):
+        with self.assertRaises(ValueError):
+            qa.approximate(moments([1] * 6), controller="kanban")
+
+
+@unittest.skipUnless(HAVE_SIMPY, "needs simpy")
+class TestStationMoments(unittest.TestCase):
+    def test_moments_agree_with_the_samplers(self):
+        import mc_kernels
+        m = qa.station_moments()
+        for st in ("S2", "S4", "S6"):
+            s = mc_kernels.summarize(mc_kernels.sample_station(st, 400_000, seed=5))
+            self.assertAlmostEqual(m[st]["mean_s"], s["cycle_mean_s"], delta=0.01 * s["cycle_mean_s"], msg=st)
+        self.assertAlmostEqual(m["S2"]["good"], 1.0 - mc_kernels._module("S2").ST2_P_SCRAP)
+
+
+if __name__ == "__main__":
+    unittest.main()
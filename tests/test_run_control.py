@@ -0,0 +1,68 @@
+import os
+import sys
+import unittest
+
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+
+import run_control  # noqa: E402
+
+
+def summary(rel, n=120, settled=True, cycle_rel=None):
+    ss = {"warmup": {"truncated_s": 600.0, "units": 5, "settled": settled},
+          "throughput_per_min": {"mean": 0.5, "half_width": 0.5 * rel, "rel_precision": rel, "n": n}}
+    if cycle_rel is not None:
+        ss["cycle_time_s"] = {"mean": 120.0, "half_width": 120.0 * cycle_rel, "rel_precision": cycle_rel, "n": n}
+    return ss
+
+
+class TestPrecisionMet(unittest.TestCase):
+    def test_needs_settled_warmup_enough_units_and_every_kpi(self):
+        self.assertEqual(run_control.precision_met(summary(0.04), 0.05), (True, {"throughput_per_min": 0.04}))
+        self.assertFalse(run_control.precision_met(summary(0.06), 0.05)[0])
+        self.assertFalse(run_control.precision_met(summary(0.04, settled=False), 0.05)[0])
+        self.assertFalse(run_control.precision_met(summary(0.04, n=99), 0.05)[0])
+        self.assertTrue(run_control.precision_met(summary(0.04, n=40), 0.05, min_units=40)[0])
+        kpis = ("throughput_per_min", "cycle_time_s")
+        self.assertFalse(run_control.precision_met(summary(0.04, cycle_rel=0.08), 0.05, kpis)[0])
+        met, rel = run_control.precision_met(summary(0.04), 0.05, kpis)
+        self.assertEqual((met, rel["cycle_time_s"]), (False, None))
+
+    def test_unknown_kpi(self):
+        with self.assertRaises(ValueError):
+            run_control.check_kpis(["lead_time_s"])
+
+
+class TestPrecisionMonitor(unittest.TestCase):
+    def test_checks_on_its_own_clock_and_latches(self):
+        calls = []
+        rels = iter([0.2, 0.1, 0.04])
+
+        def summary_fn():
+            calls.append(1)
+            return summary(next(rels))
+        mon = run_control.PrecisionMonitor(0.05, check_every_s=60.0)
+        self.assertFalse(mon.check(0.0, summary_fn))
+        self.assertFalse(mon.check(59.0, summary_fn))
+        self.assertFalse(mon.check(60.0, summary_fn))
+        self.assertEqual(mon.describe(), "not reached")
+        self.assertTrue(mon.check(130.0, summary_fn))
+        self.assertEqual(len(calls), 3)
+        self.assertEqual([t for t, _ in mon.trace], [0.0, 60.0, 130.0])
+        self.assertEqual(mon.report["stopped_at_s"], 130.0)
+        self.assertTrue(mon.check(131.0, summary_fn))       # stays reached, no new summary
+        self.assertEqual(len(calls), 3)
+        self.assertEqual(mon.describe(), "throughput_per_min 0.5 +/- 0.02")
+
+    def test_bad_settings(self):
+        with self.assertRaises(ValueError):
+            run_control.PrecisionMonitor(0)
+        with self.assertRaises(ValueError):
+            run_control.PrecisionMonitor(0.05, min_units=0)
+
+    def test_savings(self):
+        s = run_control.savings(used_s=3600.0, budget_s=14400.0, wall_s=10.0)
+        self.assertEqual((s["sim_s"], s["sim_pct"], s["wall_s_est"]), (10800.0, 75.0, 30.0))
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,80 @@
+import os
+import sys
+import unittest
+
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+
+import scan_profiler  # noqa: E402
+from scan_profiler import HdrHistogram  # noqa: E402
+
+
+class TestHdrBuckets(unittest.TestCase):
+    def test_small_values_are_exact(self):
+        for v in range(scan_profiler._LINEAR_MAX):
+            self.assertEqual(HdrHistogram._index(v), v)
+            self.assertEqual(HdrHistogram._upper(v), v)
+
+    def test_upper_bound_within_relative_error(self):
+        prev = -1
+        for v in list(range(60, 5000)) + [10 ** k + d for k in range(4, 13) for d in (-1, 0, 1)]:
+            i = HdrHistogram._index(v)
+            self.assertGreaterEqual(i, prev)
+            prev = i
+            up = HdrHistogram._upper(i)
+            self.assertLessEqual(v, up)
+            self.assertLessEqual(up - v, v / scan_profiler.SUB_COUNT, v)
+            # the bucket's upper bound is the last value that maps to it
+            self.assertEqual(HdrHistogram._index(up), i)
+            self.assertEqual(HdrHistogram._index(up + 1), i + 1)
+
+    def test_percentiles(self):
+        h = HdrHistogram()
+        for v in range(1, 1001):
+            h.record(v * 1000)
+        self.assertEqual((h.count, h.min, h.max), (1000, 1000, 1_000_000))
+        for q in (50, 90, 99):
+            self.assertAlmostEqual(h.percentile(q), q * 10_000, delta=q * 10_000 / scan_profiler.SUB_COUNT)
+        self.assertEqual(h.percentile(100), 1_000_000)
+        h.record(-5)
+        self.assertEqual(h.min, 0)
+
+
+class TestScanProfiler(unittest.TestCase):
+    def setUp(self):
+        self.now = 0
+        self._clock = scan_profiler.time.perf_counter_ns
+        scan_profiler.time.perf_counter_ns = lambda: self.now
+
+    def tearDown(self):
+        scan_profiler.time.perf_counter_ns = self._clock
+
+    def _scan(self, prof, laps, tail):
+        prof.begin_scan()
+        for phase, ns in laps:
+            self.now += ns
+            prof.lap(phase)
+        self.now += tail
+
+    def test_laps_and_remainder_go_to_their_phases(self):
+        prof = scan_profiler.ScanProfiler()
+        for _ in range(3):
+            self._scan(prof, [("logic", 400), ("tx", 100), ("hooks", 50)], tail=2000)
+        prof.finish()
+        s = prof.summary()
+        self.assertEqual(s["scans"], 3)
+        self.assertEqual(s["phases"]["rx"]["mean_us"], 2.0)
+        self.assertEqual(s["phases"]["logic"]["mean_us"], 0.4)
+        self.assertEqual(s["scan"]["mean_us"], 2.55)
+        self.assertAlmostEqual(sum(r["share"] for r in s["phases"].values()), 1.0)
+
+    def test_openmetrics_lines_cover_every_phase(self):
+        prof = scan_profiler.ScanProfiler()
+        self._scan(prof, [("logic", 10)], tail=10)
+        prof.finish()
+        lines = prof.openmetrics_lines()
+        for ph in scan_profiler.PHASES:
+            self.assertIn(f'plc_scan_phase_seconds_count{{phase="{ph}"}} 1', lines)
+
+
+if __name__ == "__main__":
+    unittest.main()
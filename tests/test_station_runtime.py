@@ -0,0 +1,129 @@
+import importlib.util
+import os
+import random
+import sys
+import unittest
+
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+
+HAVE_SIMPY = importlib.util.find_spec("simpy") is not None
+
+S = 1_000_000_000
+
+
+def make_station():
+    """A one-job station: a job takes a random 5-10 s and records when it ended."""
+    from station_runtime import LazyRuntime
+
+    class Station(LazyRuntime):
+        def __init__(self):
+            LazyRuntime.__init__(self)
+            self.done_at = None
+            self.busy = False
+
+        def start(self):
+            self.mark_job()
+            self.resume_job()
+
+        def resume_job(self):
+            self.busy = True
+            self.process(self._job())
+
+        def job_in_flight(self):
+            return self.busy
+
+        def _job(self):
+            yield self.env.timeout(random.uniform(5.0, 10.0))
+            self.busy = False
+            self.done_at = self.env.now
+
+    return Station()
+
+
+@unittest.skipUnless(HAVE_SIMPY, "needs simpy")
+class TestLazyStepping(unittest.TestCase):
+    def test_idle_ticks_do_not_run_the_env(self):
+        st = make_station()
+        for k in range(1, 11):
+            self.assertFalse(st.advance(100 * S + k * S))
+        self.assertEqual((st.env_runs, st.env_skips), (0, 10))
+        # anchored at the first tick: env time 0 is VSI 101 s
+        self.assertEqual(st.env_time(111 * S), 10.0)
+
+    def test_sync_catches_up_in_one_jump(self):
+        st = make_station()
+        st.advance(1 * S)
+        for k in range(2, 50):
+            st.advance(k * S)
+        self.assertEqual((st.env_runs, st.env.now), (0, 0.0))
+        # 48 skipped ticks are made up by a single env.run()
+        st.sync(49 * S)
+        self.assertEqual((st.env_runs, st.env.now), (1, 48.0))
+        random.seed(1)
+        st.start()
+        st.sync(200 * S)
+        self.assertEqual(st.env_runs, 2)
+        self.assertFalse(st.busy)
+        self.assertEqual(st.env.now, 199.0)
+
+    def test_job_end_maps_into_its_tick(self):
+        st = make_station()
+        st.sync(0)
+        random.seed(2)
+        st.start()
+        t = 0
+        while st.busy:
+            st.advance(t + S)
+            t += S
+        self.assertEqual(st.step_time_ns(st.done_at), int(round(st.done_at * S)))
+        self.assertGreater(st.done_at, (t - S) / S)
+        st.advance(t + S)
+        self.assertIsNone(st.step_time_ns(st.done_at))
+
+    def test_hold_stops_model_time(self):
+        st = make_station()
+        st.sync(10 * S)
+        st.hold(30 * S)
+        self.assertEqual(st.env_time(30 * S), 0.0)
+        st.advance(31 * S)
+        self.assertEqual(st.env_time(31 * S), 1.0)
+
+    def test_reset_keeps_the_model_time(self):
+        st = make_station()
+        st.sync(0)
+        random.seed(3)
+        st.start()
+        st.advance(2 * S)
+        st.reset_env()
+        self.assertEqual(st.env.now, 2.0)
+        st.sync(20 * S)
+        self.assertIsNone(st.done_at)       # the job was ended by the reset
+
+
+@unittest.skipUnless(HAVE_SIMPY, "needs simpy")
+class TestSnapshot(unittest.TestCase):
+    def test_restore_replays_the_job_in_flight(self):
+        st = make_station()
+        st.sync(0)
+        random.seed(4)
+        st.start()
+        st.sync(3 * S)
+        snap = st.snapshot()
+        st.sync(20 * S)
+        copy = make_station()
+        copy.restore(snap)
+        self.assertEqual((copy.env.now, copy.busy), (3.0, True))
+        copy.env.run(until=20.0)
+        self.assertEqual(copy.done_at, st.done_at)
+
+    def test_idle_restore_keeps_env_time(self):
+        st = make_station()
+        st.sync(0)
+        st.sync(7 * S)
+        copy = make_station()
+        copy.restore(st.snapshot())
+        self.assertEqual((copy.env.now, copy.busy, copy.done_at), (7.0, False, None))
+
+
+if __name__ == "__main__":
+    unittest.main()
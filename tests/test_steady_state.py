@@ -0,0 +1,56 @@
+import math
+import os
+import random
+import statistics
+import sys
+import unittest
+
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+
+import steady_state  # noqa: E402
+
+
+class TestMser(unittest.TestCase):
+    def test_cuts_the_initial_transient(self):
+        rng = random.Random(1)
+        series = [50.0 - k for k in range(40)] + [rng.gauss(10.0, 1.0) for _ in range(960)]
+        cut, settled = steady_state.mser(series)
+        self.assertTrue(settled)
+        self.assertEqual(cut % steady_state.MSER_BATCH, 0)
+        self.assertTrue(35 <= cut <= 60, cut)
+
+    def test_stationary_series_keeps_almost_everything(self):
+        rng = random.Random(2)
+        cut, settled = steady_state.mser([rng.gauss(0.0, 1.0) for _ in range(1000)])
+        self.assertTrue(settled)
+        self.assertLess(cut, 250)
+
+    def test_short_series_is_not_settled(self):
+        self.assertEqual(steady_state.mser([1.0] * 7), (0, False))
+        self.assertFalse(steady_state.mser([1.0] * 30)[1])
+
+
+class TestBatchMeans(unittest.TestCase):
+    def test_known_series(self):
+        bm = steady_state.batch_means([float(k) for k in range(1, 101)], n_batches=10)
+        self.assertEqual((bm["batches"], bm["n"]), (10, 100))
+        self.assertAlmostEqual(bm["mean"], 50.5)
+        means = [10.0 * j + 5.5 for j in range(10)]
+        expected = steady_state.t975(9) * math.sqrt(statistics.variance(means) / 10)
+        self.assertAlmostEqual(bm["half_width"], expected)
+
+    def test_leading_remainder_dropped(self):
+        bm = steady_state.batch_means([100.0] + [1.0] * 40, n_batches=20)
+        self.assertEqual(bm["n"], 40)
+        self.assertEqual((bm["mean"], bm["half_width"]), (1.0, 0.0))
+
+    def test_estimate_regular_departures(self):
+        deps = [(60.0 * k, "accept" if k % 10 else "reject", 300.0) for k in range(1, 401)]
+        est = steady_state.estimate(deps, 0.0)
+        self.assertAlmostEqual(est["throughput_per_min"]["mean"], 1.0)
+        self.assertAlmostEqual(est["cycle_time_s"]["mean"], 300.0)
+        self.assertAlmostEqual(est["yield_pct"]["mean"], 90.0, delta=1.0)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,96 @@
+import os
+import sys
+import threading
+import unittest
+
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+
+import surrogate  # noqa: E402
+
+
+def run(ticks, fast, tpm, yield_pct=95.0, availability=0.9):
+    return {"params": {"reset_pulse_ticks": ticks, "fast_handoff": fast},
+            "summary": {"throughput_per_min": tpm, "yield_pct": yield_pct, "availability": availability}}
+
+
+RUNS = [run(t, f, 0.5 + 0.05 * t + 0.1 * f + 0.01 * rep)
+        for t in (1, 2, 3, 4) for f in (0, 1) for rep in range(2)]
+
+
+class TestSurrogate(unittest.TestCase):
+    def test_too_few_configurations(self):
+        m = surrogate.Surrogate().update(RUNS[:4])
+        self.assertEqual((len(m.configs), m.runs_seen), (2, 4))
+        p = m.predict({"reset_pulse_ticks": 1})
+        self.assertTrue(p["needs_simulation"])
+        self.assertEqual(p["responses"], {})
+
+    def test_update_reads_only_new_runs_and_pools_replications(self):
+        m = surrogate.Surrogate()
+        m.update(RUNS[:6] + [{"params": {}, "ok": False, "summary": {}}])
+        m.update(RUNS[:6] + [{"params": {}}] + RUNS[6:])
+        self.assertEqual((m.runs_seen, len(m.configs)), (len(RUNS) + 1, 8))
+        self.assertEqual(len(m.configs[(2.0, 0.0, 1.0)]["ys"]["throughput_per_min"]), 2)
+
+    def test_prediction_inside_and_outside_the_history(self):
+        m = surrogate.Surrogate().update(RUNS)
+        p = m.predict({"reset_pulse_ticks": 3, "fast_handoff": 1})
+        self.assertAlmostEqual(p["responses"]["throughput_per_min"]["mean"], 0.755, delta=0.02)
+        lo, hi = p["responses"]["throughput_per_min"]["ci95"]
+        self.assertLess(lo, hi)
+        self.assertFalse(p["needs_simulation"], p["reasons"])
+        p = m.predict({"reset_pulse_ticks": 9})
+        self.assertTrue(p["needs_simulation"])
+        self.assertIn("reset_pulse_ticks=9 outside the history [1, 4]", p["reasons"])
+
+
+class TestSharedModel(unittest.TestCase):
+    def setUp(self):
+        surrogate._model, surrogate._fitting = None, False
+
+    def tearDown(self):
+        surrogate._model, surrogate._fitting = None, False
+
+    def test_first_fit_holds_off_other_refreshes(self):
+        seen = []
+        update = surrogate.Surrogate.update
+
+        def observing_update(m, runs, refit=True):
+            # another request while the first fit is still running
+            seen.append((surrogate.current_status()["state"], surrogate.refresh(RUNS)))
+            return update(m, runs, refit)
+        surrogate.Surrogate.update = observing_update
+        try:
+            m = surrogate.refresh(RUNS, {"fault_reset_all": 1})
+        finally:
+            surrogate.Surrogate.update = update
+        self.assertEqual(seen, [("fitting", None)])
+        self.assertIs(surrogate.current_model(), m)
+        self.assertEqual((m.runs_seen, surrogate.current_status()["state"]), (len(RUNS), "ready"))
+
+    def test_no_refit_without_new_runs(self):
+        m = surrogate.refresh(RUNS[:8])
+        threads = threading.active_count()
+        self.assertIs(surrogate.refresh(RUNS[:8]), m)
+        self.assertFalse(surrogate._fitting)
+        self.assertEqual(threading.active_count(), threads)
+
+    def test_later_fits_run_in_the_background(self):
+        m = surrogate.refresh(RUNS[:8])
+        surrogate.refresh(RUNS)
+        for t in threading.enumerate():
+            if t is not threading.current_thread() and t.daemon:
+                t.join(5.0)
+        self.assertFalse(surrogate._fitting)
+        self.assertIs(surrogate.current_model(), m)
+        self.assertEqual(m.runs_seen, len(RUNS))
+        # new base params: a fresh model over the whole history
+        surrogate.refresh(RUNS, {"fault_reset_all": 1})
+        for t in threading.enumerate():
+            if t is not threading.current_thread() and t.daemon:
+                t.join(5.0)
+        self.assertIsNot(surrogate.current_model(), m)
+
+
+if __name__ == "__main__":
+    unittest.main()